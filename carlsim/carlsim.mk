@@ -7,9 +7,9 @@
 kernel_inc := $(addprefix $(kernel_dir)/include/, snn.h gpu.h \
 	snn_definitions.h snn_datastructures.h \
 	gpu_random.h propagated_spike_buffer.h \
-	error_code.h cuda_version_control.h)
+	cpu_thread_pool.h cpu_random.h async_file_writer.h error_code.h cuda_version_control.h)
 kernel_cpp := $(addprefix $(kernel_dir)/src/, snn_cpu.cpp \
-	propagated_spike_buffer.cpp print_snn_info.cpp)
+	propagated_spike_buffer.cpp cpu_thread_pool.cpp async_file_writer.cpp print_snn_info.cpp)
 ifeq ($(strip $(CPU_ONLY)),1)
 	kernel_cu :=
 	kernel_cu_objs :=
@@ -123,6 +123,10 @@ void ConnectionMonitor::setUpdateTimeIntervalSec(int intervalSec) {
 	connMonCorePtr_->setUpdateTimeIntervalSec(intervalSec);
 }
 
+void ConnectionMonitor::setSnapshotEncoding(bool deltaEncoding, bool quantizeWeights) {
+	connMonCorePtr_->setSnapshotEncoding(deltaEncoding, quantizeWeights);
+}
+
 std::vector< std::vector<float> > ConnectionMonitor::takeSnapshot() {
 	return connMonCorePtr_->takeSnapshot();
 }
\ No newline at end of file
@@ -63,6 +63,11 @@ class ConnectionMonitorCore; // forward declaration of implementation
  *
  * Periodic storing can be disabled by calling ConnectionMonitor::setUpdateTimeInterval with argument intervalSec=-1.
  *
+ * The binary file only contains the synapses that exist. Their (pre,post) pairs are stored once in the header section,
+ * and every snapshot is a vector of their weights. In order to make the file smaller, snapshots can also store only
+ * the weights that changed since the previous snapshot and/or store quantized weights (see
+ * ConnectionMonitor::setSnapshotEncoding).
+ *
  * Additionally, during a CARLsim simulation, the ConnectionMonitor object returned by CARLsim::setConnectionMonitor can
  * be queried for connection data. The user may take a snapshot of the weights at any point in time using the method
  * ConnectionMonitor::takeSnapshot.
@@ -480,6 +485,25 @@ class ConnectionMonitor {
 	 */
 	void setUpdateTimeIntervalSec(int intervalSec);
 
+	/*!
+	 * \brief Sets how weight snapshots are encoded in the binary file
+	 *
+	 * By default, every snapshot stores the weights of all synapses as 32-bit floats. With deltaEncoding, a snapshot
+	 * only stores the weights (and indices) of the synapses whose weight changed since the previous snapshot in the
+	 * file, which makes snapshots of connections with few (or no) weight changes almost free. The full weight vector
+	 * is still written whenever that is smaller, and for the first snapshot in the file.
+	 * With quantizeWeights, weights are stored as 16-bit multiples of maxWt/65535, which halves the size of a
+	 * snapshot, but the weights in the file are only accurate to maxWt/131070.
+	 *
+	 * The encoding is stored with every snapshot, so it can be changed at any time. The Matlab Offline Analysis
+	 * Toolbox (OAT) ConnectionReader decodes all encodings.
+	 *
+	 * \param[in] deltaEncoding    whether to store only the weights that changed since the last snapshot.
+	 *                             Default: false.
+	 * \param[in] quantizeWeights  whether to store weights as 16-bit integers. Default: false.
+	 */
+	void setSnapshotEncoding(bool deltaEncoding, bool quantizeWeights=false);
+
 	/*!
 	 * \brief Takes a snapshot of the current weight state
 	 *
@@ -4,9 +4,10 @@
 #include <snn_definitions.h>	// KERNEL_ERROR, KERNEL_INFO, ...
 
 #include <sstream>				// std::stringstream
-#include <algorithm>			// std::sort
+#include <algorithm>			// std::min, std::fill, std::count
 #include <iomanip>				// std::setfill, std::setw
 #include <float.h>				// FLT_EPSILON
+#include <limits.h>				// USHRT_MAX
 
 
 
@@ -27,12 +28,16 @@ ConnectionMonitorCore::ConnectionMonitorCore(CpuSNN* snn,int monitorId,short int
 	needToWriteFileHeader_ = true;
 	needToInit_ = true;
 	connFileSignature_ = 202029319;
-	connFileVersion_ = 0.3f;
+	connFileVersion_ = 0.4f;
 
 	minWt_ = -1.0f;
 	maxWt_ = -1.0f;
 
 	connFileTimeIntervalSec_ = 1;
+
+	deltaEncoding_ = false;
+	quantizeWeights_ = false;
+	wtQuantStep_ = 1.0f;
 }
 
 void ConnectionMonitorCore::init() {
@@ -57,18 +62,29 @@ void ConnectionMonitorCore::init() {
 	fpDeb_ = snn_->getLogFpDeb();
 	fpLog_ = snn_->getLogFpLog();
 
-	// init weight matrix with right dimensions
-	for (int i = 0; i < nNeurPre_; i++) {
-		std::vector<float> wt;
-		for (int j = 0; j < nNeurPost_; j++) {
-			wt.push_back(NAN);
-		}
-		wtMat_.push_back(wt);
-		wtMatLast_.push_back(wt);
-	}
+	// the synapses of a connection don't change after setupNetwork, so their neuron IDs are fetched only once
+	snn_->getConnectionSynapseIds(connId_, synPreId_, synPostId_);
+	int nSyn = synPreId_.size();
 
-	// then load current weigths from CpuSNN into weight matrix
+	// then load current weigths from CpuSNN (the NAN snapshot becomes the last one)
+	wtVec_.assign(nSyn, NAN);
 	updateStoredWeights();
+
+	// the connect file only stores the synapses that exist, in CSR order (by pre, then by post neuron ID)
+	// synapses come by post neuron ID, so a stable counting sort by pre neuron ID leaves every row sorted
+	synPreStart_.assign(nNeurPre_+1, 0);
+	for (int k=0; k<nSyn; k++)
+		synPreStart_[synPreId_[k]+1]++;
+	for (int i=0; i<nNeurPre_; i++)
+		synPreStart_[i+1] += synPreStart_[i];
+	std::vector<int> fillPos(synPreStart_.begin(), synPreStart_.end()-1);
+	synCsrIdx_.resize(nSyn);
+	for (int k=0; k<nSyn; k++)
+		synCsrIdx_[fillPos[synPreId_[k]]++] = k;
+	wtWritten_.assign(nSyn, NAN);
+	wtQuantStep_ = (maxWt_>0.0f) ? maxWt_/USHRT_MAX : 1.0f;
+
+	needToInit_ = false;
 }
 
 ConnectionMonitorCore::~ConnectionMonitorCore() {
@@ -77,7 +93,7 @@ ConnectionMonitorCore::~ConnectionMonitorCore() {
 		if (connFileTimeIntervalSec_ > 0) {
 			// make sure CpuSNN is not already deallocated!
 			assert(snn_!=NULL);
-			writeConnectFileSnapshot(snn_->getSimTime(), snn_->getWeightMatrix2D(connId_));
+			writeConnectFileSnapshot(snn_->getSimTime());
 		}
 
 		// then close file and clean up
@@ -93,14 +109,10 @@ ConnectionMonitorCore::~ConnectionMonitorCore() {
 // calculate weight changes since last update (element-wise )
 std::vector< std::vector<float> > ConnectionMonitorCore::calcWeightChanges() {
 	updateStoredWeights();
-	std::vector< std::vector<float> > wtChange(nNeurPre_, vector<float>(nNeurPost_));
+	std::vector< std::vector<float> > wtChange(nNeurPre_, std::vector<float>(nNeurPost_, NAN));
 
-	// take the naive approach for now
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			wtChange[i][j] = wtMat_[i][j] - wtMatLast_[i][j];
-		}
-	}
+	for (size_t k=0; k<wtVec_.size(); k++)
+		wtChange[synPreId_[k]][synPostId_[k]] = wtVec_[k] - wtVecLast_[k];
 
 	return wtChange;
 }
@@ -108,36 +120,20 @@ std::vector< std::vector<float> > ConnectionMonitorCore::calcWeightChanges() {
 
 // reset weight matrix
 void ConnectionMonitorCore::clear() {
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			wtMat_[i][j] = NAN;
-			wtMatLast_[i][j] = NAN;
-		}
-	}
+	std::fill(wtVec_.begin(), wtVec_.end(), NAN);
+	std::fill(wtVecLast_.begin(), wtVecLast_.end(), NAN);
 }
 
 // find number of incoming synapses for a specific post neuron
 int ConnectionMonitorCore::getFanIn(int neurPostId) {
 	assert(neurPostId<nNeurPost_);
-	int nSyn = 0;
-	for (int i=0; i<nNeurPre_; i++) {
-		if (!isnan(wtMat_[i][neurPostId])) {
-			nSyn++;
-		}
-	}
-	return nSyn;
+	return std::count(synPostId_.begin(), synPostId_.end(), neurPostId);
 }
 
 // find number of outgoing synapses of a specific pre neuron
 int ConnectionMonitorCore::getFanOut(int neurPreId) {
 	assert(neurPreId<nNeurPre_);
-	int nSyn = 0;
-	for (int j=0; j<nNeurPost_; j++) {
-		if (!isnan(wtMat_[neurPreId][j])) {
-			nSyn++;
-		}
-	}
-	return nSyn;
+	return synPreStart_[neurPreId+1] - synPreStart_[neurPreId];
 }
 
 float ConnectionMonitorCore::getMaxWeight(bool getCurrent) {
@@ -146,15 +142,9 @@ float ConnectionMonitorCore::getMaxWeight(bool getCurrent) {
 		updateStoredWeights();
 
 		// find currently largest weight value
-		for (int i=0; i<nNeurPre_; i++) {
-			for (int j=0; j<nNeurPost_; j++) {
-				// skip entries in matrix where no synapse exists
-				if (isnan(wtMat_[i][j]))
-					continue;
-
-				if (wtMat_[i][j] > maxVal) {
-					maxVal = wtMat_[i][j];
-				}
+		for (size_t k=0; k<wtVec_.size(); k++) {
+			if (wtVec_[k] > maxVal) {
+				maxVal = wtVec_[k];
 			}
 		}
 	} else {
@@ -170,16 +160,10 @@ float ConnectionMonitorCore::getMinWeight(bool getCurrent) {
 	if (getCurrent) {
 		updateStoredWeights();
 
-		// find currently largest weight value
-		for (int i=0; i<nNeurPre_; i++) {
-			for (int j=0; j<nNeurPost_; j++) {
-				// skip entries in matrix where no synapse exists
-				if (isnan(wtMat_[i][j]))
-					continue;
-
-				if (wtMat_[i][j] < minVal) {
-					minVal = wtMat_[i][j];
-				}
+		// find currently smallest weight value
+		for (size_t k=0; k<wtVec_.size(); k++) {
+			if (wtVec_[k] < minVal) {
+				minVal = wtVec_[k];
 			}
 		}
 	} else {
@@ -193,18 +177,12 @@ float ConnectionMonitorCore::getMinWeight(bool getCurrent) {
 // find number of synapses whose weights changed
 int ConnectionMonitorCore::getNumWeightsChanged(double minAbsChange) {
 	assert(minAbsChange>=0.0);
-	std::vector< std::vector<float> > wtChange = calcWeightChanges();
+	updateStoredWeights();
 
 	int nChanged = 0;
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			// skip entries in matrix where no synapse exists
-			if (isnan(wtMat_[i][j]))
-				continue;
-
-			if (fabs(wtChange[i][j]) >= minAbsChange) {
-				nChanged++;
-			}
+	for (size_t k=0; k<wtVec_.size(); k++) {
+		if (fabs(wtVec_[k] - wtVecLast_[k]) >= minAbsChange) {
+			nChanged++;
 		}
 	}
 	return nChanged;
@@ -222,15 +200,9 @@ int ConnectionMonitorCore::getNumWeightsInRange(double minVal, double maxVal) {
 	}
 
 	int cnt = 0;
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			// skip entries in matrix where no synapse exists
-			if (isnan(wtMat_[i][j]))
-				continue;
-
-			if (wtMat_[i][j]>=minVal && wtMat_[i][j]<=maxVal) {
-				cnt++;
-			}
+	for (size_t k=0; k<wtVec_.size(); k++) {
+		if (wtVec_[k]>=minVal && wtVec_[k]<=maxVal) {
+			cnt++;
 		}
 	}
 
@@ -249,21 +221,17 @@ int ConnectionMonitorCore::getNumWeightsWithValue(double value) {
 
 // calculate total absolute amount of weight change
 double ConnectionMonitorCore::getTotalAbsWeightChange() {
-	std::vector< std::vector<float> > wtChange = calcWeightChanges();
+	updateStoredWeights();
 	double wtTotalChange = 0.0;
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			// skip entries in matrix where no synapse exists
-			if (isnan(wtMat_[i][j]))
-				continue;
-			wtTotalChange += fabs(wtChange[i][j]);
-		}
+	for (size_t k=0; k<wtVec_.size(); k++) {
+		wtTotalChange += fabs(wtVec_[k] - wtVecLast_[k]);
 	}
 	return wtTotalChange;
 }
 
 void ConnectionMonitorCore::print() {
 	updateStoredWeights();
+	std::vector< std::vector<float> > wtMat = getWeightMatrix2D(wtVec_);
 
 	KERNEL_INFO("(t=%.3fs) ConnectionMonitor ID=%d: %d(%s) => %d(%s)",
 		(getTimeMsCurrentSnapshot()/1000.0f), connId_,
@@ -285,8 +253,8 @@ void ConnectionMonitorCore::print() {
 		std::stringstream line;
 		line << std::setw(9) << std::setfill(' ') << i << " |";
 		for (int j=0; j<nNeurPost_; j++) {
-			line << std::fixed << std::setprecision(4) << (isnan(wtMat_[i][j])?"      ":(wtMat_[i][j]>=0?"   ":"  "))
-				<< wtMat_[i][j]  << "  ";
+			line << std::fixed << std::setprecision(4) << (isnan(wtMat[i][j])?"      ":(wtMat[i][j]>=0?"   ":"  "))
+				<< wtMat[i][j]  << "  ";
 		}
 		KERNEL_INFO("%s",line.str().c_str());
 	}
@@ -298,12 +266,12 @@ void ConnectionMonitorCore::printSparse(int neurPostId, int maxConn, int connPer
 	assert(connPerLine>0);
 
 	// give the option of not storing the new snapshot
-	std::vector< std::vector<float> > wtNew, wtOld;
+	std::vector<float> wtNew, wtOld;
 	int64_t timeNew, timeOld;
 	if (!storeNewSnapshot) {
 		// make a copy of current snapshots so that we can restore them later
-		wtNew = wtMat_;
-		wtOld = wtMatLast_;
+		wtNew = wtVec_;
+		wtOld = wtVecLast_;
 		timeNew = wtTime_;
 		timeOld = wtTimeLast_;
 	}
@@ -320,35 +288,35 @@ void ConnectionMonitorCore::printSparse(int neurPostId, int maxConn, int connPer
 		postZ = nNeurPost_;
 	} else {
 		postA = neurPostId;
-		postZ = neurPostId;
-	}
-
-	std::vector< std::vector<float> > wtChange;
-	if (isPlastic_) {
-		wtChange = calcWeightChanges();
+		postZ = neurPostId+1;
 	}
 
 	std::stringstream line;
 	int nConn = 0;
 	int maxIntDigits = ceil(log10((double)fmax(nNeurPre_,nNeurPost_)));
 	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=postA; j<postZ; j++) {
+		// visit the synapses of pre neuron i by post neuron ID
+		for (int c=synPreStart_[i]; c<synPreStart_[i+1]; c++) {
 			// display only so many connections
 			if (nConn>=maxConn)
 				break;
 
-			if (!isnan(wtMat_[i][j])) {
-				line << "[" << std::setw(maxIntDigits) << i << "," << std::setw(maxIntDigits) << j << "] "
-					<< std::fixed << std::setprecision(4) << wtMat_[i][j];
-				if (isPlastic_) {
-					line << " (" << ((wtChange[i][j]<0)?"":"+");
-					line << std::setprecision(4) << wtChange[i][j] << ")";
-				}
-				line << "   ";
-				if (!(++nConn % connPerLine)) {
-					KERNEL_INFO("%s",line.str().c_str());
-					line.str(std::string());
-				}
+			int k = synCsrIdx_[c];
+			int j = synPostId_[k];
+			if (j<postA || j>=postZ)
+				continue;
+
+			line << "[" << std::setw(maxIntDigits) << i << "," << std::setw(maxIntDigits) << j << "] "
+				<< std::fixed << std::setprecision(4) << wtVec_[k];
+			if (isPlastic_) {
+				float wtChange = wtVec_[k] - wtVecLast_[k];
+				line << " (" << ((wtChange<0)?"":"+");
+				line << std::setprecision(4) << wtChange << ")";
+			}
+			line << "   ";
+			if (!(++nConn % connPerLine)) {
+				KERNEL_INFO("%s",line.str().c_str());
+				line.str(std::string());
 			}
 		}
 	}
@@ -357,8 +325,8 @@ void ConnectionMonitorCore::printSparse(int neurPostId, int maxConn, int connPer
 		KERNEL_INFO("%s",line.str().c_str());
 
 	if (!storeNewSnapshot) {
-		wtMat_ = wtNew;
-		wtMatLast_ = wtOld;
+		wtVec_.swap(wtNew);
+		wtVecLast_.swap(wtOld);
 		wtTime_ = timeNew;
 		wtTimeLast_ = timeOld;
 	}
@@ -387,23 +355,36 @@ void ConnectionMonitorCore::setUpdateTimeIntervalSec(int intervalSec) {
 	connFileTimeIntervalSec_ = intervalSec;
 }
 
+void ConnectionMonitorCore::setSnapshotEncoding(bool deltaEncoding, bool quantizeWeights) {
+	// every snapshot carries its own encoding flags, so this can be changed at any time
+	deltaEncoding_ = deltaEncoding;
+	quantizeWeights_ = quantizeWeights;
+}
+
 // updates the internally stored last two snapshots (current one and last one)
 void ConnectionMonitorCore::updateStoredWeights() {
 	if (snn_->getSimTime() > wtTime_) {
-		// time has advanced: get new weights
-		wtMatLast_ = wtMat_;
+		// time has advanced: get new weights (the buffer of the last snapshot is reused)
+		wtVecLast_.swap(wtVec_);
 		wtTimeLast_ = wtTime_;
 
-		wtMat_ = snn_->getWeightMatrix2D(connId_);
+		snn_->getConnectionWeights(connId_, wtVec_);
 		wtTime_ = snn_->getSimTime();
 	}
 }
 
+std::vector< std::vector<float> > ConnectionMonitorCore::getWeightMatrix2D(const std::vector<float>& wts) {
+	std::vector< std::vector<float> > wtMat(nNeurPre_, std::vector<float>(nNeurPost_, NAN));
+	for (size_t k=0; k<wts.size(); k++)
+		wtMat[synPreId_[k]][synPostId_[k]] = wts[k];
+	return wtMat;
+}
+
 // returns a current snapshot
 std::vector< std::vector<float> > ConnectionMonitorCore::takeSnapshot() {
 	updateStoredWeights();
-	writeConnectFileSnapshot(wtTime_, wtMat_);
-	return wtMat_;
+	writeConnectFileSnapshot(wtTime_, wtVec_);
+	return getWeightMatrix2D(wtVec_);
 }
 
 // write the header section of the spike file
@@ -462,30 +443,104 @@ void ConnectionMonitorCore::writeConnectFileHeader() {
 	if (!fwrite(&maxWt_,sizeof(float),1,connFileId_))
 		KERNEL_ERROR("ConnectionMonitorCore: writeConnectFileHeader has fwrite error");
 
+	// write the synapses that exist in CSR format: nNeurPre+1 row offsets, then the post neuron ID of every synapse
+	// every snapshot stores the weights in this order
+	if (fwrite(&synPreStart_[0],sizeof(int),nNeurPre_+1,connFileId_) != (size_t)(nNeurPre_+1))
+		KERNEL_ERROR("ConnectionMonitorCore: writeConnectFileHeader has fwrite error");
+	std::vector<int> csrPostId(synCsrIdx_.size());
+	for (size_t c=0; c<synCsrIdx_.size(); c++)
+		csrPostId[c] = synPostId_[synCsrIdx_[c]];
+	if (csrPostId.size() && fwrite(&csrPostId[0],sizeof(int),csrPostId.size(),connFileId_) != csrPostId.size())
+		KERNEL_ERROR("ConnectionMonitorCore: writeConnectFileHeader has fwrite error");
 
 	// \TODO: write delays
 
 	needToWriteFileHeader_ = false;
 }
 
-void ConnectionMonitorCore::writeConnectFileSnapshot(unsigned int simTimeMs, std::vector< std::vector<float> > wts) {
+void ConnectionMonitorCore::writeConnectFileSnapshot(unsigned int simTimeMs) {
+	// don't fetch the weights if there is nothing to write
+	if ((int64_t)simTimeMs <= wtTimeWrite_ || connFileId_==NULL) {
+		return;
+	}
+
+	snn_->getConnectionWeights(connId_, wtFileVec_);
+	writeConnectFileSnapshot(simTimeMs, wtFileVec_);
+}
+
+void ConnectionMonitorCore::writeConnectFileSnapshot(unsigned int simTimeMs, const std::vector<float>& wts) {
 	// don't write if we have already written this timestamp to file (or file doesn't exist)
 	if ((int64_t)simTimeMs <= wtTimeWrite_ || connFileId_==NULL) {
 		return;
 	}
 
+	// the first snapshot in the file cannot refer to an earlier one
+	bool isFirstSnapshot = wtTimeWrite_ < 0;
 	wtTimeWrite_ = (int64_t)simTimeMs;
 
-	// write time stamp
+	// collect the weights in CSR order, the way the reader will reconstruct them, and find the ones that changed
+	wtChangedIdx_.clear();
+	int nSyn = synCsrIdx_.size();
+	for (int c=0; c<nSyn; c++) {
+		float wt = wts[synCsrIdx_[c]];
+		if (quantizeWeights_)
+			wt = (float)std::min((int)(wt/wtQuantStep_ + 0.5f), USHRT_MAX) * wtQuantStep_;
+		if (isFirstSnapshot || wt!=wtWritten_[c]) {
+			wtChangedIdx_.push_back(c);
+			wtWritten_[c] = wt;
+		}
+	}
+
+	// a delta snapshot needs an index per synapse, so it only pays off if few weights have changed
+	size_t bytesPerWt = quantizeWeights_ ? sizeof(unsigned short) : sizeof(float);
+	int flags = quantizeWeights_ ? CONN_FILE_SNAPSHOT_QUANTIZED : 0;
+	if (deltaEncoding_ && !isFirstSnapshot && wtChangedIdx_.size()*(sizeof(int)+bytesPerWt) < nSyn*bytesPerWt)
+		flags |= CONN_FILE_SNAPSHOT_DELTA;
+
+	// write time stamp and encoding flags
 	if (!fwrite(&wtTimeWrite_,sizeof(int64_t),1,connFileId_))
 		KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
+	if (!fwrite(&flags,sizeof(int),1,connFileId_))
+		KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
+	if (quantizeWeights_ && !fwrite(&wtQuantStep_,sizeof(float),1,connFileId_))
+		KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
 
-	// write all weights
-	for (int i=0; i<nNeurPre_; i++) {
-		for (int j=0; j<nNeurPost_; j++) {
-			if (!fwrite(&wts[i][j],sizeof(float),1,connFileId_)) {
-				KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
-			}
+	if (flags & CONN_FILE_SNAPSHOT_DELTA) {
+		// write the number of changed synapses, their indices, and their new weights
+		int nChanged = wtChangedIdx_.size();
+		if (!fwrite(&nChanged,sizeof(int),1,connFileId_))
+			KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
+		if (nChanged && fwrite(&wtChangedIdx_[0],sizeof(int),nChanged,connFileId_) != (size_t)nChanged)
+			KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
+		writeConnectFileWeights(&wtChangedIdx_, quantizeWeights_);
+	} else {
+		// write all weights
+		writeConnectFileWeights(NULL, quantizeWeights_);
+	}
+}
+
+void ConnectionMonitorCore::writeConnectFileWeights(const std::vector<int>* synIdx, bool quantize) {
+	int nWts = (synIdx==NULL) ? wtWritten_.size() : synIdx->size();
+	if (!nWts)
+		return;
+
+	size_t cnt;
+	if (quantize) {
+		wtQuantFileBuf_.resize(nWts);
+		for (int k=0; k<nWts; k++) {
+			float wt = wtWritten_[(synIdx==NULL) ? k : (*synIdx)[k]];
+			wtQuantFileBuf_[k] = (unsigned short)(wt/wtQuantStep_ + 0.5f);
 		}
+		cnt = fwrite(&wtQuantFileBuf_[0],sizeof(unsigned short),nWts,connFileId_);
+	} else if (synIdx==NULL) {
+		cnt = fwrite(&wtWritten_[0],sizeof(float),nWts,connFileId_);
+	} else {
+		wtFileBuf_.resize(nWts);
+		for (int k=0; k<nWts; k++)
+			wtFileBuf_[k] = wtWritten_[(*synIdx)[k]];
+		cnt = fwrite(&wtFileBuf_[0],sizeof(float),nWts,connFileId_);
 	}
+
+	if (cnt != (size_t)nWts)
+		KERNEL_ERROR("ConnectionMonitor: writeConnectFileSnapshot has fwrite error");
 }
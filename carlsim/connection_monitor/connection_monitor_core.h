@@ -161,18 +161,31 @@ public:
 	//! sets time update interval (seconds) for periodically storing weights to file
 	void setUpdateTimeIntervalSec(int intervalSec);
 
-	//! writes each snapshot to connect file
-	void writeConnectFileSnapshot(unsigned int simTimeMs, std::vector< std::vector<float> > wts);
+	//! sets how snapshots are encoded in the connect file (only the synapses that changed, quantized weights)
+	void setSnapshotEncoding(bool deltaEncoding, bool quantizeWeights);
+
+	//! writes the current weights of the connection as a snapshot to connect file
+	void writeConnectFileSnapshot(unsigned int simTimeMs);
 	
 private:
 	//! indicates whether writing the current snapshot is necessary (false it has already been written)
 	bool needToWriteSnapshot();
 
 	void updateStoredWeights();
+
+	//! expands a flat weight vector (in connection order) into a 2D weight matrix (non-existent synapses: NAN)
+	std::vector< std::vector<float> > getWeightMatrix2D(const std::vector<float>& wts);
+
+	//! writes a snapshot of the weights wts (in connection order) to connect file
+	void writeConnectFileSnapshot(unsigned int simTimeMs, const std::vector<float>& wts);
 	
 	//! writes the header section (file signature, version number) of a connect file
 	void writeConnectFileHeader();
 
+	//! writes the weights of the synapses in synIdx (all synapses if synIdx is NULL) as one block of float or, if
+	//! quantized, uint16 multiples of wtQuantStep_
+	void writeConnectFileWeights(const std::vector<int>* synIdx, bool quantize);
+
 	CpuSNN* snn_;                   //!< private CARLsim implementation
 	int monitorId_;                 //!< current ConnectionMonitor ID
 	short int connId_;              //!< current connection ID
@@ -187,12 +200,26 @@ private:
 
 	bool isPlastic_; //!< whether this connection has plastic synapses
 
-	std::vector< std::vector<float> > wtMat_;      //!< current snapshot of weight matrix
-	std::vector< std::vector<float> > wtMatLast_;  //!< last snapshot of weight matrix
+	// the weights are stored as flat vectors, one entry per synapse in the order of CpuSNN::getConnectionWeights
+	std::vector<int> synPreId_;     //!< pre-synaptic neuron ID of every synapse
+	std::vector<int> synPostId_;    //!< post-synaptic neuron ID of every synapse
+	std::vector<float> wtVec_;      //!< current snapshot of weights
+	std::vector<float> wtVecLast_;  //!< last snapshot of weights
+	std::vector<float> wtFileVec_;  //!< reusable buffer for weights that go straight to the connect file
 	int64_t wtTime_;
 	int64_t wtTimeLast_;
 	int64_t wtTimeWrite_;
 
+	std::vector<int> synPreStart_;  //!< CSR row offsets: synapses of pre neuron i are [synPreStart_[i],synPreStart_[i+1])
+	std::vector<int> synCsrIdx_;    //!< CSR order: index (in connection order) of every synapse in the connect file
+	std::vector<float> wtWritten_;  //!< weights (in CSR order) as the reader reconstructs them from the connect file
+	std::vector<int> wtChangedIdx_; //!< scratch buffer for the synapses that changed since the last written snapshot
+	bool deltaEncoding_;            //!< whether snapshots only store synapses that changed since the last snapshot
+	bool quantizeWeights_;          //!< whether snapshots store weights as uint16 multiples of wtQuantStep_
+	float wtQuantStep_;             //!< quantization step: maxWt_ spread over the uint16 range
+	std::vector<float> wtFileBuf_;  //!< block of float weights to be written to the connect file
+	std::vector<unsigned short> wtQuantFileBuf_; //!< block of quantized weights to be written to the connect file
+
 	bool needToInit_;				//!< whether we have to initialize first
 	bool needToWriteFileHeader_;    //!< whether we have to write header section of conn file
 
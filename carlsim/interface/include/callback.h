@@ -42,6 +42,8 @@
 #ifndef _CALLBACK_H_
 #define _CALLBACK_H_
 
+#include <vector>
+
 // CARLsim user interface classes
 class CARLsim; // forward-declaration
 
@@ -94,6 +96,48 @@ public:
 							float& delay, bool& connected) = 0;
 };
 
+/*!
+ * \brief a synaptic connection created by a BatchConnectionGenerator
+ *
+ * Weights and delays have the same meaning as in ConnectionGenerator::connect.
+ */
+struct ConnectionTuple {
+	ConnectionTuple(int _i, int _j, float _weight, float _maxWt, float _delay) : i(_i), j(_j), weight(_weight),
+		maxWt(_maxWt), delay(_delay) {}
+
+	int i;			//!< neuron index in the pre-synaptic group
+	int j;			//!< neuron index in the post-synaptic group
+	float weight;	//!< initial weight
+	float maxWt;	//!< maximum weight (ignored for fixed synapses)
+	float delay;	//!< synaptic delay (ms), at least 1, the fractional part is truncated
+};
+
+/*!
+ * A ConnectionGenerator is asked about every possible (pre,post) pair, which quickly becomes expensive for large groups
+ * with sparse connectivity. A BatchConnectionGenerator is instead called once per block of pre-synaptic neurons and
+ * returns only the connections that should be made.
+ *
+ * If isThreadSafe() returns true, the simulator may call connect for different blocks concurrently from several
+ * threads (see CARLsim::setNumThreads). The resulting network does not depend on how the pre-synaptic neurons were
+ * split into blocks, as long as connect returns the same connections for every pre-synaptic neuron.
+ */
+class BatchConnectionGenerator {
+public:
+	virtual ~BatchConnectionGenerator() {}
+
+	/*!
+	 * \brief specifies all synaptic connections of the pre-synaptic neurons [startI, endI)
+	 *
+	 * Every connection to be made is appended to connections. The pre-synaptic index i of each ConnectionTuple must lie
+	 * within [startI, endI), and the post-synaptic index j within the post-synaptic group.
+	 * \attention The virtual method should never be called directly */
+	virtual void connect(CARLsim* s, int srcGrpId, int startI, int endI, int destGrpId,
+							std::vector<ConnectionTuple>& connections) = 0;
+
+	//! whether connect may be called concurrently from several threads (default: false)
+	virtual bool isThreadSafe() { return false; }
+};
+
 
 
 #endif
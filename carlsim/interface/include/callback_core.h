@@ -42,11 +42,15 @@
 #ifndef _CALLBACK_CORE_H_
 #define _CALLBACK_CORE_H_
 
+#include <vector>
+
 class CARLsim;
 class CpuSNN;
 
 class ConnectionGenerator;
+class BatchConnectionGenerator;
 class SpikeGenerator;
+struct ConnectionTuple;
 
 /// **************************************************************************************************************** ///
 /// Classes for relay callback
@@ -94,4 +98,28 @@ private:
 	ConnectionGenerator* cGen;
 };
 
+//! used for relaying callback to BatchConnectionGenerator
+/*!
+ * \brief The class is used to store user-defined callback function and to be registered in core (i.e., snn_cpu.cpp)
+ * Once the core invokes the callback method of the class, the class relays all parameter and invokes user-defined
+ * callback function.
+ * \sa BatchConnectionGenerator
+ */
+class BatchConnectionGeneratorCore {
+public:
+	BatchConnectionGeneratorCore(CARLsim* c, BatchConnectionGenerator* cg);
+	virtual ~BatchConnectionGeneratorCore() {}
+	//! specifies all synaptic connections of the pre-synaptic neurons [startI, endI)
+	/*! \attention The virtual method should never be called directly */
+	virtual void connect(CpuSNN* s, int srcGrpId, int startI, int endI, int destGrpId,
+		std::vector<ConnectionTuple>& connections);
+
+	//! whether connect may be called concurrently from several threads
+	virtual bool isThreadSafe();
+
+private:
+	CARLsim* carlsim;
+	BatchConnectionGenerator* cGen;
+};
+
 #endif
@@ -110,6 +110,7 @@ class CpuSNN; // forward-declaration of implementation
 class GroupMonitorCore;
 class ConnectionMonitorCore;
 class ConnectionGeneratorCore;
+class BatchConnectionGeneratorCore;
 class SpikeGeneratorCore;
 
 /*!
@@ -271,6 +272,28 @@ public:
 	short int connect(int grpId1, int grpId2, ConnectionGenerator* conn, float mulSynFast, float mulSynSlow,
 						bool synWtType=SYN_FIXED, int maxM=0,int maxPreM=0);
 
+	/*!
+	 * \brief Shortcut to make connections with a batched custom connectivity profile but omit scaling factors for
+	 * synaptic conductances (default is 1.0 for both)
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \see BatchConnectionGenerator
+	 */
+	short int connect(int grpId1, int grpId2, BatchConnectionGenerator* conn, bool synWtType=SYN_FIXED, int maxM=0,
+						int maxPreM=0);
+
+	/*!
+	 * \brief make connections with a batched custom connectivity profile
+	 *
+	 * Works like connect with a ConnectionGenerator, but instead of being asked about every possible (pre,post) pair,
+	 * the generator returns the connections of a whole block of pre-synaptic neurons at once. If the generator is
+	 * thread-safe, the blocks are generated in parallel on the threads set with setNumThreads.
+	 * \STATE ::CONFIG_STATE
+	 * \see BatchConnectionGenerator
+	 */
+	short int connect(int grpId1, int grpId2, BatchConnectionGenerator* conn, float mulSynFast, float mulSynSlow,
+						bool synWtType=SYN_FIXED, int maxM=0, int maxPreM=0);
+
 
 	/*!
 	 * \brief make a compartmental connection between two compartmentally enabled groups
@@ -484,6 +507,75 @@ public:
 	 */
 	void setIntegrationMethod(integrationMethod_t method, int numStepsPerMs);
 
+	/*!
+	 * \brief Sets the number of threads used to run the simulation in CPU_MODE
+	 *
+	 * By default, a CPU_MODE simulation runs on a single core. This function distributes the per-millisecond
+	 * simulation stages (conductance/STP decay, STDP of spiking neurons, and numerical integration of the neuron
+	 * state) across a pool of numThreads threads, which is created once in setupNetwork and reused in every time step.
+	 * Every thread works on its own contiguous range of neurons, and all stages are synchronized at the end, so
+	 * the network produces exactly the same spikes as in single-threaded mode (for the same random seed).
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] numThreads the number of threads to use (1 = single-threaded)
+	 *
+	 * \note This setting has no effect in GPU_MODE.
+	 * \note Multi-threading is not supported on Windows, where the simulation will run single-threaded.
+	 */
+	void setNumThreads(int numThreads);
+
+	/*!
+	 * \brief Enables a post-ordered copy of synaptic weights for faster spike delivery in CPU_MODE
+	 *
+	 * Synaptic weights are stored in the order of the incoming synapses of a neuron. During spike delivery, however,
+	 * the outgoing synapses of a neuron are visited, so every synaptic event needs two random memory accesses to
+	 * find the weight of a synapse. If enabled, setupNetwork builds a copy of the weights (plus an index map) in the
+	 * order of the outgoing synapses, sorted by delay and post-synaptic neuron, so that they can be streamed during
+	 * spike delivery. Weight changes (STDP, setWeight, scaleWeights, biasWeights) are written through to the copy.
+	 * The network produces exactly the same spikes and weights as without the copy.
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] enable whether to enable (true) or disable (false) the post-ordered copy
+	 *
+	 * \note This costs about 14 additional bytes per synapse. The setting has no effect in GPU_MODE.
+	 */
+	void setPostOrderedSynapses(bool enable);
+
+	/*!
+	 * \brief Computes the exponential STDP curves from decaying spike traces instead of exp() in CPU_MODE
+	 *
+	 * By default, every STDP update evaluates exp() of the time difference between a pre- and a post-synaptic spike.
+	 * If enabled, every neuron keeps a spike trace that is reset to 1 when the neuron fires and decays by a constant
+	 * factor every millisecond, so that an STDP update becomes a single multiplication. Pre-synaptic traces are kept
+	 * for the last maximum-delay milliseconds to account for axonal delays. Like the default, traces pair every spike
+	 * with the most recent spike of the other side (nearest-spike STDP), and the resulting weights agree with the
+	 * default up to floating-point rounding. Applies to EXP_CURVE and TIMING_BASED_CURVE; PULSE_CURVE is unaffected.
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] enable whether to enable (true) or disable (false) trace-based STDP
+	 *
+	 * \note This costs 8 bytes per neuron plus 4*(maxDelay+1) bytes per neuron for every distinct tau+ used by the
+	 * network, and 1 byte per synapse. The setting has no effect in GPU_MODE.
+	 */
+	void setTraceBasedSTDP(bool enable);
+
+	/*!
+	 * \brief Decays homeostasis variables only when a neuron spikes, instead of every ms, in CPU_MODE
+	 *
+	 * By default, the average firing rate used by homeostasis is decayed for every neuron in every time step. In
+	 * networks with sparse activity, most of these updates go to neurons that have not spiked in a long time. If
+	 * enabled, the average firing rate of a neuron is only brought up to date in closed form (pow(decay, dt)) when
+	 * the neuron spikes, and when homeostasis updates the weights. This produces the same dynamics as the default
+	 * up to floating-point rounding.
+	 *
+	 * \STATE ::CONFIG_STATE
+	 * \param[in] enable whether to enable (true) or disable (false) lazy decay
+	 *
+	 * \note STP variables are always decayed this way in CPU_MODE. Conductances are still decayed every ms, because
+	 * they are read by the integration of every neuron in every time step. The setting has no effect in GPU_MODE.
+	 */
+	void setLazyDecay(bool enable);
+
 	/*!
 	 * \brief Sets Izhikevich params a, b, c, and d with as mean +- standard deviation
 	 *
@@ -634,6 +726,11 @@ public:
 	/*!
 	 * \brief Sets E-STDP with the exponential curve
 	 *
+	 * In CPU_MODE, the LTP and LTD curves are tabulated per group in steps of 1 ms at setupNetwork, so the weight
+	 * updates need no exp(). A table ends where the curve has decayed (t > 25*tau), but after at most
+	 * STDP_LUT_MAX_LEN ms (10 s); a curve cut off earlier gives a warning. GPU_MODE does not use the tables and still
+	 * evaluates exp() for every spike pair.
+	 *
 	 * \param[in] grpId the group ID of group for which these settings are applied
 	 * \param[in] isSet the flag indicating if E-STDP is enabled
 	 * \param[in] type the flag indicating if E-STDP is modulated by dopamine (i.e., DA-STDP)
@@ -649,6 +746,8 @@ public:
 	/*!
 	 * \brief Sets E-STDP with the timing-based curve
 	 *
+	 * The curve is tabulated in CPU_MODE only, see setESTDP(int, bool, stdpType_t, ExpCurve).
+	 *
 	 * \param[in] grpId the group ID of group for which these settings are applied
 	 * \param[in] isSet the flag indicating if E-STDP is enabled
 	 * \param[in] type the flag indicating if E-STDP is modulated by dopamine (i.e., DA-STDP)
@@ -675,6 +774,8 @@ public:
 	/*!
 	 * \brief Sets I-STDP with the exponential curve
 	 *
+	 * The curves are tabulated in CPU_MODE only, see setESTDP(int, bool, stdpType_t, ExpCurve).
+	 *
 	 * \param[in] grpId the group ID of group for which these settings are applied
 	 * \param[in] isSet the flag indicating if I-STDP is enabled
 	 * \param[in] type the flag indicating if I-STDP is modulated by dopamine (i.e., DA-STDP)
@@ -690,6 +791,9 @@ public:
 	/*!
 	 * \brief Sets I-STDP with the pulse curve
 	 *
+	 * In CPU_MODE, the pulse is tabulated in steps of 1 ms up to a width of at most STDP_LUT_MAX_LEN ms (10 s), a wider
+	 * pulse is cut off with a warning. GPU_MODE evaluates the pulse for every spike pair.
+	 *
 	 * \param[in] grpId the group ID of group for which these settings are applied
 	 * \param[in] isSet the flag indicating if I-STDP is enabled
 	 * \param[in] type the flag indicating if I-STDP is modulated by dopamine (i.e., DA-STDP)
@@ -1823,6 +1927,7 @@ private:
 	std::vector<bool> grpNeurParams_; //!< for every group, whether setNeuronParameters has been called
 	std::vector<SpikeGeneratorCore*> spkGen_; //!< a list of all created spike generators
 	std::vector<ConnectionGeneratorCore*> connGen_; //!< a list of all created connection generators
+	std::vector<BatchConnectionGeneratorCore*> batchConnGen_; //!< a list of all created batch connection generators
 
 	bool hasSetHomeoALL_;			//!< informs that homeostasis have been set for ALL groups (can't add more groups)
 	bool hasSetHomeoBaseFiringALL_;	//!< informs that base firing has been set for ALL groups (can't add more groups)
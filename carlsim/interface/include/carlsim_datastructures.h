@@ -188,6 +188,29 @@ static const char* spikeMonMode_string[] = {
 	"SpikeCount Mode","SpikeTime Mode"
 };
 
+/*!
+ * \brief A read-only view of the spike times of a neuron recorded by a SpikeMonitor
+ *
+ * The view points into the spike store of the SpikeMonitor, so no spikes are copied. It lists the spike times (ms)
+ * of the neuron in ascending order, and can be used like a const container (size, operator[], begin, end).
+ * The view becomes invalid once the SpikeMonitor starts recording again or is cleared.
+ *
+ * \since v3.1
+ */
+struct SpikeTimesView {
+	SpikeTimesView() : times(0), numSpikes(0) {}
+	SpikeTimesView(const int* _times, int _numSpikes) : times(_times), numSpikes(_numSpikes) {}
+
+	int size() const { return numSpikes; }
+	bool empty() const { return numSpikes==0; }
+	int operator[](int i) const { return times[i]; }
+	const int* begin() const { return times; }
+	const int* end() const { return times+numSpikes; }
+
+	const int* times;	//!< spike times of the neuron (ms)
+	int numSpikes;		//!< number of spikes
+};
+
 /*!
  * \brief GroupMonitor flag
  *
@@ -251,7 +274,8 @@ static const char* carlsimState_string[] = {
 /*!
  * \brief a range struct for synaptic delays
  *
- * Synaptic delays can range between 1 and 20 ms. The struct maintains two fields: min and max.
+ * Synaptic delays can range between 1 and 255 ms in CPU_MODE, and between 1 and 20 ms in GPU_MODE. The struct
+ * maintains two fields: min and max.
  * \param[in] min the lower bound for delay values
  * \param[in] max the upper bound for delay values
  * Examples:
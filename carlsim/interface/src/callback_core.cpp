@@ -70,3 +70,18 @@ void ConnectionGeneratorCore::connect(CpuSNN* s, int srcGrpId, int i, int destGr
 	if (cGen != NULL)
 		cGen->connect(carlsim, srcGrpId, i, destGrpId, j, weight, maxWt, delay, connected);
 }
+
+BatchConnectionGeneratorCore::BatchConnectionGeneratorCore(CARLsim* c, BatchConnectionGenerator* cg) {
+	carlsim = c;
+	cGen = cg;
+}
+
+void BatchConnectionGeneratorCore::connect(CpuSNN* s, int srcGrpId, int startI, int endI, int destGrpId,
+							std::vector<ConnectionTuple>& connections) {
+	if (cGen != NULL)
+		cGen->connect(carlsim, srcGrpId, startI, endI, destGrpId, connections);
+}
+
+bool BatchConnectionGeneratorCore::isThreadSafe() {
+	return (cGen != NULL) && cGen->isThreadSafe();
+}
@@ -119,6 +119,11 @@ CARLsim::~CARLsim() {
 			delete connGen_[i];
 		connGen_[i]=NULL;
 	}
+	for (size_t i=0; i<batchConnGen_.size(); i++) {
+		if (batchConnGen_[i]!=NULL)
+			delete batchConnGen_[i];
+		batchConnGen_[i]=NULL;
+	}
 	if (snn_!=NULL)
 		delete snn_;
 	snn_=NULL;
@@ -211,6 +216,7 @@ void CARLsim::CARLsimInit() {
 	grpNeurParams_.clear();
 	spkGen_.clear();
 	connGen_.clear();
+	batchConnGen_.clear();
 	connSyn_.clear();
 	connComp_.clear();
 }
@@ -240,6 +246,8 @@ short int CARLsim::connect(int grpId1, int grpId2, const std::string& connType,
 	UserErrors::assertTrue(connProb>=0.0f && connProb<=1.0f, UserErrors::MUST_BE_IN_RANGE, funcName,
 		"Connection Probability connProb", "[0,1]");
 	UserErrors::assertTrue(delay.min>0, UserErrors::MUST_BE_POSITIVE, funcName, "delay.min");
+	UserErrors::assertTrue(delay.max<=(simMode_==GPU_MODE ? MAX_SynapticDelay_GPU : MAX_SynapticDelay),
+		UserErrors::MUST_BE_IN_RANGE, funcName, "delay.max", simMode_==GPU_MODE ? "[1,20] in GPU_MODE" : "[1,255]");
 	UserErrors::assertTrue(connType.compare("one-to-one")!=0
 		|| connType.compare("one-to-one")==0 && getGroupNumNeurons(grpId1) == getGroupNumNeurons(grpId2),
 		UserErrors::MUST_BE_IDENTICAL, funcName, "For type \"one-to-one\", number of neurons in pre and post");
@@ -351,6 +359,49 @@ short int CARLsim::connect(int grpId1, int grpId2, ConnectionGenerator* conn, fl
 		maxM, maxPreM);
 }
 
+// batched custom connectivity profile
+short int CARLsim::connect(int grpId1, int grpId2, BatchConnectionGenerator* conn, bool synWtType, int maxM,
+	int maxPreM)
+{
+	return connect(grpId1, grpId2, conn, 1.0f, 1.0f, synWtType, maxM, maxPreM);
+}
+
+// batched custom connectivity profile
+short int CARLsim::connect(int grpId1, int grpId2, BatchConnectionGenerator* conn, float mulSynFast, float mulSynSlow,
+	bool synWtType, int maxM, int maxPreM)
+{
+	std::string funcName = "connect(\""+getGroupName(grpId1)+"\",\""+getGroupName(grpId2)+"\")";
+	std::stringstream grpId1str; grpId1str << ". Group Id " << grpId1;
+	std::stringstream grpId2str; grpId2str << ". Group Id " << grpId2;
+	UserErrors::assertFalse(grpId1==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, grpId1str.str()); // grpId can't be ALL
+	UserErrors::assertFalse(grpId2==ALL, UserErrors::ALL_NOT_ALLOWED, funcName, grpId2str.str());
+	UserErrors::assertTrue(!isPoissonGroup(grpId2), UserErrors::WRONG_NEURON_TYPE, funcName, grpId2str.str() +
+		" is PoissonGroup, connect");
+	UserErrors::assertTrue(conn!=NULL, UserErrors::CANNOT_BE_NULL, funcName, "BatchConnectionGenerator* conn");
+	UserErrors::assertTrue(mulSynFast>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName, "mulSynFast");
+	UserErrors::assertTrue(mulSynSlow>=0.0f, UserErrors::CANNOT_BE_NEGATIVE, funcName, "mulSynSlow");
+	UserErrors::assertTrue(maxM>=0, UserErrors::CANNOT_BE_NEGATIVE, funcName, "maxM");
+	UserErrors::assertTrue(maxPreM>=0, UserErrors::CANNOT_BE_NEGATIVE, funcName, "maxPreM");
+
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName, "CONFIG.");
+	assert(++numConnections_ <= MAX_nConnections);
+
+	// groups cannot be both chemically (synaptically) and electrically (compartmentally) connected
+	UserErrors::assertTrue(std::find(connComp_[grpId1].begin(), connComp_[grpId1].end(), grpId2) == 
+		connComp_[grpId1].end(), UserErrors::CANNOT_BE_CONN_SYN_AND_COMP, funcName, 
+		grpId1str.str() + " and " + grpId2str.str());
+	UserErrors::assertTrue(std::find(connComp_[grpId2].begin(), connComp_[grpId2].end(), grpId1) == 
+		connComp_[grpId2].end(), UserErrors::CANNOT_BE_CONN_SYN_AND_COMP, funcName, 
+		grpId1str.str() + " and " + grpId2str.str());
+
+	// add synaptic connection to 2D matrix
+	connSyn_[grpId1].push_back(grpId2);
+
+	BatchConnectionGeneratorCore* CGC = new BatchConnectionGeneratorCore(this, conn);
+	batchConnGen_.push_back(CGC);
+	return snn_->connect(grpId1, grpId2, CGC, mulSynFast, mulSynSlow, synWtType, maxM, maxPreM);
+}
+
 short int CARLsim::connectCompartments(int grpIdLower, int grpIdUpper) {
 	std::stringstream funcName; funcName << "connectCompartments(" << grpIdLower << "," << grpIdUpper << ")";
 
@@ -596,6 +647,40 @@ void CARLsim::setIntegrationMethod(integrationMethod_t method, int numStepsPerMs
 	snn_->setIntegrationMethod(method, numStepsPerMs);	
 }
 
+// set the number of threads used in CPU_MODE
+void CARLsim::setNumThreads(int numThreads) {
+	std::string funcName = "setNumThreads()";
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName,
+		"CONFIG.");
+	UserErrors::assertTrue(numThreads >= 1, UserErrors::MUST_BE_POSITIVE, funcName, "numThreads");
+
+	snn_->setNumThreads(numThreads);
+}
+
+void CARLsim::setPostOrderedSynapses(bool enable) {
+	std::string funcName = "setPostOrderedSynapses()";
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName,
+		"CONFIG.");
+
+	snn_->setPostOrderedSynapses(enable);
+}
+
+void CARLsim::setTraceBasedSTDP(bool enable) {
+	std::string funcName = "setTraceBasedSTDP()";
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName,
+		"CONFIG.");
+
+	snn_->setTraceBasedSTDP(enable);
+}
+
+void CARLsim::setLazyDecay(bool enable) {
+	std::string funcName = "setLazyDecay()";
+	UserErrors::assertTrue(carlsimState_==CONFIG_STATE, UserErrors::CAN_ONLY_BE_CALLED_IN_STATE, funcName, funcName,
+		"CONFIG.");
+
+	snn_->setLazyDecay(enable);
+}
+
 // set neuron parameters for Izhikevich neuron, with standard deviations
 void CARLsim::setNeuronParameters(int grpId, float izh_a, float izh_a_sd, float izh_b, float izh_b_sd,
 	float izh_c, float izh_c_sd, float izh_d, float izh_d_sd)
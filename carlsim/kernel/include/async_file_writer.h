@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 2/21/2014
+ */
+#ifndef _ASYNC_FILE_WRITER_H_
+#define _ASYNC_FILE_WRITER_H_
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+
+#if !defined(WIN32) && !defined(WIN64)
+	#include <pthread.h>
+#endif
+
+/*!
+ * \brief Writes blocks of 32-bit words to files on a background I/O thread
+ *
+ * The simulation thread collects data (e.g., the (time,neurId) pairs of a spike file) in a large buffer and hands the
+ * whole buffer to write(). The buffer is queued and written (and fflushed) by the I/O thread, so that the simulation
+ * does not wait for the disk. Buffers are written in the order in which they were handed in. The queue is bounded:
+ * write() only blocks if maxQueuedBuffers buffers are still waiting to be written.
+ *
+ * A file must not be accessed by anyone else (in particular, it must not be fclosed) while some of its buffers are
+ * still queued. Call sync() first.
+ *
+ * On Windows the writer falls back to writing every buffer on the calling thread.
+ */
+class AsyncFileWriter {
+public:
+	//! starts the I/O thread
+	AsyncFileWriter(int maxQueuedBuffers);
+
+	//! writes all buffers that are still queued and joins the I/O thread
+	~AsyncFileWriter();
+
+	/*!
+	 * \brief queues the content of buf for writing to fileId
+	 *
+	 * The content is swapped out: afterwards, buf is an empty buffer that might still have some capacity left from
+	 * an earlier call, so that the caller can refill it without allocating memory.
+	 */
+	void write(FILE* fileId, std::vector<int>& buf);
+
+	//! blocks until all buffers handed in so far have been written, returns false if any fwrite failed
+	bool sync();
+
+private:
+	struct WriteJob {
+		FILE* fileId;
+		std::vector<int> data;
+	};
+
+	//! writes a buffer to file and flushes the file, returns false on error
+	static bool writeJob(WriteJob& job);
+
+	bool hasError_;					//!< set if an fwrite failed since the last call to sync()
+	std::vector< std::vector<int> > freeBuffers_; //!< written buffers, which are recycled by write()
+
+#if !defined(WIN32) && !defined(WIN64)
+	static void* ioThreadMain(void* arg);
+	void ioThreadLoop();
+
+	int maxQueuedBuffers_;
+	std::deque<WriteJob> queue_;	//!< buffers that are waiting to be written
+	bool isWriting_;				//!< whether the I/O thread is currently writing a buffer
+	bool shutdown_;					//!< set in the destructor to make the I/O thread exit
+
+	pthread_mutex_t mutex_;
+	pthread_cond_t jobCond_;		//!< signaled when a buffer is queued (or on shutdown)
+	pthread_cond_t doneCond_;		//!< signaled when the I/O thread has written a buffer
+
+	pthread_t ioThread_;
+#endif
+};
+
+#endif
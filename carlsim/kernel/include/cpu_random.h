@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 2/21/2014
+ */
+
+#ifndef _CPU_RANDOM_H_
+#define _CPU_RANDOM_H_
+
+#include <stdint.h>
+
+/*!
+ * \brief A small, seekable random number stream for the CPU side of the simulator
+ *
+ * Every stream is identified by a global seed and a stream id. Two streams with the same (seed, streamId) pair
+ * produce the same sequence, no matter on which thread or in which order they are consumed. This makes it possible
+ * to split work (e.g., one stream per pre-synaptic neuron when building connections) across any number of threads
+ * and still obtain bit-identical results.
+ *
+ * The generator is SplitMix64: a 64-bit Weyl sequence passed through a bijective mixing function. It is fast, has
+ * a period of 2^64, and needs only 8 bytes of state.
+ */
+class CpuRandomStream {
+public:
+	CpuRandomStream(uint64_t seed=0, uint64_t streamId=0) { setStream(seed, streamId); }
+
+	//! (re-)starts the stream identified by (seed, streamId) from the beginning
+	void setStream(uint64_t seed, uint64_t streamId) {
+		state_ = mix64(mix64(seed) ^ (streamId * 0xD6E8FEB86659FD93ULL));
+	}
+
+	//! returns the next 64 random bits
+	uint64_t next() {
+		state_ += 0x9E3779B97F4A7C15ULL;
+		return mix64(state_);
+	}
+
+	//! returns a uniformly distributed double in [0,1)
+	double nextDouble() {
+		return (next() >> 11) * (1.0/9007199254740992.0); // 53 random bits / 2^53
+	}
+
+	//! returns a uniformly distributed integer in [0,n)
+	uint32_t nextInt(uint32_t n) {
+		return (uint32_t)(((next() >> 32) * n) >> 32);
+	}
+
+private:
+	static uint64_t mix64(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t state_;
+};
+
+/*!
+ * \brief What a random stream is used for
+ *
+ * The purpose makes up the top 8 bits of a stream id (see cpuRandomStreamId), so that streams drawn for different
+ * purposes never coincide. Streams are keyed on the item they are drawn for (a connection and pre-neuron, a group
+ * and neuron, ...), never on the thread that happens to process the item, so that the results do not depend on the
+ * number of threads.
+ */
+enum CpuRandomPurpose {
+	RAND_STREAM_CONNECT      = 0,	//!< building a connection: id = connection id, subId = pre-neuron (relative)
+	RAND_STREAM_NEURON       = 1,	//!< per-neuron parameters: id = group id, subId = neuron (relative)
+	RAND_STREAM_WEIGHT_RESET = 2,	//!< re-initializing weights: id = post-group id, subId = post-neuron (relative)
+	RAND_STREAM_POISSON      = 3	//!< Poisson spike trains (CpuCounterRandom): id = group id, subId = neuron (relative)
+};
+
+//! returns the stream id of a (purpose, id, subId) triple
+inline uint64_t cpuRandomStreamId(CpuRandomPurpose purpose, uint32_t id, uint32_t subId) {
+	return ((uint64_t)purpose << 56) | ((uint64_t)(id & 0xFFFFFF) << 32) | (uint64_t)subId;
+}
+
+// the counter-based generator is plain arithmetic, so that CUDA kernels can use the very same code
+#ifdef __CUDACC__
+	#define CPU_RANDOM_HOST_DEVICE __host__ __device__
+#else
+	#define CPU_RANDOM_HOST_DEVICE
+#endif
+
+/*!
+ * \brief A counter-based random number generator (Philox4x32-10)
+ *
+ * Instead of advancing a hidden state, Philox computes a random block as a keyed bijection of a counter: the same
+ * (key, counter) pair always gives the same four 32-bit numbers. Keying a generator on (seed, stream id) and starting
+ * its counter at a time step therefore gives every stream (e.g., neuron) its own reproducible random sequence, which
+ * can be drawn in any order, on any number of threads, and on the CPU as well as on the GPU.
+ *
+ * See Salmon et al. (2011), "Parallel random numbers: as easy as 1, 2, 3", Proc. SC'11.
+ */
+class CpuCounterRandom {
+public:
+	//! starts the sequence of stream streamId at time step currTime
+	CPU_RANDOM_HOST_DEVICE CpuCounterRandom(uint32_t seed, uint64_t streamId, uint32_t currTime) {
+		key_[0] = seed;
+		key_[1] = (uint32_t)streamId;
+		ctr_[0] = currTime;
+		ctr_[1] = 0;
+		ctr_[2] = (uint32_t)(streamId >> 32);
+		ctr_[3] = 0;
+		pos_ = 4;
+	}
+
+	//! returns the next 32 random bits
+	CPU_RANDOM_HOST_DEVICE uint32_t next() {
+		if (pos_ == 4) {
+			generate(ctr_, key_, out_);
+			ctr_[1]++;
+			pos_ = 0;
+		}
+		return out_[pos_++];
+	}
+
+	//! returns a uniformly distributed float in (0,1], which is safe to pass to log()
+	CPU_RANDOM_HOST_DEVICE float nextFloatOpenClosed() {
+		return (next() + 0.5f) * 2.3283064e-10f; // 2^-32, rounds to 1.0f at the top end
+	}
+
+	//! computes the random block of a counter with Philox4x32-10
+	static CPU_RANDOM_HOST_DEVICE void generate(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+		uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+		uint32_t k0 = key[0], k1 = key[1];
+		for (int r=0; r<10; r++) {
+			uint64_t p0 = (uint64_t)0xD2511F53U * c0;
+			uint64_t p1 = (uint64_t)0xCD9E8D57U * c2;
+			c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+			c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+			c1 = (uint32_t)p1;
+			c3 = (uint32_t)p0;
+			k0 += 0x9E3779B9U;
+			k1 += 0xBB67AE85U;
+		}
+		out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+	}
+
+private:
+	uint32_t key_[2];	//!< (seed, lower half of stream id)
+	uint32_t ctr_[4];	//!< (time step, block index, upper half of stream id, 0)
+	uint32_t out_[4];	//!< the current random block
+	int pos_;			//!< next unused word of out_
+};
+
+#endif
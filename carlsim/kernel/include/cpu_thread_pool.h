@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 2/21/2014
+ */
+
+#ifndef _CPU_THREAD_POOL_H_
+#define _CPU_THREAD_POOL_H_
+
+#include <vector>
+
+#if !defined(WIN32) && !defined(WIN64)
+	#include <pthread.h>
+#endif
+
+/*!
+ * \brief A persistent pool of worker threads used by the CPU_MODE simulation engine
+ *
+ * The pool creates its worker threads once and keeps them alive for the lifetime of the object, so that the
+ * per-millisecond phases of CpuSNN::doSnnSim can be distributed across cores without paying for thread creation
+ * on every time step.
+ * A call to run() hands the same task to all threads (the calling thread participates as thread 0) and returns only
+ * after every thread has finished, which makes each call a barrier-synchronized phase.
+ *
+ * On Windows the pool falls back to executing every task on the calling thread.
+ */
+class CpuThreadPool {
+public:
+	//! task signature: every thread receives the same argument plus its thread id in [0, numThreads)
+	typedef void (*TaskFunc)(void* arg, int threadId, int numThreads);
+
+	//! creates numThreads-1 worker threads (the calling thread acts as thread 0)
+	CpuThreadPool(int numThreads);
+
+	//! signals all worker threads to exit and joins them
+	~CpuThreadPool();
+
+	//! returns the number of threads that execute a task (including the calling thread)
+	int getNumThreads() { return numThreads_; }
+
+	//! executes func on all threads and blocks until every thread has finished
+	void run(TaskFunc func, void* arg);
+
+private:
+	struct WorkerInfo {
+		CpuThreadPool* pool;
+		int threadId;
+	};
+
+	int numThreads_;
+
+#if !defined(WIN32) && !defined(WIN64)
+	static void* workerMain(void* arg);
+	void workerLoop(int threadId);
+
+	TaskFunc taskFunc_;			//!< the task of the current phase
+	void* taskArg_;				//!< the argument of the current phase
+	unsigned long generation_;	//!< incremented every time a new task is posted
+	int numPending_;			//!< number of worker threads that have not yet finished the current task
+	bool shutdown_;				//!< set in the destructor to make all worker threads exit
+
+	pthread_mutex_t mutex_;
+	pthread_cond_t taskCond_;	//!< signaled when a new task is posted (or on shutdown)
+	pthread_cond_t doneCond_;	//!< signaled when the last worker thread has finished the current task
+
+	std::vector<pthread_t> threads_;
+	std::vector<WorkerInfo> workerInfo_;
+#endif
+};
+
+#endif
@@ -2,23 +2,14 @@
 #define _PROPAGATED_SPIKE_BUFFER_H_
 
 ///////////////////////////////////
-// IMPORTED FROM PCSIM SOURCE CODE  http://www.lsm.tugraz.at/pcsim/
+// ORIGINALLY IMPORTED FROM PCSIM SOURCE CODE  http://www.lsm.tugraz.at/pcsim/
 /////////////////////////////////
 
-//#include "globaldefinitions.h"
-//#include "SimParameter.h"
-
-#include <iostream>
-using std::cout;
-using std::endl;
-
-#include <list>
-using std::list;
-
 #include <vector>
 using std::vector;
 
 #include <assert.h>
+#include <stddef.h>		// size_t
 
 typedef int spikegroupid_t ;
 
@@ -28,10 +19,16 @@ typedef unsigned short int delay_t;
 //! Type for specifying the delay in time steps
 typedef unsigned short int delaystep_t;
 
-//! The size of one allocation chunk size in PropagatedSpikeBuffer
-#define PROPAGATED_SPIKE_BUFFER_CHUNK_SIZE 1024
-
 //! Schedule/Store spikes to be delivered at a later point in the simulation
+/*!
+ * The buffer is a ring of time slots. Every slot holds the ids of the neurons scheduled to spike at that time step
+ * in a contiguous array, which is iterated linearly. A slot keeps its capacity when it is cleared, so that after a
+ * few time steps scheduling a spike does not allocate any memory.
+ *
+ * The buffer can be filled in parallel: every thread schedules its spikes into its own shard, and mergeShards()
+ * then appends the shards to the ring in the order of their index. If every thread handles a contiguous range of
+ * neurons (in increasing order), the result is the same as if all spikes were scheduled from a single thread.
+ */
 class PropagatedSpikeBuffer
 {
 
@@ -40,51 +37,39 @@ public:
     //! New spike buffer
     /*! \param minDelay Minimum delay (in number of time steps) the buffer can handle
     *  \param maxDelay Maximum delay (in number of time steps) the buffer can handle
-    *  \param chunkSize Constant used for internal memory management.
-    *                   Should increase with increasing number of synapses and
-    *                   exptected number of spikes.
+    *  \param numShards Number of shards that can be filled in parallel (see scheduleSpikeTargetGroup)
     */
-    PropagatedSpikeBuffer(int minDelay,
-                          int maxDelay,
-                          int chunkSize = PROPAGATED_SPIKE_BUFFER_CHUNK_SIZE );
+    PropagatedSpikeBuffer(int minDelay, int maxDelay, int numShards = 1);
 
     //! Destructor: Deletes all scheduled spikes
     virtual ~PropagatedSpikeBuffer();
 
     //! Schedule a group of spike targets to get a spike at time t + delay
-    /*! \param stg  The identifier of the spike target group to be used as
-     *              identifier in SpikeTargetGroupPool::beginSpikeTarget( stg )
+    /*! \param stg  The identifier of the spike target group (the neuron id)
      *  \param delay The number of time steps to delay the deliver of the spike
      */
-    void scheduleSpikeTargetGroup(spikegroupid_t stg, delaystep_t delay);
-
-    //! Structure which stores the index of the spike target group and a pointer to the next element in various lists
-    struct StgNode
+    inline void scheduleSpikeTargetGroup(spikegroupid_t stg, delaystep_t delay)
     {
-        spikegroupid_t stg;
-        delaystep_t delay;
-        StgNode *next;
-    };
+        assert( delay < length() );
+        ringBuffer[ ( currIdx + delay ) % length() ].push_back( stg );
+    }
 
-    //! Iterator to loop over the scheduled spikes at a certain delay
-    class const_iterator
+    //! Schedule a spike into a shard, the spike is not visible before mergeShards() is called
+    /*! Different threads may call this at the same time, as long as they use different shards.
+     *  \param shard The shard to use, 0 <= shard < numShards
+     */
+    inline void scheduleSpikeTargetGroup(spikegroupid_t stg, delaystep_t delay, int shard)
     {
-    public:
-        const_iterator(): node(NULL) {};
-        const_iterator(StgNode *n): node(n) {};
-
-        StgNode* operator->() { return node; }
-        spikegroupid_t operator*() { return node->stg; }
-
-        bool operator==(const const_iterator& other) { return ( this->node == other.node ); }
+        assert( shard >= 0 && shard < (int)shardBuffer.size() );
+        assert( delay < length() );
+        shardBuffer[shard][ ( currIdx + delay ) % length() ].push_back( stg );
+    }
 
-        bool operator!=(const const_iterator& other) { return ( this->node != other.node ); }
+    //! Append the spikes of all shards to the ring buffer (in the order of the shards), and empty the shards
+    void mergeShards();
 
-        inline const_iterator& operator++() { node = node->next; return *this; }
-
-    private:
-        StgNode *node;
-    };
+    //! Iterator to loop over the scheduled spikes at a certain delay
+    typedef vector< spikegroupid_t >::const_iterator const_iterator;
 
     //! Returns an iterator to loop over all scheduled spike target groups
     /*! \param stepOffset Determines at which position ( current timestep + stepOffset )
@@ -92,19 +77,19 @@ public:
      */
     const_iterator beginSpikeTargetGroups(int stepOffset = 0)
     {
-#ifdef DEBUG
-        // this assertion fails if stepOffset < -length()
-        if (const_iterator( ringBufferFront[ (currIdx + stepOffset + length() ) % length()  ] ) != NULL)
-            //        cout << "in beginSTG currT=" << currT << " stepOffset=" << stepOffset << endl;
-            assert( (currIdx + stepOffset + length() ) % length() >= 0 );
-#endif
-        return const_iterator( ringBufferFront[ (currIdx + stepOffset + length() ) % length()  ] );
+        return getSlot(stepOffset).begin();
     };
 
-    //! End iterator corresponding to beginSynapseGroups
-    const_iterator endSpikeTargetGroups()
+    //! End iterator corresponding to beginSpikeTargetGroups
+    const_iterator endSpikeTargetGroups(int stepOffset = 0)
     {
-        return const_iterator(NULL);
+        return getSlot(stepOffset).end();
+    };
+
+    //! Returns the number of spikes scheduled at time step ( current timestep + stepOffset )
+    size_t numSpikeTargetGroups(int stepOffset = 0)
+    {
+        return getSlot(stepOffset).size();
     };
 
     //! Must be called to tell the buffer that it should move on to the next time step
@@ -117,48 +102,28 @@ public:
     void reset(int minDelay, int maxDelay);
 
     //! Return the actual length of the buffer
-    inline size_t length() { return ringBufferFront.size(); };
-
-    // PropagatedSpikeBuffer & operator=(const PropagatedSpikeBuffer &src);
+    inline size_t length() { return ringBuffer.size(); };
 
 private :
 
-    //! Set up internal memory management
+    //! Set up the time slots of the ring buffer and the shards
     void init(size_t maxDelaySteps);
 
-    //! Get a new StgNode from the internal memory management
-    StgNode *getFreeNode(void);
+    //! Returns the slot of time step ( current timestep + stepOffset ), stepOffset >= -length()
+    inline const vector< spikegroupid_t >& getSlot(int stepOffset)
+    {
+        assert( (int)currIdx + stepOffset + (int)length() >= 0 );
+        return ringBuffer[ ( currIdx + stepOffset + length() ) % length() ];
+    }
 
     //! The index into the ring buffer which corresponds to the current time step
-    int currIdx ;
-
-    //! A ring buffer storing a pointer to the first StgNode of the scheduled spike receiving groups
-    vector< StgNode* > ringBufferFront;
-
-    //! A ring buffer storing a pointer to the last StgNode of the scheduled spike receiving groups
-    vector< StgNode* > ringBufferBack;
-
-    //! Buffer with pointers to chunks of memory allocated
-    vector< StgNode* > chunkBuffer;
-
-    //! Pointer to array of SrgNodes to take from (from position nextFreeSrgNodeIdx)
-    StgNode *currentFreeChunk;
-
-    //! Index into array currentFreeChunk which specifies the next StgNode to use
-    int  nextFreeSrgNodeIdx;
-
-    //! Index into chunkBuffer which specifies the next free chunk of memory to use
-    size_t nextFreeChunkIdx;
-
-    //! Head of list of SrgNodes which can be reused
-    StgNode* recycledNodes;
-
-    //! Number of SrgNodes per chunk of memory to allocate
-    int chunkSize;
+    size_t currIdx ;
 
-    int currT;
+    //! A ring buffer storing the ids of the scheduled spike receiving groups per time step
+    vector< vector< spikegroupid_t > > ringBuffer;
 
-    double fillitup[32];
+    //! Per shard: a ring buffer (aligned with ringBuffer) with the spikes that still need to be merged
+    vector< vector< vector< spikegroupid_t > > > shardBuffer;
 };
 
 #endif /*PROPAGATEDSPIKEBUFFER_H_*/
@@ -75,6 +75,9 @@
 #include <snn_datastructures.h>
 
 #include <propagated_spike_buffer.h>
+#include <cpu_thread_pool.h>
+#include <cpu_random.h>
+#include <async_file_writer.h>
 #include <poisson_rate.h>
 #ifndef __CPU_ONLY__
 	#include <gpu_random.h>
@@ -164,6 +167,10 @@ public:
 	short int connect(int gIDpre, int gIDpost, ConnectionGeneratorCore* conn, float mulSynFast, float mulSynSlow,
 		bool synWtType,	int maxM, int maxPreM);
 
+	//! creates synaptic projections using a batched callback mechanism (see BatchConnectionGenerator)
+	short int connect(int gIDpre, int gIDpost, BatchConnectionGeneratorCore* conn, float mulSynFast, float mulSynSlow,
+		bool synWtType,	int maxM, int maxPreM);
+
 	/* Creates synaptic projections using a callback mechanism.
 	*
 	* \param _grpId1:ID lower layer group
@@ -223,6 +230,18 @@ public:
 	//! Sets the integration method and the number of integration steps per 1ms simulation time step
 	void setIntegrationMethod(integrationMethod_t method, int numStepsPerMs);
 
+	//! Sets the number of threads used to run the simulation in CPU_MODE (1 = single-threaded)
+	void setNumThreads(int numThreads);
+
+	//! Enables/disables the post-ordered copy of synapse data used for spike delivery in CPU_MODE
+	void setPostOrderedSynapses(bool enable);
+
+	//! Enables/disables computing the exponential STDP curves from decaying traces in CPU_MODE
+	void setTraceBasedSTDP(bool enable);
+
+	//! Enables/disables decaying homeostasis variables only when a neuron spikes in CPU_MODE
+	void setLazyDecay(bool enable);
+
 	//! Sets the Izhikevich parameters a, b, c, and d of a neuron group.
 	/*!
 	 * \brief Parameter values for each neuron are given by a normal distribution with mean _a, _b, _c, _d and standard deviation _a_sd, _b_sd, _c_sd, and _d_sd, respectively
@@ -466,9 +485,22 @@ public:
 	 * keyword ALL (for all groups).
 	 * Core and utility functions can call updateSpikeMonitor at any point in time. The function will automatically
 	 * determine the last time it was called, and update SpikeMonitor information only if necessary.
+	 * All monitors that need an update are served in a single pass over the firing tables.
 	 */
 	void updateSpikeMonitor(int grpId=ALL);
 
+	/*!
+	 * \brief writes all buffered spikes to the spike files and waits until they are on disk
+	 *
+	 * updateSpikeMonitor collects the spikes of every spike file in a buffer and hands full buffers to a background
+	 * I/O thread. runNetwork calls this function before it returns, so that the spike files are complete in between
+	 * runs.
+	 */
+	void flushSpikeFiles();
+
+	//! waits until the I/O thread has written all spike buffers handed to it (a spike file must not be closed before)
+	void syncSpikeFileWriter();
+
 	//! Resets either the neuronal firing rate information by setting resetFiringRate = true and/or the
 	//! weight values back to their default values by setting resetWeights = true.
 	void updateNetwork(bool resetFiringInfo, bool resetWeights);
@@ -553,6 +585,7 @@ public:
 	int getNumPreSynapses() { return preSynCnt; }
 	int getNumPostSynapses() { return postSynCnt; }
 
+	int getNumThreads() { return numThreads_; }
 	int getRandSeed() { return randSeed_; }
 
 	simMode_t getSimMode()		{ return simMode_; }
@@ -581,6 +614,19 @@ public:
 
 	std::vector< std::vector<float> > getWeightMatrix2D(short int connId);
 
+	/*!
+	 * \brief copies the weights (magnitudes) of all synapses of a connection into a flat vector
+	 *
+	 * Only the synapses of the connection are visited (see connSynRanges_), by post-synaptic neuron and then in the
+	 * order in which they were created. getConnectionSynapseIds returns the neuron IDs in the same order. wts is only
+	 * reallocated if its capacity is too small, so that it can be reused for every snapshot.
+	 */
+	void getConnectionWeights(short int connId, std::vector<float>& wts);
+
+	//! returns the pre- and post-synaptic neuron IDs (relative to their groups) of all synapses of a connection, in
+	//! the order of getConnectionWeights
+	void getConnectionSynapseIds(short int connId, std::vector<int>& preIds, std::vector<int>& postIds);
+
 	std::vector<float> getConductanceAMPA(int grpId);
 	std::vector<float> getConductanceNMDA(int grpId);
 	std::vector<float> getConductanceGABAa(int grpId);
@@ -637,6 +683,12 @@ private:
 	//! add the entry that the current neuron has spiked
 	int  addSpikeToTable(int id, int g);
 
+	//! lazy homeostasis: factor by which avgFiring of a neuron has decayed since it was last brought up to date
+	float getAvgFiringDecay(int grpId, int nid);
+
+	//! puts a spike of a neuron with 2+ms delays into the delay ring, one entry per occupied delay slot
+	void scheduleSpikeDelivery(int nid);
+
 	void buildGroup(int groupId);
 	void buildNetwork();
 	void buildPoissonGroup(int groupId);
@@ -650,42 +702,134 @@ private:
 	 */
 	void checkSpikeCounterRecordDur();
 
-	void compactConnections(); //!< minimize any other wastage in that array by compacting the store
+	void buildConnectionArrays(); //!< allocates the synaptic arrays with exact size and fills them (pendingSrc_, ...)
+	void clearPendingSynapses(); //!< releases the synapses collected by setConnection
 	void connectFull(grpConnectInfo_t* info);
 	void connectOneToOne(grpConnectInfo_t* info);
 	void connectRandom(grpConnectInfo_t* info);
 	void connectGaussian(grpConnectInfo_t* info);
+
+	/*!
+	 * \brief samples the synapses of a random or gaussian connection
+	 *
+	 * Instead of drawing a random number for every (pre,post) pair, only the post-neurons inside the bounding box of
+	 * the RadiusRF are visited, and the connected ones among them are found by drawing geometric skip lengths. Every
+	 * pre-neuron uses its own CpuRandomStream (seeded from randSeed_, connId, and its relative neuron id), so
+	 * pre-neurons can be processed on the thread pool, and the result does not depend on the number of threads.
+	 */
+	void connectSampled(grpConnectInfo_t* info);
+	void sampleConnections(int startIdx, int endIdx); //!< thread task of connectSampled: one pre-neuron per item
 	void connectUserDefined(grpConnectInfo_t* info);
+	void generateConnections(int startIdx, int endIdx); //!< thread task for a BatchConnectionGenerator
 
 	void deleteObjects();			//!< deallocates all used data structures in snn_cpu.cpp
 
-	void doD1CurrentUpdate();
-	void doD2CurrentUpdate();
+	/*!
+	 * \brief delivers all spikes with a delay of 1ms (firingTableD1) to post-synaptic neurons in [startPostN, endPostN)
+	 *
+	 * If daSpikeCnt is not NULL, dopamine release is counted per post-synaptic group instead of being added to grpDA
+	 * (used in multi-threaded mode, where several threads deliver spikes to the same group).
+	 */
+	void doD1CurrentUpdate(int startPostN, int endPostN, int* daSpikeCnt=NULL);
+
+	//! delivers all spikes with a delay of 2+ms that are due in the current time step (spikeDelayRing_) to
+	//! post-synaptic neurons in [startPostN, endPostN)
+	void doD2CurrentUpdate(int startPostN, int endPostN, int* daSpikeCnt=NULL);
+
+	//! multi-threaded spike delivery: thread t delivers all spikes to its own range of post-synaptic neurons
+	void doCurrentUpdateThreads(int startThreadId, int endThreadId);
 	void doGPUSim();
 	void doSnnSim();
 	void globalStateDecay();
 
 	void findFiring();
+
+	//! applies the STDP update of post-synaptic spikes to the neurons in firedSTDP[startIdx..endIdx)
+	void findFiringSTDP(int startIdx, int endIdx);
+
+	//! returns the E-STDP (isExc) or I-STDP weight change for the last pre-synaptic spike at synapse pos_i, computed
+	//! from the pre-synaptic trace history instead of the lookup table (see buildSTDPTraces)
+	float getSTDPPlusFromTrace(int grpId, bool isExc, int stdp_tDiff, unsigned int pos_i);
+
 	int findGrpId(int nid);//!< For the given neuron nid, find the group id
 
 	//! finds the maximum post-synaptic and pre-synaptic length
 	//! this used to be in updateParameters
 	void findMaxNumSynapses(int* numPostSynapses, int* numPreSynapses);
 
-	void generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD);
+	void generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD,
+		int* daSpikeCnt=NULL);
+
+	//! delivers a spike of pre_i to the synapses of delay bucket bucketIdx whose post-neurons are in
+	//! [startPostN, endPostN)
+	void generatePostSpikes(unsigned int pre_i, unsigned int bucketIdx, int startPostN, int endPostN, int* daSpikeCnt);
 	void generateSpikes();
 	void generateSpikes(int grpId);
 	void generateSpikesFromFuncPtr(int grpId);
 	void generateSpikesFromRate(int grpId);
 
+	/*!
+	 * \brief draws the Poisson spikes of the current time slice of group rateGenGrpId_ (see generateSpikesFromRate)
+	 *
+	 * The neurons of the group are split into one contiguous range per shard of the spike buffer. Every neuron uses a
+	 * counter-based random number generator keyed on (randSeed_, neuron, start of the time slice), so the spike
+	 * trains do not depend on the number of threads.
+	 */
+	void generateSpikesFromRateShards(int startShard, int endShard);
+
 	//! stops the CPU/GPU timer and retrieves actual execution time for printSimSummary
 	float getActualExecutionTimeMs();
 
 	int getPoissNeuronPos(int nid);
-	float getWeights(int connProp, float initWt, float maxWt, unsigned int nid, int grpId);
+	//! returns the initial weight of a synapse, random weights are drawn from rng
+	float getWeights(int connProp, float initWt, float maxWt, unsigned int nid, int grpId, CpuRandomStream& rng);
 
 	void globalStateUpdate();
 
+	//! decays STP variables, homeostatic averages, and conductances of all neurons in [startN, endN)
+	void globalStateDecayNeurons(int startN, int endN);
+
+	//! integrates the membrane potential of all regular neurons in [startN, endN) by a single integration step
+	void globalStateUpdateNeurons(int startN, int endN);
+
+	typedef void (CpuSNN::*GroupStateFunc)(int grpId, int startN, int endN);
+
+	/*!
+	 * \brief picks the specialized update and decay function of every group
+	 *
+	 * Neuron model, integration method, synapse model, compartments, homeostasis, and STP of a group are all fixed
+	 * after setupNetwork. Each combination of these flags is a separate template instantiation of updateGroupState
+	 * and decayGroupState, so that the per-neuron loops don't have to check any flags.
+	 */
+	void selectGroupStateFuncs();
+	template<bool withConductances, bool withNMDArise, bool withGABAbRise>
+	GroupStateFunc selectGroupUpdateFunc(bool withCompartments, bool withParamModel9, bool withRK4);
+	template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments>
+	GroupStateFunc selectGroupUpdateFunc(bool withParamModel9, bool withRK4);
+	template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments, bool withParamModel9>
+	GroupStateFunc selectGroupUpdateFunc(bool withRK4);
+	template<bool withHomeostasis>
+	GroupStateFunc selectGroupDecayFunc(bool withConductances);
+
+	//! single integration step of neurons [startN, endN] of a group
+	template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments, bool withParamModel9,
+		bool withRK4>
+	void updateGroupState(int grpId, int startN, int endN);
+
+	//! decays homeostatic averages and conductances of neurons [startN, endN] of a group
+	template<bool withHomeostasis, bool withConductances, bool withNMDArise, bool withGABAbRise>
+	void decayGroupState(int grpId, int startN, int endN);
+
+	//! sums up synaptic, external, and compartmental current of neurons [startN, endN] of a group into totalCurrent
+	template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments>
+	void updateTotalCurrent(int grpId, int startN, int endN);
+
+	//! single integration step of neurons [startN, endN] of a group (Forward-Euler or RK4, 4- or 9-param Izhikevich)
+	void integrateEulerIzhikevich4(int startN, int endN);
+	void integrateEulerIzhikevich9(int startN, int endN);
+	void integrateRK4Izhikevich4(int startN, int endN);
+	void integrateRK4Izhikevich9(int startN, int endN);
+
 	//! initialize all the synaptic weights to appropriate values.
 	//! total size of the synaptic connection is 'length'
 	void initSynapticWeights();
@@ -708,26 +852,6 @@ private:
 	//! creates CPU net pointers
 	void makePtrInfo();
 
-	/*!
-	 * \brief generates spike times according to a Poisson process
-	 *
-	 * This function generates the next spike time for a Poisson spike generator, given the current spike time
-	 * <tt>currTime</tt>. The function is used in generateSpikesFromRate.
-	 * A Poisson process will always generate inter-spike-interval (ISI) values from an exponential distribution.
-     * The time between each pair of consecutive events has an exponential distribution with parameter \lambda and
-     * each of these ISI values is assumed to be independent of other ISI values.
-     * What follows a Poisson distribution is the actual number of spikes sent during a certain interval.
-     *
-     * The refractory period (in ms) will assert that all spike pairs are at least <tt>refractPeriod</tt> milliseconds
-     * apart (inclusive). That is, the ISI generated from an exponential distribution will be discarded if it turns
-     * out that ISI < refractPeriod
-     * \param[in] currTime       time of current (or "last") spike
-     * \param[in] frate          mean firing rate to be achieved (same as \lambda of the exponential distribution)
-     * \param[in] refractPeriod  refractory period to be honored (in ms)
-     * \returns next spike time (current time plus generated ISI)
-     */
-	unsigned int poissonSpike(unsigned int currTime, float frate, int refractPeriod);
-
 	// NOTE: all these printer functions should be in printSNNInfo.cpp
 	// FIXME: are any of these actually supposed to be public?? they are not yet in carlsim.h
 	void printConnection(const std::string& fname);
@@ -790,6 +914,43 @@ private:
 	void stopCPUTiming();
 
 	void swapConnections(int nid, int oldPos, int newPos);
+	void sortConnectionsByPostId(int nid, int startPos, int endPos);
+
+	/*!
+	 * \brief builds a copy of weights and connection ids in the order of the outgoing (post-synaptic) adjacency
+	 *
+	 * Spike delivery walks postSynapticIds of a pre-neuron, which is sorted by delay and post-neuron id. With this copy,
+	 * weights and connection ids are read from consecutive memory locations instead of through cumulativePre of the
+	 * post-neuron. All per-synapse state that is written during delivery (synSpikeTime, wtChange) is still kept in
+	 * pre-synaptic order, and is reached through postSynPreIdx.
+	 */
+	void buildPostOrderedSynapses();
+
+	/*!
+	 * \brief allocates the STDP traces used instead of evaluating exp() for every synaptic event
+	 *
+	 * Every regular neuron of an STDP group gets a post-synaptic trace per synapse type (E/I), which is set to 1 when
+	 * the neuron fires and is decayed with exp(-TAU_MINUS_INV) every ms, so that it equals exp(-tDiff*TAU_MINUS_INV)
+	 * when a pre-synaptic spike arrives (LTD). Pre-synaptic traces are kept per distinct TAU_PLUS_INV in a history
+	 * buffer of maxDelay_+1 ms (like stpu/stpx), because a spike that arrives at a synapse with delay index tD left
+	 * the pre-neuron tD ms earlier; synDelayIdx holds that tD for every incoming synapse (LTP).
+	 * Traces are reset to 1 rather than incremented, which is the nearest-spike pairing of the exp()-based code.
+	 */
+	void buildSTDPTraces();
+
+	/*!
+	 * \brief tabulates the E-/I-STDP curves of every STDP group (LTP and LTD) over integer spike-time differences
+	 *
+	 * Every table entry holds the value that is added to wtChange for a spike-time difference of stdp_tDiff ms, with
+	 * the sign and shape of the curve (exp, timing-based, pulse) already applied. The table ends at the cutoff of the
+	 * curve (stdp_tDiff*TAU_INV >= 25 for exponentials, DELTA for the pulse curve), so that findFiringSTDP and
+	 * generatePostSpike only need a bounds check and a load instead of exp().
+	 */
+	void buildSTDPLookupTables();
+
+	//! sets the lookup tables of a group to consecutive entries in buf and fills them (if buf!=NULL), returns the
+	//! number of entries used
+	int fillSTDPLookupTables(int grpId, float* buf);
 
 	void updateAfterMaxTime();
 	void updateFiringTable();
@@ -806,8 +967,53 @@ private:
 
 	// float updateTotalCurrent(bool cEval, int cId, int I, int G, float* COUPL_CONSTANTS, int* cNeighbors, int nNeighbors, float const_1, float const_2);
 
+	/*!
+	 * \brief applies the accumulated weight changes of all plastic synapses
+	 *
+	 * The STDP type, dopamine level and STDP scale factor of every group are folded into per-group coefficients
+	 * first, so that the update of a single synapse is a multiply-add and a clamp, without branches.
+	 *
+	 * In groups with STANDARD STDP and without homeostasis, only neurons whose wtChange was touched by STDP since the
+	 * last update (wtChangePending) are visited. With wtChangeDecay_ == 0 the others have no weight change at all.
+	 * Otherwise, their decaying weight changes are applied lazily by catchUpWeightsNeurons, before the weights are
+	 * used or touched again.
+	 */
 	void updateWeights();
 
+	//! updates the plastic synapses of all regular neurons in [startN, endN) (see updateWeights)
+	void updateWeightsNeurons(int startN, int endN);
+
+	/*!
+	 * \brief applies the weight updates that neurons in [startN, endN) were skipped in (see updateWeights)
+	 *
+	 * Skipping k updates with a decaying weight change is the same as adding the geometric sum of the k changes at
+	 * once. All changes of a synapse have the same sign, so clamping once at the end gives the same weight.
+	 */
+	void catchUpWeightsNeurons(int startN, int endN);
+
+	//! a CpuSNN member that processes the work items [startIdx, endIdx) of a multi-threaded phase
+	typedef void (CpuSNN::*ThreadTask)(int startIdx, int endIdx);
+
+	/*!
+	 * \brief runs a phase of the CPU simulation on the thread pool
+	 *
+	 * The work items [0, numItems) are split into contiguous, equally sized chunks, one per thread. The call returns
+	 * after all threads are done, so consecutive calls act as barrier-synchronized phases. Without a thread pool
+	 * (single-threaded mode), the task is simply called on the whole range.
+	 */
+	void runThreadTask(ThreadTask task, int numItems);
+	static void runThreadTaskChunk(void* snn, int threadId, int numThreads); //!< thread pool entry point
+
+	/*!
+	 * \brief builds a connection block by block of pre-neurons
+	 *
+	 * For every block of CONN_SAMPLE_BLOCK_SIZE pre-neurons, the task fills connBlockSynapses_ (one vector per
+	 * pre-neuron), either on the thread pool (if parallel is true) or on the calling thread. The synapses are then
+	 * handed to setConnection in the order of the pre-neurons. A task that runs into an error reports it, flags its
+	 * range in connBlockFailed_ and returns: the simulation is then exited on the calling thread.
+	 */
+	void connectBlocks(grpConnectInfo_t* info, ThreadTask task, bool parallel);
+
 
 	// +++++ GPU MODE +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 	// TODO: consider moving to snn_gpu.h
@@ -930,6 +1136,20 @@ private:
 	//! temporary variables created and deleted by network after initialization
 	uint8_t			*tmp_SynapticDelay;
 
+	//! the synapses created by setConnection, in creation order. They are stored column-wise, so that
+	//! buildConnectionArrays can release every column as soon as it has been copied into the synaptic arrays.
+	std::vector<unsigned int>	pendingSrc_;		//!< pre-synaptic neuron id
+	std::vector<unsigned int>	pendingDest_;		//!< post-synaptic neuron id
+	std::vector<unsigned short>	pendingPostSlot_;	//!< position in the post list of src (Npost[src] at creation)
+	std::vector<unsigned short>	pendingPreSlot_;	//!< position in the pre list of dest (Npre[dest] at creation)
+	std::vector<float>			pendingWt_;			//!< initial weight (signed)
+	std::vector<float>			pendingMaxWt_;		//!< max weight (signed)
+	std::vector<short int>		pendingConnId_;		//!< connection id
+	std::vector<uint8_t>		pendingDelay_;		//!< synaptic delay (ms)
+
+	//! per connection: where its synapses are in the pre-synaptic arrays (one range per post-synaptic neuron)
+	std::vector< std::vector<syn_range_t> > connSynRanges_;
+
 	bool simulatorDeleted;
 	bool spikeRateUpdated;
 
@@ -951,8 +1171,6 @@ private:
 	int             numCompartmentConnections; //!< number of connectCompartment calls
 	//! keeps track of total neurons/presynapses/postsynapses currently allocated
 	unsigned int	allocatedN;
-	unsigned int	allocatedPre;
-	unsigned int	allocatedPost;
 	//! keeps track of allocated compartmentalNeurons
 	unsigned int    allocatedComp;
 
@@ -967,6 +1185,59 @@ private:
 	//! Buffer to store spikes
 	PropagatedSpikeBuffer* pbuf;
 
+	//! multi-threaded CPU mode
+	int numThreads_;				//!< number of threads used in CPU_MODE
+	CpuThreadPool* threadPool_;		//!< persistent worker threads (NULL in single-threaded mode)
+	ThreadTask threadTask_;			//!< the task of the current multi-threaded phase
+	int threadTaskNumItems_;		//!< the number of work items of the current multi-threaded phase
+	int* firedSTDP;					//!< regular neurons with STDP that fired in the current time step
+	int numFiredSTDP;				//!< number of valid entries in firedSTDP
+	int* threadPostStartN_;			//!< thread t delivers spikes to post-neurons [threadPostStartN_[t], threadPostStartN_[t+1])
+	int* threadDASpikeCnt_;			//!< per thread and group: number of dopaminergic spikes delivered in current time step
+	grpConnectInfo_t* connBlockInfo_;	//!< the connection currently built by connectBlocks
+	int connBlockPreStartN_;			//!< first pre-neuron of the block currently built by connectBlocks
+	std::vector< std::vector<pending_synapse_t> > connBlockSynapses_; //!< per pre-neuron of the block: its synapses
+	std::vector<char> connBlockFailed_;	//!< per task range of the block (at its startIdx): whether it hit an error
+	int rateGenGrpId_;				//!< the group whose Poisson spikes are drawn by generateSpikesFromRateShards
+
+	//! post-ordered synapse storage (see buildPostOrderedSynapses)
+	bool withPostOrderedSynapses_;	//!< whether to build the post-ordered copy in setupNetwork
+	unsigned int* postSynPreIdx;	//!< per outgoing synapse: index into the pre-synaptic arrays (wt, synSpikeTime, ...)
+	unsigned int* preSynPostIdx;	//!< per incoming synapse: index into the post-ordered arrays (inverse of postSynPreIdx)
+	float* postSynWt;				//!< weights in post-synaptic order, mirrors wt
+	short int* postSynConnId;		//!< connection ids in post-synaptic order, mirrors cumConnIdPre
+
+	//! STDP lookup tables per group (see buildSTDPLookupTables)
+	float* stdpLUTBuf;						//!< storage of all STDP lookup tables
+	stdp_lut_t ltpExcLUT_[MAX_GRP_PER_SNN];	//!< E-STDP, post-synaptic neuron fires after the pre-synaptic spike
+	stdp_lut_t ltdExcLUT_[MAX_GRP_PER_SNN];	//!< E-STDP, post-synaptic neuron fires before the pre-synaptic spike
+	stdp_lut_t ltpInbLUT_[MAX_GRP_PER_SNN];	//!< I-STDP, post-synaptic neuron fires after the pre-synaptic spike
+	stdp_lut_t ltdInbLUT_[MAX_GRP_PER_SNN];	//!< I-STDP, post-synaptic neuron fires before the pre-synaptic spike
+
+	wt_update_coeff_t wtUpdateCoeff_[MAX_GRP_PER_SNN];	//!< per group: coefficients of the current updateWeights call
+
+	//! skip-list of the weight update (see updateWeights)
+	uint8_t* wtChangePending;		//!< per regular neuron: whether STDP touched its wtChange since the last update
+	unsigned int* wtUpdateLast;		//!< per regular neuron: value of wtUpdateCnt_ its weights are up to date with
+	unsigned int wtUpdateCnt_;		//!< number of weight updates so far
+
+	//! trace-based STDP (see buildSTDPTraces)
+	bool withTraceBasedSTDP_;		//!< whether to allocate STDP traces in setupNetwork
+	bool withLazyDecay_;			//!< whether homeostasis is decayed in closed form at spikes (see addSpikeToTable)
+	float* stdpPostTraceExc;		//!< per regular neuron: E-STDP post-synaptic trace, exp(-tDiff*TAU_MINUS_INV_EXC)
+	float* stdpPostTraceInb;		//!< per regular neuron: I-STDP post-synaptic trace, exp(-tDiff*TAU_MINUS_INV_INB)
+	float* stdpPreTrace;			//!< per slot, per neuron: pre-synaptic trace history, indexed with STP_BUF_POS
+	uint8_t* synDelayIdx;			//!< per incoming synapse: delay index tD (delay-1) of the synapse
+	int numSTDPPreTraceSlots_;		//!< number of distinct pre-synaptic trace time constants
+	float stdpPreTraceDecay_[2*MAX_GRP_PER_SNN];	//!< per slot: decay factor exp(-TAU_PLUS_INV) per ms
+	int stdpPreTraceSlotExc_[MAX_GRP_PER_SNN];		//!< per post-group: slot of its E-STDP pre trace (-1 if none)
+	int stdpPreTraceSlotInb_[MAX_GRP_PER_SNN];		//!< per post-group: slot of its I-STDP pre trace (-1 if none)
+	float stdpPostTraceDecayExc_[MAX_GRP_PER_SNN];	//!< per group: decay factor exp(-TAU_MINUS_INV_EXC) per ms
+	float stdpPostTraceDecayInb_[MAX_GRP_PER_SNN];	//!< per group: decay factor exp(-TAU_MINUS_INV_INB) per ms
+
+	GroupStateFunc grpUpdateFunc_[MAX_GRP_PER_SNN];	//!< specialized update function per group (NULL for Poisson)
+	GroupStateFunc grpDecayFunc_[MAX_GRP_PER_SNN];	//!< specialized decay function per group
+
 	bool sim_with_conductances;		//!< flag to inform whether we run in COBA mode (true) or CUBA mode (false)
 	bool sim_with_NMDA_rise;	//!< a flag to inform whether to compute NMDA rise time
 	bool sim_with_GABAb_rise;	//!< a flag to inform whether to compute GABAb rise time
@@ -1006,6 +1277,7 @@ private:
 	float       	*voltage;			//!< membrane potential for each regular neuron
 	float           *nextVoltage;		//!< membrane potential buffer (next/future time step) for each regular neuron
 	float           *recovery, *Izh_C, *Izh_k, *Izh_vr, *Izh_vt, *Izh_vpeak, *Izh_a, *Izh_b, *Izh_c, *Izh_d, *current, *extCurrent;
+	float           *totalCurrent;		//!< synaptic + external + compartmental current, computed in globalStateUpdate
 
 	//! Keeps track of all neurons that spiked at current time.
 	//! Because integration step can be < 1ms we might want to keep integrating but remember that the neuron fired,
@@ -1027,11 +1299,14 @@ private:
 	//added to include homeostasis. -- KDC
 	float					*baseFiring;
 	float                 *avgFiring;
+	uint32_t              *avgFiringTime;	//!< with lazy decay: first time step whose decay of avgFiring is still due
 	unsigned int		*cumulativePost;
 	unsigned int		*cumulativePre;
 	post_info_t		*preSynapticIds;
-	post_info_t		*postSynapticIds;		//!< 10 bit syn id, 22 bit neuron id, ordered based on delay
-	delay_info_t    *postDelayInfo;      	//!< delay information
+	post_info_t		*postSynapticIds;		//!< neuron, group and synapse id, ordered based on delay
+	delay_info_t    *postDelayInfo;      	//!< dense numN*(maxDelay_+1) delay table, only allocated in GPU_MODE
+	delay_bucket_t  *postDelayBuckets;		//!< one entry per neuron and delay in use, ordered by delay
+	unsigned int    *postDelayBucketCum;	//!< the buckets of neuron i are [postDelayBucketCum[i], postDelayBucketCum[i+1])
 
 	//! size of memory used for different parts of the network
 	typedef struct snnSize_s {
@@ -1058,6 +1333,14 @@ private:
 	unsigned int		maxSpikesD1;
 	unsigned int		maxSpikesD2;
 
+	/*!
+	 * \brief spikes of neurons with 2+ms delays, bucketed by the time step in which they are due for delivery
+	 *
+	 * Bucket simTime%maxDelay_ holds all (neuron, delay index) pairs that are delivered in the current time step, in
+	 * the order in which the neurons fired. The firing tables are still updated for the spike monitors.
+	 */
+	std::vector<delayed_spike_t>* spikeDelayRing_;
+
 	//time and timestep
 
 	unsigned int    simTimeRunStart; //!< the start time of current/last runNetwork call
@@ -1095,6 +1378,7 @@ private:
 	unsigned int numSpikeMonitor;
 	SpikeMonitorCore* spikeMonCoreList[MAX_GRP_PER_SNN];
 	SpikeMonitor*     spikeMonList[MAX_GRP_PER_SNN];
+	AsyncFileWriter*  spikeFileWriter_;	//!< writes the spike files in the background (created on first use)
 
 	// \FIXME \DEPRECATED this one moved to group-based
 	int64_t    simTimeLastUpdSpkMon_; //!< last time we ran updateSpikeMonitor
@@ -1130,8 +1414,12 @@ private:
 	/* Tsodyks & Markram (1998), where the short-term dynamics of synapses is characterized by three parameters:
 	   U (which roughly models the release probability of a synaptic vesicle for the first spike in a train of spikes),
 	   maxDelay_ (time constant for recovery from depression), and F (time constant for recovery from facilitation). */
-	   float *stpu;
-	   float *stpx;
+	   float *stpu;		//!< GPU_MODE: u per neuron and time step, indexed with STP_BUF_POS
+	   float *stpx;		//!< GPU_MODE: x per neuron and time step, indexed with STP_BUF_POS
+	   float *stpLastU;	//!< CPU_MODE: u^+ (right after the last spike) per neuron of an STP group
+	   float *stpLastX;	//!< CPU_MODE: x^- (right before the last spike) per neuron of an STP group
+	   int numNSTP_;		//!< CPU_MODE: number of neurons in STP groups
+	   int stpGrpOffset_[MAX_GRP_PER_SNN];	//!< CPU_MODE: index of the first neuron of a group in stpLastU/stpLastX
 
 	   float *gAMPA;
 	   float *gNMDA;
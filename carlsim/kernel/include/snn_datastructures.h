@@ -53,9 +53,53 @@ typedef struct {
 	short  delay_length;
 } delay_info_t;
 
+//! a synapse that has been created by a connect call, but has not yet been put into the synaptic arrays
 typedef struct {
-	int	postId;
-	uint8_t	grpId;
+	unsigned int src;		//!< pre-synaptic neuron id
+	unsigned int dest;		//!< post-synaptic neuron id
+	float        wt;		//!< initial weight (signed)
+	float        maxWt;		//!< max weight (signed)
+	short int    connId;	//!< connection id
+	uint8_t      delay;		//!< synaptic delay (ms)
+} pending_synapse_t;
+
+//! the synapses of a post-synaptic neuron that belong to one connection, a contiguous range in the pre-synaptic arrays
+typedef struct {
+	unsigned int start;		//!< position of the first synapse in the pre-synaptic arrays (wt, preSynapticIds, ...)
+	unsigned int length;	//!< number of synapses
+	int          nid;		//!< post-synaptic neuron id
+} syn_range_t;
+
+//! the outgoing synapses of a neuron that share the same delay (see CpuSNN::postDelayBuckets)
+typedef struct {
+	unsigned short delay_index_start;	//!< first synapse of the bucket, relative to cumulativePost of the neuron
+	unsigned short delay_length;		//!< number of synapses in the bucket
+	uint8_t tD;							//!< delay index: the synapses have a delay of tD+1 ms
+} delay_bucket_t;
+
+//! a spike of neuron nid that is due for delivery to all synapses of one delay bucket (see postDelayBuckets)
+typedef struct {
+	int   nid;
+	unsigned int delayBucket;
+} delayed_spike_t;
+
+//! weight change per spike-time difference of one STDP curve (see CpuSNN::buildSTDPLookupTables)
+typedef struct {
+	float* wtChange;	//!< value added to wtChange for a spike-time difference of 0..len-1 ms
+	int    len;			//!< spike-time differences >= len lie beyond the cutoff of the curve
+} stdp_lut_t;
+
+//! per-group coefficients of the weight update wt = wt*a + wtChange*b (see CpuSNN::updateWeights)
+typedef struct {
+	float changeExc;	//!< factor applied to wtChange of excitatory synapses (STDP scale factor, dopamine)
+	float changeInb;	//!< factor applied to wtChange of inhibitory synapses (STDP scale factor, dopamine)
+	float homeoRate;	//!< 1/avgTimeScale, only used if the group has homeostasis
+	bool  onlyPending;	//!< whether neurons without new STDP contributions can be skipped (see wtChangePending)
+} wt_update_coeff_t;
+
+//! neuron id (lower 32 bit), group id (next 8 bit) and synapse id (upper 24 bit) of a synapse, see SET_CONN_ID
+typedef struct {
+	uint64_t postId;
 } post_info_t;
 
 
@@ -129,6 +173,7 @@ typedef struct connectData_s {
 	int                      ConnectionMonitorId;
 	uint32_t  				 connProp;
 	ConnectionGeneratorCore* conn;
+	BatchConnectionGeneratorCore* batchConn;			//!< used instead of conn if not NULL
 	conType_t 				 type;
 	float					 p; 						//!< connection probability
 	short int				 connId;					//!< connectID of the element in the linked list
@@ -198,10 +243,11 @@ typedef struct network_ptr_s {
 	short int* grpIds;
 
 	/*!
-	 * \brief 10 bit syn id, 22 bit neuron id, ordered based on delay
+	 * \brief 24 bit syn id, 8 bit group id, 32 bit neuron id, ordered based on delay
 	 *
-	 * allows maximum synapses of 1024 and maximum network size of 4 million neurons, with 64 bit representation. we can
-	 * have larger networks for simulation
+	 * These are the capacities of the bit fields only: the actual limits are lower. The synapse counts of a neuron
+	 * (Npre, Npost, delay_bucket_t) are 16 bit, and connections are limited to MAX_nPostSynapses outgoing and
+	 * MAX_nPreSynapses incoming synapses per neuron. The number of neurons (numN) is an int.
 	 */
 	post_info_t*	postSynapticIds;
 
@@ -279,7 +325,7 @@ typedef struct group_info_s {
 	int			homeoId;
 	bool		FixedInputWts;
 	int			Noffset;
-	int8_t		MaxDelay;
+	uint8_t		MaxDelay;
 
 	int64_t    lastSTPupdate;
 	float 		STP_A;
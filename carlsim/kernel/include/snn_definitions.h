@@ -126,15 +126,24 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 #define KERNEL_INFO_PRINT(fp, formatc, ...) fprintf((FILE*)fp,formatc "\n",##__VA_ARGS__)
 #define KERNEL_DEBUG_PRINT(fp, type, formatc, ...) fprintf((FILE*)fp,"[" type " %s:%d] " formatc "\n",__FILE__,__LINE__,##__VA_ARGS__)
 
+// pointers that don't alias any other pointer in the same scope (lets the compiler vectorize CPU kernels)
+#if defined(WIN32) || defined(WIN64)
+	#define RESTRICT __restrict
+#else
+	#define RESTRICT __restrict__
+#endif
+
 
 #define MAX_nPostSynapses 10000
 #define MAX_nPreSynapses 20000
-#define MAX_SynapticDelay 20
+#define MAX_SynapticDelay 255		//!< CPU_MODE: delays are stored as uint8_t, outgoing synapses are bucketed by delay
+#define MAX_SynapticDelay_GPU 20	//!< GPU_MODE: the dense postDelayInfo table and the timing tables scale with it
 
 // increasing the following numbers will increase the load on constant memory
 // until a hard limit is reached, which is given by the datatype of the variable
 #define MAX_nConnections 256	// hard limit: 2^16
 #define MAX_GRP_PER_SNN 128		// hard limit: 2^16
+#define CONN_SAMPLE_BLOCK_SIZE 1024	// pre-neurons whose random/gaussian synapses are sampled in one parallel batch
 
 #define UNKNOWN_NEURON_MAX_FIRING_RATE    	25
 #define INHIBITORY_NEURON_MAX_FIRING_RATE 	1000
@@ -142,6 +151,8 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 #define POISSON_MAX_FIRING_RATE 	  		1000
 
 #define STDP(t,a,b)       ((a)*exp(-(t)*(b))) // consider to use __expf(), which is accelerated by GPU hardware
+#define STDP_TRACE_MIN    (1e-12f) // STDP traces below this are flushed to zero (STDP() is cut off at exp(-25) anyway)
+#define STDP_LUT_MAX_LEN  10000   // max length (ms) of an STDP lookup table, longer curves are cut off with a warning
 
 #define PROPAGATED_BUFFER_SIZE  (1023)
 #define MAX_SIMULATION_TIME     ((uint32_t)(0x7fffffff))
@@ -151,6 +162,16 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 #define MAX_SPIKE_MON_BUFFER_SIZE 52428800 // about 50 MB. size is in bytes. Max size of reduced AER vector in spikeMonitorCore objects.
 #define LONG_SPIKE_MON_DURATION 600000 // about 10 minutes
 #define LARGE_SPIKE_MON_GRP_SIZE 5000 // about 10 minutes
+#define SPIKE_MON_CHUNK_SIZE 65536 // number of spikes per chunk of the (time,nid) columns of a SpikeMonitor
+#define SPIKE_MON_COUNT_WINDOW_MS 100 // default length of the count windows of a SpikeMonitor in COUNT mode
+#define SPIKE_MON_COUNT_WINDOW_BINS 10 // a count window of a SpikeMonitor in COUNT mode slides in steps of (at most) 1/10 of its length
+#define SPIKE_MON_ISI_BIN_MS 1 // default bin size of the ISI histogram of a SpikeMonitor in COUNT mode
+#define SPIKE_MON_ISI_NUM_BINS 100 // default number of bins of the ISI histogram of a SpikeMonitor in COUNT mode
+#define SPIKE_FILE_BUFFER_SIZE 131072 // number of ints (time,nid pairs) a spike file collects before it is written
+#define SPIKE_FILE_MAX_QUEUED_BUFFERS 8 // max number of full spike file buffers waiting for the I/O thread
+
+#define CONN_FILE_SNAPSHOT_DELTA     (1 << 0) // snapshot only contains the synapses that changed since the last one
+#define CONN_FILE_SNAPSHOT_QUANTIZED (1 << 1) // snapshot stores weights as uint16 multiples of a quantization step
 
 // This flag is used when having a common poisson generator for both CPU and GPU simulation
 // We basically use the CPU poisson generator. Evaluate if there is any firing due to the
@@ -164,13 +185,15 @@ inline bool isInhibitoryNeuron (unsigned int& nid, unsigned int& numNInhPois, un
 // add noise to neuron current
 // #define NEURON_NOISE
 
-#define CONN_SYN_NEURON_BITS	20                               //!< last 20 bit denote neuron id. 1 Million neuron possible
-#define CONN_SYN_BITS			(32 -  CONN_SYN_NEURON_BITS)	 //!< remaining 12 bits denote connection id
-#define CONN_SYN_NEURON_MASK    ((1 << CONN_SYN_NEURON_BITS) - 1)
-#define CONN_SYN_MASK      		((1 << CONN_SYN_BITS) - 1)
-#define GET_CONN_NEURON_ID(a) (((unsigned int)a.postId) & CONN_SYN_NEURON_MASK)
-#define GET_CONN_SYN_ID(b)    (((unsigned int)b.postId) >> CONN_SYN_NEURON_BITS)
-#define GET_CONN_GRP_ID(c)    (c.grpId)
+#define CONN_SYN_NEURON_BITS	32                               //!< lower 32 bit denote neuron id
+#define CONN_SYN_GRP_BITS		8                                //!< next 8 bit denote group id
+#define CONN_SYN_BITS			(64 - CONN_SYN_NEURON_BITS - CONN_SYN_GRP_BITS) //!< remaining 24 bits denote synapse id
+#define CONN_SYN_NEURON_MASK    ((1ULL << CONN_SYN_NEURON_BITS) - 1)
+#define CONN_SYN_GRP_MASK       ((1ULL << CONN_SYN_GRP_BITS) - 1)
+#define CONN_SYN_MASK      		((1ULL << CONN_SYN_BITS) - 1)
+#define GET_CONN_NEURON_ID(a) ((unsigned int)((a).postId & CONN_SYN_NEURON_MASK))
+#define GET_CONN_SYN_ID(b)    ((unsigned int)((b).postId >> (CONN_SYN_NEURON_BITS + CONN_SYN_GRP_BITS)))
+#define GET_CONN_GRP_ID(c)    ((unsigned int)(((c).postId >> CONN_SYN_NEURON_BITS) & CONN_SYN_GRP_MASK))
 //#define SET_CONN_ID(a,b)      ((b) > CONN_SYN_MASK) ? (fprintf(stderr, "Error: Syn Id exceeds maximum limit (%d)\n", CONN_SYN_MASK)): (((b)<<CONN_SYN_NEURON_BITS)+((a)&CONN_SYN_NEURON_MASK))
 
 
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 2/21/2014
+ */
+#include <async_file_writer.h>
+
+#include <assert.h>
+
+bool AsyncFileWriter::writeJob(WriteJob& job) {
+	bool success = true;
+	if (!job.data.empty())
+		success = fwrite(&job.data[0], sizeof(int), job.data.size(), job.fileId) == job.data.size();
+	return (fflush(job.fileId) == 0) && success;
+}
+
+#if defined(WIN32) || defined(WIN64)
+
+AsyncFileWriter::AsyncFileWriter(int maxQueuedBuffers) : hasError_(false) {
+	assert(maxQueuedBuffers >= 1);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {}
+
+void AsyncFileWriter::write(FILE* fileId, std::vector<int>& buf) {
+	assert(fileId != NULL);
+	WriteJob job;
+	job.fileId = fileId;
+	job.data.swap(buf);
+	if (!writeJob(job))
+		hasError_ = true;
+
+	// hand the buffer back, so that its capacity is not lost
+	job.data.clear();
+	buf.swap(job.data);
+}
+
+bool AsyncFileWriter::sync() {
+	bool success = !hasError_;
+	hasError_ = false;
+	return success;
+}
+
+#else
+
+AsyncFileWriter::AsyncFileWriter(int maxQueuedBuffers) : hasError_(false), maxQueuedBuffers_(maxQueuedBuffers),
+	isWriting_(false), shutdown_(false)
+{
+	assert(maxQueuedBuffers >= 1);
+
+	pthread_mutex_init(&mutex_, NULL);
+	pthread_cond_init(&jobCond_, NULL);
+	pthread_cond_init(&doneCond_, NULL);
+
+	pthread_create(&ioThread_, NULL, &AsyncFileWriter::ioThreadMain, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+	// the I/O thread empties the queue before it exits
+	pthread_mutex_lock(&mutex_);
+	shutdown_ = true;
+	pthread_cond_signal(&jobCond_);
+	pthread_mutex_unlock(&mutex_);
+
+	pthread_join(ioThread_, NULL);
+
+	pthread_cond_destroy(&doneCond_);
+	pthread_cond_destroy(&jobCond_);
+	pthread_mutex_destroy(&mutex_);
+}
+
+void AsyncFileWriter::write(FILE* fileId, std::vector<int>& buf) {
+	assert(fileId != NULL);
+
+	pthread_mutex_lock(&mutex_);
+	// bounded queue: wait until the I/O thread catches up
+	while ((int)queue_.size() >= maxQueuedBuffers_)
+		pthread_cond_wait(&doneCond_, &mutex_);
+
+	queue_.push_back(WriteJob());
+	queue_.back().fileId = fileId;
+	queue_.back().data.swap(buf);
+
+	// hand out a recycled buffer
+	if (!freeBuffers_.empty()) {
+		buf.swap(freeBuffers_.back());
+		freeBuffers_.pop_back();
+	}
+
+	pthread_cond_signal(&jobCond_);
+	pthread_mutex_unlock(&mutex_);
+}
+
+bool AsyncFileWriter::sync() {
+	pthread_mutex_lock(&mutex_);
+	while (!queue_.empty() || isWriting_)
+		pthread_cond_wait(&doneCond_, &mutex_);
+	bool success = !hasError_;
+	hasError_ = false;
+	pthread_mutex_unlock(&mutex_);
+
+	return success;
+}
+
+void* AsyncFileWriter::ioThreadMain(void* arg) {
+	((AsyncFileWriter*)arg)->ioThreadLoop();
+	return NULL;
+}
+
+void AsyncFileWriter::ioThreadLoop() {
+	WriteJob job;
+
+	pthread_mutex_lock(&mutex_);
+	while (true) {
+		while (queue_.empty() && !shutdown_)
+			pthread_cond_wait(&jobCond_, &mutex_);
+		if (queue_.empty())
+			break; // shutdown, and everything has been written
+
+		// take the job out of the queue, but keep isWriting_ set until it is on disk
+		job.fileId = queue_.front().fileId;
+		job.data.swap(queue_.front().data);
+		queue_.pop_front();
+		isWriting_ = true;
+		pthread_mutex_unlock(&mutex_);
+
+		bool success = writeJob(job);
+		job.data.clear();
+
+		pthread_mutex_lock(&mutex_);
+		isWriting_ = false;
+		if (!success)
+			hasError_ = true;
+		freeBuffers_.push_back(std::vector<int>());
+		freeBuffers_.back().swap(job.data);
+		pthread_cond_broadcast(&doneCond_);
+	}
+	pthread_mutex_unlock(&mutex_);
+}
+
+#endif
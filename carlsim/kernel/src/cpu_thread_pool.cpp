@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2014 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * *********************************************************************************************** *
+ * CARLsim
+ * created by: 		(MDR) Micah Richert, (JN) Jayram M. Nageswaran
+ * maintained by:	(MA) Mike Avery <averym@uci.edu>, (MB) Michael Beyeler <mbeyeler@uci.edu>,
+ *					(KDC) Kristofor Carlson <kdcarlso@uci.edu>
+ *					(TSC) Ting-Shuo Chou <tingshuc@uci.edu>
+ *
+ * CARLsim available from http://socsci.uci.edu/~jkrichma/CARLsim/
+ * Ver 2/21/2014
+ */
+
+#include <cpu_thread_pool.h>
+
+#include <assert.h>
+
+#if defined(WIN32) || defined(WIN64)
+
+CpuThreadPool::CpuThreadPool(int numThreads) {
+	assert(numThreads >= 1);
+	numThreads_ = 1; // no worker threads on Windows, run everything on the calling thread
+}
+
+CpuThreadPool::~CpuThreadPool() {}
+
+void CpuThreadPool::run(TaskFunc func, void* arg) {
+	func(arg, 0, 1);
+}
+
+#else
+
+CpuThreadPool::CpuThreadPool(int numThreads) : numThreads_(numThreads), taskFunc_(NULL), taskArg_(NULL),
+	generation_(0), numPending_(0), shutdown_(false)
+{
+	assert(numThreads >= 1);
+
+	pthread_mutex_init(&mutex_, NULL);
+	pthread_cond_init(&taskCond_, NULL);
+	pthread_cond_init(&doneCond_, NULL);
+
+	// thread 0 is the calling thread, so we only need to spawn numThreads-1 workers
+	threads_.resize(numThreads_-1);
+	workerInfo_.resize(numThreads_-1);
+	for (int t=1; t<numThreads_; t++) {
+		workerInfo_[t-1].pool = this;
+		workerInfo_[t-1].threadId = t;
+		pthread_create(&threads_[t-1], NULL, &CpuThreadPool::workerMain, &workerInfo_[t-1]);
+	}
+}
+
+CpuThreadPool::~CpuThreadPool() {
+	pthread_mutex_lock(&mutex_);
+	shutdown_ = true;
+	pthread_cond_broadcast(&taskCond_);
+	pthread_mutex_unlock(&mutex_);
+
+	for (unsigned int t=0; t<threads_.size(); t++)
+		pthread_join(threads_[t], NULL);
+
+	pthread_cond_destroy(&doneCond_);
+	pthread_cond_destroy(&taskCond_);
+	pthread_mutex_destroy(&mutex_);
+}
+
+void CpuThreadPool::run(TaskFunc func, void* arg) {
+	if (numThreads_ == 1) {
+		func(arg, 0, 1);
+		return;
+	}
+
+	// post the task to all worker threads
+	pthread_mutex_lock(&mutex_);
+	taskFunc_ = func;
+	taskArg_ = arg;
+	numPending_ = numThreads_-1;
+	generation_++;
+	pthread_cond_broadcast(&taskCond_);
+	pthread_mutex_unlock(&mutex_);
+
+	// the calling thread does its share of the work
+	func(arg, 0, numThreads_);
+
+	// barrier: wait for all worker threads to finish
+	pthread_mutex_lock(&mutex_);
+	while (numPending_ > 0)
+		pthread_cond_wait(&doneCond_, &mutex_);
+	pthread_mutex_unlock(&mutex_);
+}
+
+void* CpuThreadPool::workerMain(void* arg) {
+	WorkerInfo* info = (WorkerInfo*)arg;
+	info->pool->workerLoop(info->threadId);
+	return NULL;
+}
+
+void CpuThreadPool::workerLoop(int threadId) {
+	unsigned long lastGeneration = 0;
+
+	pthread_mutex_lock(&mutex_);
+	while (true) {
+		while (generation_ == lastGeneration && !shutdown_)
+			pthread_cond_wait(&taskCond_, &mutex_);
+		if (shutdown_)
+			break;
+
+		lastGeneration = generation_;
+		TaskFunc func = taskFunc_;
+		void* arg = taskArg_;
+		pthread_mutex_unlock(&mutex_);
+
+		func(arg, threadId, numThreads_);
+
+		pthread_mutex_lock(&mutex_);
+		if (--numPending_ == 0)
+			pthread_cond_signal(&doneCond_);
+	}
+	pthread_mutex_unlock(&mutex_);
+}
+
+#endif
@@ -382,20 +382,17 @@ int CpuSNN::printPostConnection2(int grpId, FILE* const fpg)
 	fprintf(fpg, " id %d : group %d : postlength %d ", i, findGrpId(i), Npost[i]);
 	// fetch the starting position
 	post_info_t* postIds = &postSynapticIds[cumulativePost[i]];
-	for(int j=0; j <= maxDelay_; j++) {
-	  int len   = postDelayInfo[i*(maxDelay_+1)+j].delay_length;
-	  int start = postDelayInfo[i*(maxDelay_+1)+j].delay_index_start;
-	  for(int k=start; k < len; k++) {
+	for(unsigned int b=postDelayBucketCum[i]; b < postDelayBucketCum[i+1]; b++) {
+	  int len   = postDelayBuckets[b].delay_length;
+	  for(int k=0; k < len; k++) {
 	int post_nid = GET_CONN_NEURON_ID((*postIds));
 	//					int post_gid = GET_CONN_GRP_ID((*postIds));
-	fprintf(fpg, " : %d,%d ", post_nid, j);
+	fprintf(fpg, " : %d,%d ", post_nid, postDelayBuckets[b].tD);
 	postIds++;
 	  }
-	  if (Npost[i] > maxLength)
-	maxLength = Npost[i];
-	  if ((start+len) >= Npost[i])
-	break;
 	}
+	if (Npost[i] > maxLength)
+	  maxLength = Npost[i];
 	fprintf(fpg, "\n");
   }
   fflush(fpg);
@@ -480,9 +477,9 @@ void CpuSNN::printPostConnection(int grpId, FILE* const fp)
 	}
 	if(fp) fprintf(fp, "\n");
 	if(fp) fprintf(fp, " Delay ( %3d ) : ", i);
-	for(int j=0; j < maxDelay_; j++) {
-	  if(fp) fprintf(fp, " %d,%d ", postDelayInfo[i*(maxDelay_+1)+j].delay_length,
-			 postDelayInfo[i*(maxDelay_+1)+j].delay_index_start);
+	for(unsigned int b=postDelayBucketCum[i]; b < postDelayBucketCum[i+1]; b++) {
+	  if(fp) fprintf(fp, " %d:%d,%d ", postDelayBuckets[b].tD+1, postDelayBuckets[b].delay_length,
+			 postDelayBuckets[b].delay_index_start);
 	}
 	if(fp) fprintf(fp, "\n");
   }
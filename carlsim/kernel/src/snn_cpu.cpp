@@ -60,9 +60,6 @@
 
 // \FIXME what are the following for? why were they all the way at the bottom of this file?
 
-#define COMPACTION_ALIGNMENT_PRE  16
-#define COMPACTION_ALIGNMENT_POST 0
-
 #define SETPOST_INFO(name, nid, sid, val) name[cumulativePost[nid]+sid]=val;
 
 #define SETPRE_INFO(name, nid, sid, val)  name[cumulativePre[nid]+sid]=val;
@@ -211,6 +208,15 @@ short int CpuSNN::connect(int grpId1, int grpId2, const std::string& _type, floa
 	return retId;
 }
 
+// make custom connections from grpId1 to grpId2, the connections are made block-wise by a BatchConnectionGenerator
+short int CpuSNN::connect(int grpId1, int grpId2, BatchConnectionGeneratorCore* conn, float _mulSynFast,
+						float _mulSynSlow, bool synWtType, int maxM, int maxPreM) {
+	short int connId = connect(grpId1, grpId2, (ConnectionGeneratorCore*)NULL, _mulSynFast, _mulSynSlow, synWtType,
+		maxM, maxPreM);
+	getConnectInfo(connId)->batchConn = conn;
+	return connId;
+}
+
 // make custom connections from grpId1 to grpId2
 short int CpuSNN::connect(int grpId1, int grpId2, ConnectionGeneratorCore* conn, float _mulSynFast, float _mulSynSlow,
 						bool synWtType, int maxM, int maxPreM) {
@@ -509,6 +515,39 @@ void CpuSNN::setIntegrationMethod(integrationMethod_t method, int numStepsPerMs)
 	timeStep_ = 1.0f / simNumStepsPerMs_;
 }
 
+void CpuSNN::setNumThreads(int numThreads) {
+	assert(numThreads >= 1);
+	if (simMode_ != CPU_MODE && numThreads > 1) {
+		KERNEL_WARN("Multi-threading is only supported in CPU_MODE, ignoring setNumThreads(%d).", numThreads);
+		return;
+	}
+	numThreads_ = numThreads;
+}
+
+void CpuSNN::setPostOrderedSynapses(bool enable) {
+	if (simMode_ != CPU_MODE && enable) {
+		KERNEL_WARN("Post-ordered synapses are only supported in CPU_MODE, ignoring setPostOrderedSynapses(true).");
+		return;
+	}
+	withPostOrderedSynapses_ = enable;
+}
+
+void CpuSNN::setTraceBasedSTDP(bool enable) {
+	if (simMode_ != CPU_MODE && enable) {
+		KERNEL_WARN("Trace-based STDP is only supported in CPU_MODE, ignoring setTraceBasedSTDP(true).");
+		return;
+	}
+	withTraceBasedSTDP_ = enable;
+}
+
+void CpuSNN::setLazyDecay(bool enable) {
+	if (simMode_ != CPU_MODE && enable) {
+		KERNEL_WARN("Lazy decay is only supported in CPU_MODE, ignoring setLazyDecay(true).");
+		return;
+	}
+	withLazyDecay_ = enable;
+}
+
 // set Izhikevich parameters for group
 void CpuSNN::setNeuronParameters(int grpId, float izh_a, float izh_a_sd, float izh_b, float izh_b_sd,
 								float izh_c, float izh_c_sd, float izh_d, float izh_d_sd)
@@ -866,6 +905,11 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 	}
 #endif
 
+	// weights skipped by updateWeights must be up to date when the user gets hold of them
+	if (wtUpdateLast != NULL) {
+		runThreadTask(&CpuSNN::catchUpWeightsNeurons, numNReg);
+	}
+
 	// user can opt to display some runNetwork summary
 	if (printRunSummary) {
 
@@ -888,6 +932,11 @@ int CpuSNN::runNetwork(int _nsec, int _nmsec, bool printRunSummary, bool copySta
 	updateSpikeMonitor();
 	updateGroupMonitor();
 
+	// the spike files should be complete when the user gets control back
+	if (numSpikeMonitor) {
+		flushSpikeFiles();
+	}
+
 	// keep track of simulation time...
 #ifndef __CPU_ONLY__
 	CUDA_STOP_TIMER(timer);
@@ -949,6 +998,8 @@ void CpuSNN::biasWeights(short int connId, float bias, bool updateWeightRange) {
 				// update datastructures
 				wt[pos_ij] = weight;
 				maxSynWt[pos_ij] = connInfo->maxWt; // it's easier to just update, even if it hasn't changed
+				if (postSynWt != NULL)
+					postSynWt[preSynPostIdx[pos_ij]] = weight;
 			}
 		}
 
@@ -1055,6 +1106,8 @@ void CpuSNN::scaleWeights(short int connId, float scale, bool updateWeightRange)
 				// update datastructures
 				wt[pos_ij] = weight;
 				maxSynWt[pos_ij] = connInfo->maxWt; // it's easier to just update, even if it hasn't changed
+				if (postSynWt != NULL)
+					postSynWt[preSynPostIdx[pos_ij]] = weight;
 			}
 		}
 
@@ -1322,6 +1375,8 @@ void CpuSNN::setWeight(short int connId, int neurIdPre, int neurIdPost, float we
 
 			wt[pos_ij] = isExcitatoryGroup(connInfo->grpSrc) ? weight : -1.0*weight;
 			maxSynWt[pos_ij] = isExcitatoryGroup(connInfo->grpSrc) ? maxWt : -1.0*maxWt;
+			if (postSynWt != NULL)
+				postSynWt[preSynPostIdx[pos_ij]] = wt[pos_ij];
 
 #ifndef __CPU_ONLY__
 			if (simMode_==GPU_MODE) {
@@ -1417,8 +1472,8 @@ void CpuSNN::saveSimulation(FILE* fid, bool saveSynapseInfo) {
 			unsigned int offset = cumulativePost[i];
 
 			unsigned int count = 0;
-			for (int t=0;t<maxDelay_;t++) {
-				delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
+			for (unsigned int b=postDelayBucketCum[i]; b<postDelayBucketCum[i+1]; b++) {
+				delay_bucket_t dPar = postDelayBuckets[b];
 
 				for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++)
 					count++;
@@ -1426,8 +1481,8 @@ void CpuSNN::saveSimulation(FILE* fid, bool saveSynapseInfo) {
 
 			if (!fwrite(&count,sizeof(int),1,fid)) KERNEL_ERROR("saveSimulation fwrite error");
 
-			for (int t=0;t<maxDelay_;t++) {
-				delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
+			for (unsigned int b=postDelayBucketCum[i]; b<postDelayBucketCum[i+1]; b++) {
+				delay_bucket_t dPar = postDelayBuckets[b];
 
 				for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++) {
 					// get synaptic info...
@@ -1446,7 +1501,7 @@ void CpuSNN::saveSimulation(FILE* fid, bool saveSynapseInfo) {
 					// get the cumulative position for quick access...
 					unsigned int pos_i = cumulativePre[p_i] + s_i;
 
-					uint8_t delay = t+1;
+					uint8_t delay = dPar.tD+1;
 					uint8_t plastic = s_i < Npre_plastic[p_i]; // plastic or fixed.
 
 					if (!fwrite(&i,sizeof(int),1,fid)) KERNEL_ERROR("saveSimulation fwrite error");
@@ -1709,11 +1764,11 @@ uint8_t* CpuSNN::getDelays(int gIDpre, int gIDpost, int& Npre, int& Npost, uint8
 	if (delays == NULL) delays = new uint8_t[Npre*Npost];
 	memset(delays,0,Npre*Npost);
 
-	for (int i=grp_Info[gIDpre].StartN;i<grp_Info[gIDpre].EndN;i++) {
+	for (int i=grp_Info[gIDpre].StartN;i<=grp_Info[gIDpre].EndN;i++) {
 		unsigned int offset = cumulativePost[i];
 
-		for (int t=0;t<maxDelay_;t++) {
-			delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+t];
+		for (unsigned int b=postDelayBucketCum[i]; b<postDelayBucketCum[i+1]; b++) {
+			delay_bucket_t dPar = postDelayBuckets[b];
 
 			for(int idx_d=dPar.delay_index_start; idx_d<(dPar.delay_index_start+dPar.delay_length); idx_d++) {
 				// get synaptic info...
@@ -1731,7 +1786,7 @@ uint8_t* CpuSNN::getDelays(int gIDpre, int gIDpost, int& Npre, int& Npost, uint8
 					// get the cumulative position for quick access...
 //					unsigned int pos_i = cumulativePre[p_i] + s_i;
 
-					delays[i+Npre*(p_i-grp_Info[gIDpost].StartN)] = t+1;
+					delays[(i-grp_Info[gIDpre].StartN)+Npre*(p_i-grp_Info[gIDpost].StartN)] = dPar.tD+1;
 				}
 			}
 		}
@@ -2037,9 +2092,9 @@ void CpuSNN::CpuSNNinit() {
 	KERNEL_DEBUG("Current local time and date: %s", asctime(timeinfo));
 
 	// init random seed
+	// the kernel draws all of its random numbers from streams derived from randSeed_ (see cpu_random.h), the global
+	// generator is only seeded for user code that relies on it
 	srand48(randSeed_);
-	//getRand.seed(randSeed_*2);
-	//getRandClosed.seed(randSeed_*3);
 
 	finishedPoissonGroup  = false;
 	connectBegin = NULL;
@@ -2061,8 +2116,6 @@ void CpuSNN::CpuSNNinit() {
 
 	allocatedN      = 0;
 	allocatedComp   = 0;
-	allocatedPre    = 0;
-	allocatedPost   = 0;
 	doneReorganization = false;
 	memoryOptimized	   = false;
 
@@ -2072,6 +2125,7 @@ void CpuSNN::CpuSNNinit() {
 
 	spikeRateUpdated = false;
 	numSpikeMonitor = 0;
+	spikeFileWriter_ = NULL;
 	numGroupMonitor = 0;
 	numConnectionMonitor = 0;
 	numSpkCnt = 0;
@@ -2116,6 +2170,31 @@ void CpuSNN::CpuSNNinit() {
 	// default integration method: Forward-Euler with 0.5ms integration step
 	setIntegrationMethod(FORWARD_EULER, 2);
 
+	// default is single-threaded CPU mode
+	numThreads_ = 1;
+	threadTask_ = NULL;
+	threadTaskNumItems_ = 0;
+	connBlockInfo_ = NULL;
+	connBlockPreStartN_ = 0;
+	rateGenGrpId_ = -1;
+	numFiredSTDP = 0;
+	withPostOrderedSynapses_ = false;
+	withTraceBasedSTDP_ = false;
+	withLazyDecay_ = false;
+	numNSTP_ = 0;
+	wtUpdateCnt_ = 0;
+	numSTDPPreTraceSlots_ = 0;
+	for (int g=0; g<MAX_GRP_PER_SNN; g++) {
+		grpUpdateFunc_[g] = NULL;
+		grpDecayFunc_[g] = NULL;
+		stdpPreTraceSlotExc_[g] = -1;
+		stdpPreTraceSlotInb_[g] = -1;
+		ltpExcLUT_[g].wtChange = NULL; ltpExcLUT_[g].len = 0;
+		ltdExcLUT_[g].wtChange = NULL; ltdExcLUT_[g].len = 0;
+		ltpInbLUT_[g].wtChange = NULL; ltpInbLUT_[g].len = 0;
+		ltdInbLUT_[g].wtChange = NULL; ltdInbLUT_[g].len = 0;
+	}
+
 #ifndef __CPU_ONLY__
 	// each CpuSNN object hold its own random number object
 	gpuPoissonRand = NULL;
@@ -2243,11 +2322,15 @@ void CpuSNN::buildNetworkInit() {
 	current	   = new float[numNReg];
 	extCurrent = new float[numNReg];
 	memset(extCurrent, 0, sizeof(extCurrent[0])*numNReg);
+	totalCurrent = new float[numNReg]; // scratch buffer for globalStateUpdate
 
 	// keeps track of all neurons that spiked at current time step
 	curSpike = new bool[numNReg];
 	memset(curSpike, 0, sizeof(curSpike[0])*numNReg);
 
+	// keeps track of all neurons that spiked at current time step and need a post-synaptic STDP update
+	firedSTDP = new int[numNReg];
+
 	cpuSnnSz.neuronInfoSize += (sizeof(float)*numNReg*8);
 
 	if (sim_with_conductances) {
@@ -2303,6 +2386,10 @@ void CpuSNN::buildNetworkInit() {
 	if (sim_with_homeostasis) {
 		avgFiring  = new float[numN];
 		baseFiring = new float[numN];
+		if (withLazyDecay_) {
+			avgFiringTime = new uint32_t[numN];
+			cpuSnnSz.neuronInfoSize += sizeof(uint32_t) * numN;
+		}
 	}
 
 	#ifdef NEURON_NOISE
@@ -2312,7 +2399,21 @@ void CpuSNN::buildNetworkInit() {
 	#endif
 
 	// STP can be applied to spike generators, too -> numN
-	if (sim_with_stp) {
+	if (sim_with_stp && simMode_ == CPU_MODE) {
+		// only neurons of STP groups keep their values at the last spike (see addSpikeToTable)
+		numNSTP_ = 0;
+		for (int g=0; g<numGrp; g++) {
+			stpGrpOffset_[g] = numNSTP_;
+			if (grp_Info[g].WithSTP)
+				numNSTP_ += grp_Info[g].SizeN;
+		}
+		stpLastU = new float[numNSTP_];
+		stpLastX = new float[numNSTP_];
+		memset(stpLastU, 0, sizeof(float)*numNSTP_);
+		for (int i=0; i<numNSTP_; i++)
+			stpLastX[i] = 1.0f;
+		cpuSnnSz.synapticInfoSize += (2*sizeof(float)*numNSTP_);
+	} else if (sim_with_stp) {
 		// \TODO: The size of these data structures could be reduced to the max synaptic delay of all
 		// connections with STP. That number might not be the same as maxDelay_.
 		stpu = new float[numN*(maxDelay_+1)];
@@ -2340,26 +2441,25 @@ void CpuSNN::buildNetworkInit() {
 		preSynCnt  += (grp_Info[g].SizeN * grp_Info[g].numPreSynapses);
 	}
 	assert(postSynCnt/numN <= (unsigned int)numPostSynapses_); // divide by numN to prevent INT overflow
-	postSynapticIds		= new post_info_t[postSynCnt+100];
-	tmp_SynapticDelay	= new uint8_t[postSynCnt+100];	//!< Temporary array to store the delays of each connection
-	postDelayInfo		= new delay_info_t[numN*(maxDelay_+1)];	//!< Possible delay values are 0....maxDelay_ (inclusive of maxDelay_)
-	cpuSnnSz.networkInfoSize += ((sizeof(post_info_t)+sizeof(uint8_t))*postSynCnt+100)+(sizeof(delay_info_t)*numN*(maxDelay_+1));
 	assert(preSynCnt/numN <= (unsigned int)numPreSynapses_); // divide by numN to prevent INT overflow
 
-	wt  			= new float[preSynCnt+100];
-	maxSynWt     	= new float[preSynCnt+100];
+	// postSynCnt and preSynCnt are only upper bounds at this point: the synaptic arrays are allocated with exact size
+	// after all connections have been made (see buildConnectionArrays)
+	// the dense delay table is only used on the GPU, the CPU only keeps the delays in use (see reorganizeDelay)
+	if (simMode_ == GPU_MODE) {
+		postDelayInfo		= new delay_info_t[numN*(maxDelay_+1)];	//!< Possible delay values are 0....maxDelay_ (inclusive of maxDelay_)
+		memset(postDelayInfo, 0, sizeof(delay_info_t)*numN*(maxDelay_+1));
+		cpuSnnSz.networkInfoSize += sizeof(delay_info_t)*numN*(maxDelay_+1);
+	}
+	postDelayBucketCum	= new unsigned int[numN+1];
+	cpuSnnSz.networkInfoSize += sizeof(unsigned int)*(numN+1);
 
 	mulSynFast 		= new float[MAX_nConnections];
 	mulSynSlow 		= new float[MAX_nConnections];
-	cumConnIdPre	= new short int[preSynCnt+100];
-
-	//! Temporary array to hold pre-syn connections. will be deleted later if necessary
-	preSynapticIds	= new post_info_t[preSynCnt + 100];
-	// size due to weights and maximum weights
-	cpuSnnSz.synapticInfoSize += ((sizeof(int) + 2 * sizeof(float) + sizeof(post_info_t)) * (preSynCnt + 100));
 
 	timeTableD2  = new unsigned int[1000 + maxDelay_ + 1];
 	timeTableD1  = new unsigned int[1000 + maxDelay_ + 1];
+	spikeDelayRing_ = new std::vector<delayed_spike_t>[maxDelay_];
 	resetTimingTable();
 	cpuSnnSz.spikingInfoSize += sizeof(int) * 2 * (1000 + maxDelay_ + 1);
 
@@ -2368,12 +2468,26 @@ void CpuSNN::buildNetworkInit() {
 }
 
 
+// avgFiringTime holds the first time step whose decay has not been applied yet, the decay of the current time step
+// is included. The exponent can be large, so the factor is computed in double precision.
+float CpuSNN::getAvgFiringDecay(int grpId, int nid) {
+	assert(avgFiringTime[nid] <= simTime+1);
+	return (float)pow((double)grp_Info[grpId].avgTimeScale_decay, (double)(simTime+1-avgFiringTime[nid]));
+}
+
 int CpuSNN::addSpikeToTable(int nid, int g) {
 	int spikeBufferFull = 0;
+	uint32_t prevSpikeTime = lastSpikeTime[nid];
 	lastSpikeTime[nid] = simTime;
 	nSpikeCnt[nid]++;
-	if (sim_with_homeostasis)
+	if (sim_with_homeostasis) {
+		if (avgFiringTime != NULL && grp_Info[g].WithHomeostasis) {
+			// lazy decay: apply all the decay steps since the last update at once
+			avgFiring[nid] *= getAvgFiringDecay(g, nid);
+			avgFiringTime[nid] = simTime+1;
+		}
 		avgFiring[nid] += 1000/(grp_Info[g].avgTimeScale*1000);
+	}
 
 #ifndef __CPU_ONLY__
 	if (simMode_ == GPU_MODE) {
@@ -2384,16 +2498,37 @@ int CpuSNN::addSpikeToTable(int nid, int g) {
 #endif
 
 	if (grp_Info[g].WithSTP) {
-		// update the spike-dependent part of du/dt and dx/dt
-		// we need to retrieve the STP values from the right buffer position (right before vs. right after the spike)
-		int ind_plus = STP_BUF_POS(nid,simTime); // index of right after the spike, such as in u^+
-	    int ind_minus = STP_BUF_POS(nid,(simTime-1)); // index of right before the spike, such as in u^-
+		// STP only supports 1 ms delays, so a spike is delivered in the time step it is fired, and only the values at
+		// the last spike are needed. In between spikes, u and x relax in closed form:
+		// du/dt = -u/tau_F, dx/dt = (1-x)/tau_D
+		int k = stpGrpOffset_[g] + nid - grp_Info[g].StartN;
+		assert(k>=0 && k<numNSTP_);
+
+		// u and x at the end of the previous time step (u^-, x^-)
+		float u = 0.0f, x = 1.0f;
+		if (prevSpikeTime != MAX_SIMULATION_TIME) {
+			double dt = simTime-1-prevSpikeTime;
+			float uPlus = stpLastU[k];
+			float xPlus = stpLastX[k] + (1.0-stpLastX[k])*grp_Info[g].STP_tau_x_inv - uPlus*stpLastX[k];
+			u = uPlus*pow(1.0-grp_Info[g].STP_tau_u_inv, dt);
+			x = 1.0 - (1.0-xPlus)*pow(1.0-grp_Info[g].STP_tau_x_inv, dt);
+		}
 
 		// du/dt = -u/tau_F + U * (1-u^-) * \delta(t-t_{spk})
-		stpu[ind_plus] += grp_Info[g].STP_U*(1.0-stpu[ind_minus]);
-
-		// dx/dt = (1-x)/tau_D - u^+ * x^- * \delta(t-t_{spk})
-		stpx[ind_plus] -= stpu[ind_plus]*stpx[ind_minus];
+		// keep u^+ (value right after spike-update) and x^- (value right before spike-update) for spike delivery
+		// (Tsodyks & Markram, 1998; Mongillo, Barak, & Tsodyks, 2008), x^+ follows from the two
+		stpLastU[k] = u*(1.0-grp_Info[g].STP_tau_u_inv) + grp_Info[g].STP_U*(1.0-u);
+		stpLastX[k] = x;
+	}
+
+	if (synDelayIdx != NULL) {
+		// nearest-spike STDP traces: restart at 1, the decay brings them to exp(-tDiff/tau) (see buildSTDPTraces)
+		for (int slot=0; slot<numSTDPPreTraceSlots_; slot++)
+			stdpPreTrace[slot*numN*(maxDelay_+1) + STP_BUF_POS(nid,simTime)] = 1.0f;
+		if (grp_Info[g].WithSTDP) {
+			stdpPostTraceExc[nid] = 1.0f;
+			stdpPostTraceInb[nid] = 1.0f;
+		}
 	}
 
 	if (grp_Info[g].MaxDelay == 1) {
@@ -2410,6 +2545,7 @@ int CpuSNN::addSpikeToTable(int nid, int g) {
 		firingTableD2[secD2fireCntHost] = nid;
 		grp_Info[g].FiringCount1sec++;
 		secD2fireCntHost++;
+		scheduleSpikeDelivery(nid);
 		if (secD2fireCntHost >= maxSpikesD2) {
 			spikeBufferFull = 1;
 			secD2fireCntHost = maxSpikesD2-1;
@@ -2438,14 +2574,7 @@ void CpuSNN::buildGroup(int grpId) {
 		Npre_plastic[i]	= 0;
 		Npre[i]		  	= 0;
 		Npost[i]	  	= 0;
-		cumulativePost[i] = allocatedPost;
-		cumulativePre[i]  = allocatedPre;
-		allocatedPost    += grp_Info[grpId].numPostSynapses;
-		allocatedPre     += grp_Info[grpId].numPreSynapses;
 	}
-
-	assert(allocatedPost <= postSynCnt);
-	assert(allocatedPre  <= preSynCnt);
 }
 
 //! build the network based on the current setting (e.g., group, connection)
@@ -2667,13 +2796,7 @@ void CpuSNN::buildPoissonGroup(int grpId) {
 		Npre_plastic[i]	  = 0;
 		Npre[i]		  	  = 0;
 		Npost[i]	      = 0;
-		cumulativePost[i] = allocatedPost;
-		cumulativePre[i]  = allocatedPre;
-		allocatedPost    += grp_Info[grpId].numPostSynapses;
-		allocatedPre     += grp_Info[grpId].numPreSynapses;
 	}
-	assert(allocatedPost <= postSynCnt);
-	assert(allocatedPre  <= preSynCnt);
 }
 
 /*!
@@ -2706,102 +2829,95 @@ void CpuSNN::checkSpikeCounterRecordDur() {
 	}
 }
 
-// We parallelly cleanup the postSynapticIds array to minimize any other wastage in that array by compacting the store
-// Appropriate alignment specified by ALIGN_COMPACTION macro is used to ensure some level of alignment (if necessary)
-void CpuSNN::compactConnections() {
-	unsigned int* tmp_cumulativePost = new unsigned int[numN];
-	unsigned int* tmp_cumulativePre  = new unsigned int[numN];
-	unsigned int lastCnt_pre         = 0;
-	unsigned int lastCnt_post        = 0;
-
-	tmp_cumulativePost[0]   = 0;
-	tmp_cumulativePre[0]    = 0;
-
+// Now that all connections have been made, the number of synapses of every neuron is known (Npost, Npre). This allows
+// us to allocate all synaptic arrays with their exact size. Every synapse knows its position in the post list of its
+// pre-neuron and in the pre list of its post-neuron (the synapse ids it got in setConnection), so every column of the
+// pending synapses can be scattered into its synaptic array on its own. The column is released right after that,
+// which keeps the peak memory at the pending synapses plus one synaptic array (instead of all of them).
+void CpuSNN::buildConnectionArrays() {
+	cumulativePost[0] = 0;
+	cumulativePre[0]  = 0;
 	for(int i=1; i < numN; i++) {
-		lastCnt_post = tmp_cumulativePost[i-1]+Npost[i-1]; //position of last pointer
-		lastCnt_pre  = tmp_cumulativePre[i-1]+Npre[i-1]; //position of last pointer
-		#if COMPACTION_ALIGNMENT_POST
-			lastCnt_post= lastCnt_post + COMPACTION_ALIGNMENT_POST-lastCnt_post%COMPACTION_ALIGNMENT_POST;
-			lastCnt_pre = lastCnt_pre  + COMPACTION_ALIGNMENT_PRE- lastCnt_pre%COMPACTION_ALIGNMENT_PRE;
-		#endif
-		tmp_cumulativePost[i] = lastCnt_post;
-		tmp_cumulativePre[i]  = lastCnt_pre;
-		assert(tmp_cumulativePost[i] <= cumulativePost[i]);
-		assert(tmp_cumulativePre[i]  <= cumulativePre[i]);
-	}
-
-	// compress the post_synaptic array according to the new values of the tmp_cumulative counts....
-	unsigned int tmp_postSynCnt = tmp_cumulativePost[numN-1]+Npost[numN-1];
-	unsigned int tmp_preSynCnt  = tmp_cumulativePre[numN-1]+Npre[numN-1];
-	assert(tmp_postSynCnt <= allocatedPost);
-	assert(tmp_preSynCnt  <= allocatedPre);
-	assert(tmp_postSynCnt <= postSynCnt);
-	assert(tmp_preSynCnt  <= preSynCnt);
-	KERNEL_DEBUG("******************");
-	KERNEL_DEBUG("CompactConnection: ");
-	KERNEL_DEBUG("******************");
-	KERNEL_DEBUG("old_postCnt = %d, new_postCnt = %d", postSynCnt, tmp_postSynCnt);
-	KERNEL_DEBUG("old_preCnt = %d,  new_postCnt = %d", preSynCnt,  tmp_preSynCnt);
-
-	// new buffer with required size + 100 bytes of additional space just to provide limited overflow
-	post_info_t* tmp_postSynapticIds   = new post_info_t[tmp_postSynCnt+100];
-
-	// new buffer with required size + 100 bytes of additional space just to provide limited overflow
-	post_info_t* tmp_preSynapticIds	= new post_info_t[tmp_preSynCnt+100];
-	float* tmp_wt	    	  		= new float[tmp_preSynCnt+100];
-	float* tmp_maxSynWt   	  		= new float[tmp_preSynCnt+100];
-	short int *tmp_cumConnIdPre 		= new short int[tmp_preSynCnt+100];
-	float *tmp_mulSynFast 			= new float[numConnections];
-	float *tmp_mulSynSlow  			= new float[numConnections];
-
-	// compact synaptic information
-	for(int i=0; i<numN; i++) {
-		assert(tmp_cumulativePost[i] <= cumulativePost[i]);
-		assert(tmp_cumulativePre[i]  <= cumulativePre[i]);
-		for( int j=0; j<Npost[i]; j++) {
-			unsigned int tmpPos = tmp_cumulativePost[i]+j;
-			unsigned int oldPos = cumulativePost[i]+j;
-			tmp_postSynapticIds[tmpPos] = postSynapticIds[oldPos];
-			tmp_SynapticDelay[tmpPos]   = tmp_SynapticDelay[oldPos];
-		}
-		for( int j=0; j<Npre[i]; j++) {
-			unsigned int tmpPos =  tmp_cumulativePre[i]+j;
-			unsigned int oldPos =  cumulativePre[i]+j;
-			tmp_preSynapticIds[tmpPos]  = preSynapticIds[oldPos];
-			tmp_maxSynWt[tmpPos] 	    = maxSynWt[oldPos];
-			tmp_wt[tmpPos]              = wt[oldPos];
-			tmp_cumConnIdPre[tmpPos]	= cumConnIdPre[oldPos];
-		}
-	}
-
-	// delete old buffer space
-	delete[] postSynapticIds;
-	postSynapticIds = tmp_postSynapticIds;
-	cpuSnnSz.networkInfoSize -= (sizeof(post_info_t)*postSynCnt);
-	cpuSnnSz.networkInfoSize += (sizeof(post_info_t)*(tmp_postSynCnt+100));
-
-	delete[] cumulativePost;
-	cumulativePost  = tmp_cumulativePost;
-
-	delete[] cumulativePre;
-	cumulativePre   = tmp_cumulativePre;
-
-	delete[] maxSynWt;
-	maxSynWt = tmp_maxSynWt;
-	cpuSnnSz.synapticInfoSize -= (sizeof(float)*preSynCnt);
-	cpuSnnSz.synapticInfoSize += (sizeof(float)*(tmp_preSynCnt+100));
-
-	delete[] wt;
-	wt = tmp_wt;
-	cpuSnnSz.synapticInfoSize -= (sizeof(float)*preSynCnt);
-	cpuSnnSz.synapticInfoSize += (sizeof(float)*(tmp_preSynCnt+100));
-
-	delete[] cumConnIdPre;
-	cumConnIdPre = tmp_cumConnIdPre;
-	cpuSnnSz.synapticInfoSize -= (sizeof(short int)*preSynCnt);
-	cpuSnnSz.synapticInfoSize += (sizeof(short int)*(tmp_preSynCnt+100));
+		cumulativePost[i] = cumulativePost[i-1]+Npost[i-1];
+		cumulativePre[i]  = cumulativePre[i-1]+Npre[i-1];
+	}
+
+	unsigned int numPostSyn = cumulativePost[numN-1]+Npost[numN-1];
+	unsigned int numPreSyn  = cumulativePre[numN-1]+Npre[numN-1];
+	size_t numSyn = pendingSrc_.size();
+	assert(numPostSyn == numSyn);
+	assert(numPreSyn  == numSyn);
+	assert(numPostSyn <= postSynCnt);
+	assert(numPreSyn  <= preSynCnt);
+	KERNEL_DEBUG("buildConnectionArrays: max postCnt = %d, postCnt = %d", postSynCnt, numPostSyn);
+	KERNEL_DEBUG("buildConnectionArrays: max preCnt = %d, preCnt = %d", preSynCnt, numPreSyn);
+	postSynCnt = numPostSyn;
+	preSynCnt  = numPreSyn;
+
+	// position of every synapse in the post-synaptic (by pre-neuron) and pre-synaptic (by post-neuron) arrays
+	#define PENDING_POST_POS(k) (cumulativePost[pendingSrc_[k]] + pendingPostSlot_[k])
+	#define PENDING_PRE_POS(k)  (cumulativePre[pendingDest_[k]] + pendingPreSlot_[k])
+
+	// required size + 100 of additional space just to provide limited overflow
+	wt = new float[preSynCnt+100];
+	for (size_t k=0; k<numSyn; k++)
+		wt[PENDING_PRE_POS(k)] = pendingWt_[k];
+	std::vector<float>().swap(pendingWt_);
+
+	maxSynWt = new float[preSynCnt+100];
+	for (size_t k=0; k<numSyn; k++)
+		maxSynWt[PENDING_PRE_POS(k)] = pendingMaxWt_[k];
+	std::vector<float>().swap(pendingMaxWt_);
+
+	cumConnIdPre = new short int[preSynCnt+100];
+	for (size_t k=0; k<numSyn; k++)
+		cumConnIdPre[PENDING_PRE_POS(k)] = pendingConnId_[k];
+	std::vector<short int>().swap(pendingConnId_);
+
+	tmp_SynapticDelay = new uint8_t[postSynCnt+100];	//!< Temporary array to store the delays of each connection
+	for (size_t k=0; k<numSyn; k++)
+		tmp_SynapticDelay[PENDING_POST_POS(k)] = pendingDelay_[k];
+	std::vector<uint8_t>().swap(pendingDelay_);
+
+	// the ids refer to the synapse on the other side: the post list of src holds the pre-slot of the synapse in dest,
+	// and vice versa
+	preSynapticIds = new post_info_t[preSynCnt+100];
+	for (size_t k=0; k<numSyn; k++)
+		preSynapticIds[PENDING_PRE_POS(k)] = SET_CONN_ID(pendingSrc_[k], pendingPostSlot_[k], grpIds[pendingSrc_[k]]);
+
+	postSynapticIds = new post_info_t[postSynCnt+100];
+	for (size_t k=0; k<numSyn; k++)
+		postSynapticIds[PENDING_POST_POS(k)] = SET_CONN_ID(pendingDest_[k], pendingPreSlot_[k],
+			grpIds[pendingDest_[k]]);
+
+	#undef PENDING_POST_POS
+	#undef PENDING_PRE_POS
+
+	cpuSnnSz.networkInfoSize += (sizeof(post_info_t)+sizeof(uint8_t))*(postSynCnt+100);
+	cpuSnnSz.synapticInfoSize += (sizeof(post_info_t) + 2*sizeof(float) + sizeof(short int)) * (preSynCnt+100);
+
+	// release the remaining columns of the pending synapses
+	clearPendingSynapses();
+
+	// index the synapses of every connection, so that monitors don't have to scan all synapses in the network
+	// a connection is created in one go, so its synapses form a single range in the pre list of a neuron (except for
+	// several connections between the same groups that were restored by loadSimulation, which get several ranges)
+	connSynRanges_.assign(numConnections, std::vector<syn_range_t>());
+	for (int nid=0; nid<numN; nid++) {
+		for (unsigned int pos=cumulativePre[nid]; pos<cumulativePre[nid]+Npre[nid]; pos++) {
+			std::vector<syn_range_t>& ranges = connSynRanges_[cumConnIdPre[pos]];
+			if (ranges.size() && ranges.back().nid==nid && ranges.back().start+ranges.back().length==pos) {
+				ranges.back().length++;
+			} else {
+				syn_range_t range = {pos, 1, nid};
+				ranges.push_back(range);
+			}
+		}
+	}
 
 	// compact connection-centric information
+	float *tmp_mulSynFast = new float[numConnections];
+	float *tmp_mulSynSlow = new float[numConnections];
 	for (int i=0; i<numConnections; i++) {
 		tmp_mulSynFast[i] = mulSynFast[i];
 		tmp_mulSynSlow[i] = mulSynSlow[i];
@@ -2810,17 +2926,18 @@ void CpuSNN::compactConnections() {
 	delete[] mulSynSlow;
 	mulSynFast = tmp_mulSynFast;
 	mulSynSlow = tmp_mulSynSlow;
-	cpuSnnSz.networkInfoSize -= (2*sizeof(uint8_t)*preSynCnt);
-	cpuSnnSz.networkInfoSize += (2*sizeof(uint8_t)*(tmp_preSynCnt+100));
-
-
-	delete[] preSynapticIds;
-	preSynapticIds  = tmp_preSynapticIds;
-	cpuSnnSz.synapticInfoSize -= (sizeof(post_info_t)*preSynCnt);
-	cpuSnnSz.synapticInfoSize += (sizeof(post_info_t)*(tmp_preSynCnt+100));
+}
 
-	preSynCnt	= tmp_preSynCnt;
-	postSynCnt	= tmp_postSynCnt;
+void CpuSNN::clearPendingSynapses() {
+	// swap with empty vectors: clear() would keep the memory
+	std::vector<unsigned int>().swap(pendingSrc_);
+	std::vector<unsigned int>().swap(pendingDest_);
+	std::vector<unsigned short>().swap(pendingPostSlot_);
+	std::vector<unsigned short>().swap(pendingPreSlot_);
+	std::vector<float>().swap(pendingWt_);
+	std::vector<float>().swap(pendingMaxWt_);
+	std::vector<short int>().swap(pendingConnId_);
+	std::vector<uint8_t>().swap(pendingDelay_);
 }
 
 // make 'C' full connections from grpSrc to grpDest
@@ -2834,6 +2951,7 @@ void CpuSNN::connectFull(grpConnectInfo_t* info) {
 
 	for(int i = grp_Info[grpSrc].StartN; i <= grp_Info[grpSrc].EndN; i++)  {
 		Point3D loc_i = getNeuronLocation3D(i); // 3D coordinates of i
+		CpuRandomStream rng(randSeed_, cpuRandomStreamId(RAND_STREAM_CONNECT, info->connId, i-grp_Info[grpSrc].StartN));
 		for(int j = grp_Info[grpDest].StartN; j <= grp_Info[grpDest].EndN; j++) { // j: the temp neuron id
 			// if flag is set, don't connect direct connections
 			if((noDirect) && (i - grp_Info[grpSrc].StartN) == (j - grp_Info[grpDest].StartN))
@@ -2844,10 +2962,9 @@ void CpuSNN::connectFull(grpConnectInfo_t* info) {
 			if (!isPoint3DinRF(radius, loc_i, loc_j))
 				continue;
 
-			//uint8_t dVal = info->minDelay + (int)(0.5 + (drand48() * (info->maxDelay - info->minDelay)));
-			uint8_t dVal = info->minDelay + rand() % (info->maxDelay - info->minDelay + 1);
+			uint8_t dVal = info->minDelay + rng.nextInt(info->maxDelay - info->minDelay + 1);
 			assert((dVal >= info->minDelay) && (dVal <= info->maxDelay));
-			float synWt = getWeights(info->connProp, info->initWt, info->maxWt, i, grpSrc);
+			float synWt = getWeights(info->connProp, info->initWt, info->maxWt, i, grpSrc, rng);
 
 			setConnection(grpSrc, grpDest, i, j, synWt, info->maxWt, dVal, info->connProp, info->connId);
 			info->numberOfConnections++;
@@ -2858,51 +2975,9 @@ void CpuSNN::connectFull(grpConnectInfo_t* info) {
 	grp_Info2[grpDest].sumPreConn += info->numberOfConnections;
 }
 
+// make gaussian connections from grpSrc to grpDest: the weight falls off with the RF distance of pre and post
 void CpuSNN::connectGaussian(grpConnectInfo_t* info) {
-	// rebuild struct for easier handling
-	// adjust with sqrt(2) in order to make the Gaussian kernel depend on 2*sigma^2
-	RadiusRF radius(info->radX, info->radY, info->radZ);
-
-	// in case pre and post have different Grid3D sizes: scale pre to the grid size of post
-	int grpSrc = info->grpSrc;
-	int grpDest = info->grpDest;
-	Grid3D grid_i = getGroupGrid3D(grpSrc);
-	Grid3D grid_j = getGroupGrid3D(grpDest);
-	Point3D scalePre = Point3D(grid_j.x, grid_j.y, grid_j.z) / Point3D(grid_i.x, grid_i.y, grid_i.z);
-
-	for(int i = grp_Info[grpSrc].StartN; i <= grp_Info[grpSrc].EndN; i++)  {
-		Point3D loc_i = getNeuronLocation3D(i)*scalePre; // i: adjusted 3D coordinates
-
-		for(int j = grp_Info[grpDest].StartN; j <= grp_Info[grpDest].EndN; j++) { // j: the temp neuron id
-			// check whether pre-neuron location is in RF of post-neuron
-			Point3D loc_j = getNeuronLocation3D(j); // 3D coordinates of j
-
-			// make sure point is in RF
-			double rfDist = getRFDist3D(radius,loc_i,loc_j);
-			if (rfDist < 0.0 || rfDist > 1.0)
-				continue;
-
-			// if rfDist is valid, it returns a number between 0 and 1
-			// we want these numbers to fit to Gaussian weigths, so that rfDist=0 corresponds to max Gaussian weight
-			// and rfDist=1 corresponds to 0.1 times max Gaussian weight
-			// so we're looking at gauss = exp(-a*rfDist), where a such that exp(-a)=0.1
-			// solving for a, we find that a = 2.3026
-			double gauss = exp(-2.3026*rfDist);
-			if (gauss < 0.1)
-				continue;
-
-			if (drand48() < info->p) {
-				uint8_t dVal = info->minDelay + rand() % (info->maxDelay - info->minDelay + 1);
-				assert((dVal >= info->minDelay) && (dVal <= info->maxDelay));
-				float synWt = gauss * info->initWt; // scale weight according to gauss distance
-				setConnection(grpSrc, grpDest, i, j, synWt, info->maxWt, dVal, info->connProp, info->connId);
-				info->numberOfConnections++;
-			}
-		}
-	}
-
-	grp_Info2[grpSrc].sumPostConn += info->numberOfConnections;
-	grp_Info2[grpDest].sumPreConn += info->numberOfConnections;
+	connectSampled(info);
 }
 
 void CpuSNN::connectOneToOne (grpConnectInfo_t* info) {
@@ -2912,9 +2987,10 @@ void CpuSNN::connectOneToOne (grpConnectInfo_t* info) {
 
 	// NOTE: RadiusRF does not make a difference here: ignore
 	for(int nid=grp_Info[grpSrc].StartN,j=grp_Info[grpDest].StartN; nid<=grp_Info[grpSrc].EndN; nid++, j++)  {
-		uint8_t dVal = info->minDelay + rand() % (info->maxDelay - info->minDelay + 1);
+		CpuRandomStream rng(randSeed_, cpuRandomStreamId(RAND_STREAM_CONNECT, info->connId, nid-grp_Info[grpSrc].StartN));
+		uint8_t dVal = info->minDelay + rng.nextInt(info->maxDelay - info->minDelay + 1);
 		assert((dVal >= info->minDelay) && (dVal <= info->maxDelay));
-		float synWt = getWeights(info->connProp, info->initWt, info->maxWt, nid, grpSrc);
+		float synWt = getWeights(info->connProp, info->initWt, info->maxWt, nid, grpSrc, rng);
 		setConnection(grpSrc, grpDest, nid, j, synWt, info->maxWt, dVal, info->connProp, info->connId);
 		info->numberOfConnections++;
 	}
@@ -2925,33 +3001,129 @@ void CpuSNN::connectOneToOne (grpConnectInfo_t* info) {
 
 // make 'C' random connections from grpSrc to grpDest
 void CpuSNN::connectRandom (grpConnectInfo_t* info) {
+	connectSampled(info);
+}
+
+// finds the index range [lo,hi] of a Grid3D dimension of size 'size' whose coordinates can lie within the RF radius
+// 'rad' around coordinate 'coord' (see getNeuronLocation3D for the coordinate system), returns false if it is empty
+static bool getRFIndexRange(double rad, double coord, int size, int& lo, int& hi) {
+	double center = coord + (size-1)/2.0;
+	if (rad < 0) {
+		// dimension is ignored
+		lo = 0;
+		hi = size-1;
+	} else if (rad == 0) {
+		// coordinates must match exactly
+		lo = hi = (int)floor(center + 0.5);
+		if (1.0*lo - (size-1)/2.0 != coord)
+			return false;
+	} else {
+		// the exact RF check is done by the caller: just make sure the range is not too tight
+		lo = (int)ceil(center - rad - 1e-6);
+		hi = (int)floor(center + rad + 1e-6);
+		lo = (lo < 0) ? 0 : lo;
+		hi = (hi > size-1) ? size-1 : hi;
+	}
+	return lo <= hi;
+}
+
+// draws the number of candidates to skip before the next connected one, if every candidate is connected with prob p
+static long long drawConnectionSkip(CpuRandomStream& rng, double p) {
+	if (p >= 1.0)
+		return 0;
+	double skip = floor(log(1.0-rng.nextDouble()) / log(1.0-p));
+	return (skip < 1e18) ? (long long)skip : (long long)1e18;
+}
+
+void CpuSNN::connectSampled(grpConnectInfo_t* info) {
+	connectBlocks(info, &CpuSNN::sampleConnections, true);
+
+	grp_Info2[info->grpSrc].sumPostConn += info->numberOfConnections;
+	grp_Info2[info->grpDest].sumPreConn += info->numberOfConnections;
+}
+
+void CpuSNN::sampleConnections(int startIdx, int endIdx) {
+	grpConnectInfo_t* info = connBlockInfo_;
 	int grpSrc = info->grpSrc;
 	int grpDest = info->grpDest;
+	bool isGaussian = (info->type == CONN_GAUSSIAN);
 
 	// rebuild struct for easier handling
 	RadiusRF radius(info->radX, info->radY, info->radZ);
+	Grid3D grid_i = getGroupGrid3D(grpSrc);
+	Grid3D grid_j = getGroupGrid3D(grpDest);
 
-	for(int pre_nid=grp_Info[grpSrc].StartN; pre_nid<=grp_Info[grpSrc].EndN; pre_nid++) {
-		Point3D loc_pre = getNeuronLocation3D(pre_nid); // 3D coordinates of i
-		for(int post_nid=grp_Info[grpDest].StartN; post_nid<=grp_Info[grpDest].EndN; post_nid++) {
-			// check whether pre-neuron location is in RF of post-neuron
-			Point3D loc_post = getNeuronLocation3D(post_nid); // 3D coordinates of j
-			if (!isPoint3DinRF(radius, loc_pre, loc_post))
-				continue;
+	// in case pre and post have different Grid3D sizes, gaussian connections scale pre to the grid size of post
+	Point3D scalePre(1.0, 1.0, 1.0);
+	if (isGaussian)
+		scalePre = Point3D(grid_j.x, grid_j.y, grid_j.z) / Point3D(grid_i.x, grid_i.y, grid_i.z);
 
-			if (drand48() < info->p) {
-				//uint8_t dVal = info->minDelay + (int)(0.5+(drand48()*(info->maxDelay-info->minDelay)));
-				uint8_t dVal = info->minDelay + rand() % (info->maxDelay - info->minDelay + 1);
-				assert((dVal >= info->minDelay) && (dVal <= info->maxDelay));
-				float synWt = getWeights(info->connProp, info->initWt, info->maxWt, pre_nid, grpSrc);
-				setConnection(grpSrc, grpDest, pre_nid, post_nid, synWt, info->maxWt, dVal, info->connProp, info->connId);
-				info->numberOfConnections++;
+	// if no RF dimension has a real-valued radius, every post-neuron in the bounding box lies within the RF
+	bool boxInRF = (radius.radX <= 0 && radius.radY <= 0 && radius.radZ <= 0);
+
+	for (int idx=startIdx; idx<endIdx; idx++) {
+		std::vector<pending_synapse_t>& synapses = connBlockSynapses_[idx];
+		synapses.clear();
+
+		int pre_nid = connBlockPreStartN_ + idx;
+		int relPre = pre_nid - grp_Info[grpSrc].StartN;
+		Point3D loc_pre = getNeuronLocation3D(grpSrc, relPre)*scalePre;
+
+		// bounding box of the RF in the post grid
+		int loX, hiX, loY, hiY, loZ, hiZ;
+		if (info->p <= 0.0
+				|| !getRFIndexRange(radius.radX, loc_pre.x, grid_j.x, loX, hiX)
+				|| !getRFIndexRange(radius.radY, loc_pre.y, grid_j.y, loY, hiY)
+				|| !getRFIndexRange(radius.radZ, loc_pre.z, grid_j.z, loZ, hiZ))
+			continue;
+		long long boxX = hiX-loX+1, boxY = hiY-loY+1;
+		long long boxN = boxX*boxY*(hiZ-loZ+1);
+
+		// every pre-neuron has its own random stream
+		CpuRandomStream rng(randSeed_, cpuRandomStreamId(RAND_STREAM_CONNECT, info->connId, relPre));
+
+		// walk over the candidates in the box in order of post-neuron id: if all of them are inside the RF, jump
+		// directly to the next connected one; otherwise count the skipped candidates among those that pass the RF
+		// check
+		long long skip = drawConnectionSkip(rng, info->p);
+		long long k = boxInRF ? skip : 0;
+		while (k < boxN) {
+			int relPost = (loX + k%boxX) + grid_j.x*((loY + (k/boxX)%boxY) + grid_j.y*(loZ + k/(boxX*boxY)));
+			Point3D loc_post = getNeuronLocation3D(grpDest, relPost);
+
+			// if rfDist is valid, it returns a number between 0 and 1
+			// gaussian connections want these numbers to fit to Gaussian weigths, so that rfDist=0 corresponds to
+			// max Gaussian weight and rfDist=1 corresponds to 0.1 times max Gaussian weight
+			// so we're looking at gauss = exp(-a*rfDist), where a such that exp(-a)=0.1
+			// solving for a, we find that a = 2.3026
+			double rfDist = getRFDist3D(radius, loc_pre, loc_post);
+			double gauss = exp(-2.3026*rfDist);
+			bool inRF = rfDist >= 0.0 && rfDist <= 1.0 && (!isGaussian || gauss >= 0.1);
+			if (!boxInRF && (!inRF || skip-- > 0)) {
+				k++;
+				continue;
 			}
+			assert(inRF);
+
+			pending_synapse_t syn;
+			syn.src = pre_nid;
+			syn.dest = grp_Info[grpDest].StartN + relPost;
+			syn.delay = info->minDelay + rng.nextInt(info->maxDelay - info->minDelay + 1);
+			assert((syn.delay >= info->minDelay) && (syn.delay <= info->maxDelay));
+			if (isGaussian)
+				syn.wt = gauss * info->initWt; // scale weight according to gauss distance
+			else if (GET_INITWTS_RANDOM(info->connProp))
+				syn.wt = info->initWt * rng.nextDouble();
+			else
+				syn.wt = getWeights(info->connProp, info->initWt, info->maxWt, pre_nid, grpSrc, rng);
+			syn.maxWt = info->maxWt;
+			syn.connId = info->connId;
+			synapses.push_back(syn);
+
+			skip = drawConnectionSkip(rng, info->p);
+			k += boxInRF ? skip+1 : 1;
 		}
 	}
-
-	grp_Info2[grpSrc].sumPostConn += info->numberOfConnections;
-	grp_Info2[grpDest].sumPreConn += info->numberOfConnections;
 }
 
 // user-defined functions called here...
@@ -2960,6 +3132,19 @@ void CpuSNN::connectUserDefined (grpConnectInfo_t* info) {
 	int grpSrc = info->grpSrc;
 	int grpDest = info->grpDest;
 	info->maxDelay = 0;
+
+	if (info->batchConn != NULL) {
+		// maxWt becomes the largest weight the generator returns (see connectBlocks)
+		info->maxWt = 0.0f;
+
+		// thread-safe generators can fill several blocks of pre-neurons at the same time
+		connectBlocks(info, &CpuSNN::generateConnections, info->batchConn->isThreadSafe());
+
+		grp_Info2[grpSrc].sumPostConn += info->numberOfConnections;
+		grp_Info2[grpDest].sumPreConn += info->numberOfConnections;
+		return;
+	}
+
 	for(int nid=grp_Info[grpSrc].StartN; nid<=grp_Info[grpSrc].EndN; nid++) {
 		for(int nid2=grp_Info[grpDest].StartN; nid2 <= grp_Info[grpDest].EndN; nid2++) {
 			int srcId  = nid  - grp_Info[grpSrc].StartN;
@@ -2995,6 +3180,66 @@ void CpuSNN::connectUserDefined (grpConnectInfo_t* info) {
 	grp_Info2[grpDest].sumPreConn += info->numberOfConnections;
 }
 
+void CpuSNN::generateConnections(int startIdx, int endIdx) {
+	grpConnectInfo_t* info = connBlockInfo_;
+	int grpSrc = info->grpSrc;
+	int grpDest = info->grpDest;
+	int relPreStart = connBlockPreStartN_ - grp_Info[grpSrc].StartN;
+
+	for (int idx=startIdx; idx<endIdx; idx++)
+		connBlockSynapses_[idx].clear();
+
+	std::vector<ConnectionTuple> tuples;
+	info->batchConn->connect(this, grpSrc, relPreStart+startIdx, relPreStart+endIdx, grpDest, tuples);
+
+	// the tuples come from user code: check every one of them before it is written to the block
+	// this may run on a worker thread, so errors are only reported here (see connectBlocks)
+	for (unsigned int k=0; k<tuples.size(); k++) {
+		int idx = tuples[k].i - relPreStart;
+		float weight = tuples[k].weight;
+		float maxWt = tuples[k].maxWt;
+		float delay = tuples[k].delay;
+
+		if (GET_FIXED_PLASTIC(info->connProp) == SYN_FIXED)
+			maxWt = weight;
+
+		if (idx < startIdx || idx >= endIdx) {
+			KERNEL_ERROR("BatchConnectionGenerator (connId=%d): pre-synaptic index i=%d is not in [%d,%d)",
+				info->connId, tuples[k].i, relPreStart+startIdx, relPreStart+endIdx);
+			connBlockFailed_[startIdx] = 1;
+			return;
+		}
+		if (tuples[k].j < 0 || tuples[k].j >= grp_Info[grpDest].SizeN) {
+			KERNEL_ERROR("BatchConnectionGenerator (connId=%d): post-synaptic index j=%d is not in [0,%d)",
+				info->connId, tuples[k].j, grp_Info[grpDest].SizeN);
+			connBlockFailed_[startIdx] = 1;
+			return;
+		}
+		if (!(delay >= 1 && delay <= MAX_SynapticDelay)) {
+			KERNEL_ERROR("BatchConnectionGenerator (connId=%d): delay %f of synapse (%d,%d) is not in [1,%d]",
+				info->connId, delay, tuples[k].i, tuples[k].j, MAX_SynapticDelay);
+			connBlockFailed_[startIdx] = 1;
+			return;
+		}
+		if (!(fabs(weight) <= fabs(maxWt))) {
+			KERNEL_ERROR("BatchConnectionGenerator (connId=%d): weight %f of synapse (%d,%d) exceeds maxWt %f",
+				info->connId, weight, tuples[k].i, tuples[k].j, maxWt);
+			connBlockFailed_[startIdx] = 1;
+			return;
+		}
+
+		// adjust the sign of the weight based on inh/exc connection
+		pending_synapse_t syn;
+		syn.src = connBlockPreStartN_ + idx;
+		syn.dest = grp_Info[grpDest].StartN + tuples[k].j;
+		syn.wt = isExcitatoryGroup(grpSrc) ? fabs(weight) : -1.0*fabs(weight);
+		syn.maxWt = isExcitatoryGroup(grpSrc) ? fabs(maxWt) : -1.0*fabs(maxWt);
+		syn.delay = (uint8_t)delay;
+		syn.connId = info->connId;
+		connBlockSynapses_[idx].push_back(syn);
+	}
+}
+
 void CpuSNN::printSimSummary() {
 	// stop the timers and update spikeCount* class members
 	float executionTimeMs = getActualExecutionTimeMs();
@@ -3057,6 +3302,12 @@ void CpuSNN::deleteObjects() {
 
 	resetPointers(true); // deallocate pointers
 
+	// the SpikeMonitorCore destructors (called above) have written and closed their spike files
+	if (spikeFileWriter_!=NULL) {
+		delete spikeFileWriter_;
+		spikeFileWriter_ = NULL;
+	}
+
 #ifndef __CPU_ONLY__
 	// do the same as above, but for snn_gpu.cu
 	deleteObjects_GPU();
@@ -3069,7 +3320,7 @@ void CpuSNN::deleteObjects() {
 
 // This method loops through all spikes that are generated by neurons with a delay of 1ms
 // and delivers the spikes to the appropriate post-synaptic neuron
-void CpuSNN::doD1CurrentUpdate() {
+void CpuSNN::doD1CurrentUpdate(int startPostN, int endPostN, int* daSpikeCnt) {
 	int k     = secD1fireCntHost-1;
 	int k_end = timeTableD1[simTimeMs+maxDelay_];
 
@@ -3078,57 +3329,55 @@ void CpuSNN::doD1CurrentUpdate() {
 		int neuron_id      = firingTableD1[k];
 		assert(neuron_id<numN);
 
-		delay_info_t dPar = postDelayInfo[neuron_id*(maxDelay_+1)];
-
-		unsigned int  offset = cumulativePost[neuron_id];
-
-		for(int idx_d = dPar.delay_index_start;
-			idx_d < (dPar.delay_index_start + dPar.delay_length);
-			idx_d = idx_d+1) {
-				generatePostSpike( neuron_id, idx_d, offset, 0);
+		// all synapses of the neuron have a delay of 1 ms: there is at most one bucket (tD=0)
+		unsigned int b = postDelayBucketCum[neuron_id];
+		if (b < postDelayBucketCum[neuron_id+1]) {
+			assert(postDelayBuckets[b].tD == 0);
+			generatePostSpikes(neuron_id, b, startPostN, endPostN, daSpikeCnt);
 		}
+
 		k=k-1;
 	}
 }
 
 // This method loops through all spikes that are generated by neurons with a delay of 2+ms
 // and delivers the spikes to the appropriate post-synaptic neuron
-void CpuSNN::doD2CurrentUpdate() {
-	int k = secD2fireCntHost-1;
-	int k_end = timeTableD2[simTimeMs+1];
-	int t_pos = simTimeMs;
-
-	while((k>=k_end)&& (k >=0)) {
-
-		// get the neuron id from the index k
-		int i  = firingTableD2[k];
-
-		// find the time of firing from the timeTable using index k
-		while (!(((unsigned int)k >= timeTableD2[t_pos+maxDelay_]) 
-			&& ((unsigned int)k < timeTableD2[t_pos+maxDelay_+1]))) {
-			t_pos = t_pos - 1;
-			assert((t_pos+maxDelay_-1)>=0);
-		}
+void CpuSNN::doD2CurrentUpdate(int startPostN, int endPostN, int* daSpikeCnt) {
+	// a network without connections has no delay ring
+	if (maxDelay_ == 0)
+		return;
 
-		// \TODO: Instead of using the complex timeTable, can neuronFiringTime value...???
-		// Calculate the time difference between time of firing of neuron and the current time...
-		int tD = simTimeMs - t_pos;
+	const std::vector<delayed_spike_t>& bucket = spikeDelayRing_[simTime % maxDelay_];
 
-		assert((tD<maxDelay_)&&(tD>=0));
-		assert(i<numN);
+	// spikes are delivered from the most recent to the oldest, which is the same order as walking backwards through
+	// firingTableD2
+	for (int k=(int)bucket.size()-1; k>=0; k--) {
+		assert(bucket[k].delayBucket<postDelayBucketCum[numN]);
+		assert(bucket[k].nid<numN);
 
-		delay_info_t dPar = postDelayInfo[i*(maxDelay_+1)+tD];
+		generatePostSpikes(bucket[k].nid, bucket[k].delayBucket, startPostN, endPostN, daSpikeCnt);
+	}
+}
 
-		unsigned int offset = cumulativePost[i];
+void CpuSNN::scheduleSpikeDelivery(int nid) {
+	// the synapses of a bucket with delay index tD receive the spike in time step simTime+tD
+	for (unsigned int b=postDelayBucketCum[nid]; b<postDelayBucketCum[nid+1]; b++) {
+		delayed_spike_t spk = {nid, b};
+		spikeDelayRing_[(simTime + postDelayBuckets[b].tD) % maxDelay_].push_back(spk);
+	}
+}
 
-		// for each delay variables
-		for(int idx_d = dPar.delay_index_start;
-			idx_d < (dPar.delay_index_start + dPar.delay_length);
-			idx_d = idx_d+1) {
-			generatePostSpike( i, idx_d, offset, tD);
-		}
+// Every thread goes through all the spikes of the current time step (in the same order as in single-threaded mode),
+// but only delivers them to its own range of post-synaptic neurons. This way every post-synaptic variable (currents,
+// conductances, synSpikeTime, wtChange) is written by exactly one thread, and it receives its updates in the exact
+// same order as in single-threaded mode.
+void CpuSNN::doCurrentUpdateThreads(int startThreadId, int endThreadId) {
+	for (int t=startThreadId; t<endThreadId; t++) {
+		int* daSpikeCnt = &threadDASpikeCnt_[t*numGrp];
+		memset(daSpikeCnt, 0, sizeof(int)*numGrp);
 
-		k=k-1;
+		doD2CurrentUpdate(threadPostStartN_[t], threadPostStartN_[t+1], daSpikeCnt);
+		doD1CurrentUpdate(threadPostStartN_[t], threadPostStartN_[t+1], daSpikeCnt);
 	}
 }
 
@@ -3138,7 +3387,7 @@ void CpuSNN::doSnnSim() {
 		checkSpikeCounterRecordDur();
 	}
 
-	// decay STP vars and conductances
+	// decay conductances and homeostasis (STP is decayed when a neuron spikes)
 	globalStateDecay();
 
 	updateSpikeGenerators();
@@ -3152,8 +3401,26 @@ void CpuSNN::doSnnSim() {
 	timeTableD2[simTimeMs+maxDelay_+1] = secD2fireCntHost;
 	timeTableD1[simTimeMs+maxDelay_+1] = secD1fireCntHost;
 
-	doD2CurrentUpdate();
-	doD1CurrentUpdate();
+	if (threadPool_ == NULL) {
+		doD2CurrentUpdate(0, numNReg);
+		doD1CurrentUpdate(0, numNReg);
+	} else {
+		int numThreads = threadPool_->getNumThreads();
+		runThreadTask(&CpuSNN::doCurrentUpdateThreads, numThreads);
+
+		// apply the dopamine released in all threads (adding up 0.04 per spike is order-independent)
+		for (int t=0; t<numThreads; t++) {
+			for (int g=0; g<numGrp; g++) {
+				for (int n=0; n<threadDASpikeCnt_[t*numGrp+g]; n++) {
+					cpuNetPtrs.grpDA[g] += 0.04;
+				}
+			}
+		}
+	}
+
+	// all spikes of the current bucket have been delivered, it can be reused for time step simTime+maxDelay_
+	if (maxDelay_ > 0)
+		spikeDelayRing_[simTime % maxDelay_].clear();
 
 	globalStateUpdate();
 
@@ -3161,71 +3428,101 @@ void CpuSNN::doSnnSim() {
 }
 
 void CpuSNN::globalStateDecay() {
-	int spikeBufferFull = 0;
+	// decay dopamine concentration (per group, cheap)
+	for (int grpId=0; grpId < numGrp; grpId++) {
+		if (grp_Info[grpId].Type&POISSON_NEURON)
+			continue;
+
+		if ((grp_Info[grpId].WithESTDPtype == DA_MOD || grp_Info[grpId].WithISTDP == DA_MOD) && 
+			cpuNetPtrs.grpDA[grpId] > grp_Info[grpId].baseDP)
+		{
+			cpuNetPtrs.grpDA[grpId] *= grp_Info[grpId].decayDP;
+		}
+	}
+
+	// decay homeostasis avg firing and conductances (per neuron, can be split across threads)
+	runThreadTask(&CpuSNN::globalStateDecayNeurons, numN);
+
+	// In CUBA mode, reset current to 0 each time step
+	if (!sim_with_conductances) {
+		resetCurrent();
+	}
+}
 
+void CpuSNN::globalStateDecayNeurons(int startN, int endN) {
 	// having outer loop is grpId produces slightly more code (every flag needs its own neurId inner loop)
 	// but avoids having to check the condition for every neuron in the network (= faster)
+	for (int grpId=0; grpId < numGrp; grpId++) {
+		// only look at the part of the group that falls into [startN, endN)
+		int grpStartN = std::max(grp_Info[grpId].StartN, startN);
+		int grpEndN = std::min(grp_Info[grpId].EndN, endN-1);
+		if (grpStartN > grpEndN || grpDecayFunc_[grpId] == NULL)
+			continue;
 
-	// decay the STP variables before adding new spikes.
-	for (int grpId=0; (grpId < numGrp) & !spikeBufferFull; grpId++) {
-		// decay homeostasis avg firing
-		if (grp_Info[grpId].WithHomeostasis) {
-			for(int i=grp_Info[grpId].StartN; i<=grp_Info[grpId].EndN; i++) {
-				avgFiring[i] *= grp_Info[grpId].avgTimeScale_decay;
+		// the flags of a group are fixed after setupNetwork, so they have been compiled into the function
+		(this->*grpDecayFunc_[grpId])(grpId, grpStartN, grpEndN);
+
+		if (synDelayIdx != NULL && grp_Info[grpId].WithSTDP) {
+			float decayExc = stdpPostTraceDecayExc_[grpId];
+			float decayInb = stdpPostTraceDecayInb_[grpId];
+			for (int i=grpStartN; i<=grpEndN; i++) {
+				stdpPostTraceExc[i] *= decayExc;
+				stdpPostTraceInb[i] *= decayInb;
+				if (stdpPostTraceExc[i] < STDP_TRACE_MIN) stdpPostTraceExc[i] = 0.0f; // avoid denormals
+				if (stdpPostTraceInb[i] < STDP_TRACE_MIN) stdpPostTraceInb[i] = 0.0f;
 			}
 		}
+	} // end grpId loop
 
-		// decay the STP variables before adding new spikes.
-		if (grp_Info[grpId].WithSTP) {
-			for(int i=grp_Info[grpId].StartN; i<=grp_Info[grpId].EndN; i++) {
-				int ind_plus  = STP_BUF_POS(i,simTime);
-				int ind_minus = STP_BUF_POS(i,(simTime-1));
-				stpu[ind_plus] = stpu[ind_minus]*(1.0-grp_Info[grpId].STP_tau_u_inv);
-				stpx[ind_plus] = stpx[ind_minus] + (1.0-stpx[ind_minus])*grp_Info[grpId].STP_tau_x_inv;
+	// decay the pre-synaptic STDP traces of all neurons (including Poisson) into the current history slot
+	if (synDelayIdx != NULL) {
+		for (int slot=0; slot<numSTDPPreTraceSlots_; slot++) {
+			float* trace = &stdpPreTrace[slot*numN*(maxDelay_+1)];
+			float decay = stdpPreTraceDecay_[slot];
+			for (int i=startN; i<endN; i++) {
+				// simTime+maxDelay_ is the same buffer position as simTime-1, but does not underflow at simTime==0
+				float x = trace[STP_BUF_POS(i,(simTime+maxDelay_))]*decay;
+				trace[STP_BUF_POS(i,simTime)] = (x < STDP_TRACE_MIN) ? 0.0f : x;
 			}
 		}
+	}
+}
 
-		if (grp_Info[grpId].Type&POISSON_NEURON)
-			continue;
-
-		// decay dopamine concentration
-		if ((grp_Info[grpId].WithESTDPtype == DA_MOD || grp_Info[grpId].WithISTDP == DA_MOD) && 
-			cpuNetPtrs.grpDA[grpId] > grp_Info[grpId].baseDP)
-		{
-			cpuNetPtrs.grpDA[grpId] *= grp_Info[grpId].decayDP;
+template<bool withHomeostasis, bool withConductances, bool withNMDArise, bool withGABAbRise>
+void CpuSNN::decayGroupState(int grpId, int startN, int endN) {
+	// decay homeostasis avg firing
+	if (withHomeostasis) {
+		for(int i=startN; i<=endN; i++) {
+			avgFiring[i] *= grp_Info[grpId].avgTimeScale_decay;
 		}
+	}
 
-		// decay conductances
-		if (sim_with_conductances) {
-			for(int i=grp_Info[grpId].StartN; i<=grp_Info[grpId].EndN; i++) {
-				gAMPA[i]  *= dAMPA;
-				gGABAa[i] *= dGABAa;
+	// decay conductances (never set for Poisson groups)
+	if (withConductances) {
+		for(int i=startN; i<=endN; i++) {
+			gAMPA[i]  *= dAMPA;
+			gGABAa[i] *= dGABAa;
 
-				if (sim_with_NMDA_rise) {
-					gNMDA_r[i] *= rNMDA;	// rise
-					gNMDA_d[i] *= dNMDA;	// decay
-				} else {
-					gNMDA[i]   *= dNMDA;	// instantaneous rise
-				}
+			if (withNMDArise) {
+				gNMDA_r[i] *= rNMDA;	// rise
+				gNMDA_d[i] *= dNMDA;	// decay
+			} else {
+				gNMDA[i]   *= dNMDA;	// instantaneous rise
+			}
 
-				if (sim_with_GABAb_rise) {
-					gGABAb_r[i] *= rGABAb;	// rise
-					gGABAb_d[i] *= dGABAb;	// decay
-				} else {
-					gGABAb[i] *= dGABAb;	// instantaneous rise
-				}
+			if (withGABAbRise) {
+				gGABAb_r[i] *= rGABAb;	// rise
+				gGABAb_d[i] *= dGABAb;	// decay
+			} else {
+				gGABAb[i] *= dGABAb;	// instantaneous rise
 			}
 		}
-	} // end grpId loop
-
-	// In CUBA mode, reset current to 0 each time step
-	if (!sim_with_conductances) {
-		resetCurrent();
 	}
 }
 
 void CpuSNN::findFiring() {
 	int spikeBufferFull = 0;
+	numFiredSTDP = 0;
 
 	for(int g=0; (g < numGrp) & !spikeBufferFull; g++) {
 		// given group of neurons belong to the poisson group....
@@ -3253,63 +3550,74 @@ void CpuSNN::findFiring() {
 				if (spikeBufferFull)
 					break;
 
-				// STDP calculation: the post-synaptic neuron fires after the arrival of a pre-synaptic spike
+				// remember the neuron for the STDP update below
 				if (!sim_in_testing && grp_Info[g].WithSTDP) {
-					unsigned int pos_ij = cumulativePre[i]; // the index of pre-synaptic neuron
-					for(int j=0; j < Npre_plastic[i]; pos_ij++, j++) {
-						int stdp_tDiff = (simTime-synSpikeTime[pos_ij]);
-						assert(!((stdp_tDiff < 0) && (synSpikeTime[pos_ij] != MAX_SIMULATION_TIME)));
-
-						if (stdp_tDiff > 0) {
-							// check this is an excitatory or inhibitory synapse
-							if (grp_Info[g].WithESTDP && maxSynWt[pos_ij] >= 0) { // excitatory synapse
-								// Handle E-STDP curve
-								switch (grp_Info[g].WithESTDPcurve) {
-								case EXP_CURVE: // exponential curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_EXC < 25)
-										wtChange[pos_ij] += STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-									break;
-								case TIMING_BASED_CURVE: // sc curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_EXC < 25) {
-										if (stdp_tDiff <= grp_Info[g].GAMMA)
-											wtChange[pos_ij] += grp_Info[g].OMEGA + grp_Info[g].KAPPA * STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-										else // stdp_tDiff > GAMMA
-											wtChange[pos_ij] -= STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_EXC, grp_Info[g].TAU_PLUS_INV_EXC);
-									}
-									break;
-								default:
-									KERNEL_ERROR("Invalid E-STDP curve!");
-									break;
-								}
-							} else if (grp_Info[g].WithISTDP && maxSynWt[pos_ij] < 0) { // inhibitory synapse
-								// Handle I-STDP curve
-								switch (grp_Info[g].WithISTDPcurve) {
-								case EXP_CURVE: // exponential curve
-									if (stdp_tDiff * grp_Info[g].TAU_PLUS_INV_INB < 25) { // LTP of inhibitory synapse, which decreases synapse weight
-										wtChange[pos_ij] -= STDP(stdp_tDiff, grp_Info[g].ALPHA_PLUS_INB, grp_Info[g].TAU_PLUS_INV_INB);
-									}
-									break;
-								case PULSE_CURVE: // pulse curve
-									if (stdp_tDiff <= grp_Info[g].LAMBDA) { // LTP of inhibitory synapse, which decreases synapse weight
-										wtChange[pos_ij] -= grp_Info[g].BETA_LTP;
-										//printf("I-STDP LTP\n");
-									} else if (stdp_tDiff <= grp_Info[g].DELTA) { // LTD of inhibitory syanpse, which increase sysnapse weight
-										wtChange[pos_ij] -= grp_Info[g].BETA_LTD;
-										//printf("I-STDP LTD\n");
-									} else { /*do nothing*/}
-									break;
-								default:
-									KERNEL_ERROR("Invalid I-STDP curve!");
-									break;
-								}
-							}
-						}
-					}
+					firedSTDP[numFiredSTDP++] = i;
 				}
 				spikeCountAll1secHost++;
 			}
 		}
 	}
+
+	// STDP calculation: the post-synaptic neuron fires after the arrival of a pre-synaptic spike
+	// every neuron only touches its own incoming synapses, so the fired neurons can be split across threads
+	if (numFiredSTDP) {
+		runThreadTask(&CpuSNN::findFiringSTDP, numFiredSTDP);
+	}
+}
+
+void CpuSNN::findFiringSTDP(int startIdx, int endIdx) {
+	for (int k=startIdx; k<endIdx; k++) {
+		int i = firedSTDP[k];
+		short int g = grpIds[i];
+		const stdp_lut_t& ltpExc = ltpExcLUT_[g];
+		const stdp_lut_t& ltpInb = ltpInbLUT_[g];
+		bool excWithTrace = stdpPreTraceSlotExc_[g] >= 0; // otherwise the lookup table is used
+		bool inbWithTrace = stdpPreTraceSlotInb_[g] >= 0;
+
+		// bring skipped weight changes up to date before adding to them, and make updateWeights visit the neuron
+		if (wtUpdateLast != NULL && wtUpdateLast[i] != wtUpdateCnt_)
+			catchUpWeightsNeurons(i, i+1);
+		wtChangePending[i] = 1;
+
+		unsigned int pos_ij = cumulativePre[i]; // the index of pre-synaptic neuron
+		for(int j=0; j < Npre_plastic[i]; pos_ij++, j++) {
+			int stdp_tDiff = (simTime-synSpikeTime[pos_ij]);
+			assert(!((stdp_tDiff < 0) && (synSpikeTime[pos_ij] != MAX_SIMULATION_TIME)));
+
+			if (stdp_tDiff > 0) {
+				// the lookup tables hold the complete E-/I-STDP curves, including the cutoff (see buildSTDPLookupTables)
+				if (grp_Info[g].WithESTDP && maxSynWt[pos_ij] >= 0) { // excitatory synapse
+					if (stdp_tDiff < ltpExc.len)
+						wtChange[pos_ij] += excWithTrace ? getSTDPPlusFromTrace(g, true, stdp_tDiff, pos_ij)
+							: ltpExc.wtChange[stdp_tDiff];
+				} else if (grp_Info[g].WithISTDP && maxSynWt[pos_ij] < 0) { // inhibitory synapse
+					if (stdp_tDiff < ltpInb.len)
+						wtChange[pos_ij] += inbWithTrace ? getSTDPPlusFromTrace(g, false, stdp_tDiff, pos_ij)
+							: ltpInb.wtChange[stdp_tDiff];
+				}
+			}
+		}
+	}
+}
+
+float CpuSNN::getSTDPPlusFromTrace(int grpId, bool isExc, int stdp_tDiff, unsigned int pos_i) {
+	int slot = isExc ? stdpPreTraceSlotExc_[grpId] : stdpPreTraceSlotInb_[grpId];
+	assert(slot >= 0);
+
+	// the last spike at this synapse arrived stdp_tDiff ms ago and left the pre-neuron tD ms before that, so the trace
+	// slot simTime-1-tD holds exp(-(stdp_tDiff-1)*tauInv) (simTime+maxDelay_ is simTime-1 in the history buffer)
+	int pre_i = GET_CONN_NEURON_ID(preSynapticIds[pos_i]);
+	float x = stdpPreTrace[slot*numN*(maxDelay_+1) + STP_BUF_POS(pre_i,(simTime+maxDelay_-synDelayIdx[pos_i]))];
+	x *= stdpPreTraceDecay_[slot];
+
+	if (!isExc) // EXP_CURVE, LTP of inhibitory synapse decreases the synapse weight
+		return -grp_Info[grpId].ALPHA_PLUS_INB*x;
+
+	x *= grp_Info[grpId].ALPHA_PLUS_EXC;
+	if (grp_Info[grpId].WithESTDPcurve == TIMING_BASED_CURVE)
+		return (stdp_tDiff <= grp_Info[grpId].GAMMA) ? grp_Info[grpId].OMEGA + grp_Info[grpId].KAPPA*x : -x;
+	return x;
 }
 
 int CpuSNN::findGrpId(int nid) {
@@ -3339,7 +3647,9 @@ void CpuSNN::findMaxNumSynapses(int* numPostSynapses, int* numPreSynapses) {
 	}
 }
 
-void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD) {
+void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned int offset, unsigned int tD,
+	int* daSpikeCnt)
+{
 	// get synaptic info...
 	post_info_t post_info = postSynapticIds[offset + idx_d];
 
@@ -3347,14 +3657,22 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 	unsigned int post_i = GET_CONN_NEURON_ID(post_info);
 	assert(post_i<(unsigned int)numN);
 
-	// get syn id
-	int s_i = GET_CONN_SYN_ID(post_info);
-	assert(s_i<(Npre[post_i]));
-
 	// get the cumulative position for quick access
-	unsigned int pos_i = cumulativePre[post_i] + s_i;
+	unsigned int pos_i;
+	if (postSynPreIdx != NULL) {
+		pos_i = postSynPreIdx[offset + idx_d];
+	} else {
+		// get syn id
+		int s_i = GET_CONN_SYN_ID(post_info);
+		assert(s_i<(Npre[post_i]));
+		pos_i = cumulativePre[post_i] + s_i;
+	}
 	assert(post_i < (unsigned int)numNReg); // \FIXME is this assert supposed to be for pos_i?
 
+	// the weights of post_i may lag behind if updateWeights skipped it
+	if (wtUpdateLast != NULL && wtUpdateLast[post_i] != wtUpdateCnt_)
+		catchUpWeightsNeurons(post_i, post_i+1);
+
 	// get group id of pre- / post-neuron
 	short int post_grpId = grpIds[post_i];
 	short int pre_grpId = grpIds[pre_i];
@@ -3365,13 +3683,13 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 	// mulSynFast/Slow per synapse or storing a pointer to grpConnectInfo_s)
 	// mulSynFast will be applied to fast currents (either AMPA or GABAa)
 	// mulSynSlow will be applied to slow currents (either NMDA or GABAb)
-	short int mulIndex = cumConnIdPre[pos_i];
+	short int mulIndex = (postSynConnId != NULL) ? postSynConnId[offset + idx_d] : cumConnIdPre[pos_i];
 	assert(mulIndex>=0 && mulIndex<numConnections);
 
 
 	// for each presynaptic spike, postsynaptic (synaptic) current is going to increase by some amplitude (change)
 	// generally speaking, this amplitude is the weight; but it can be modulated by STP
-	float change = wt[pos_i];
+	float change = (postSynWt != NULL) ? postSynWt[offset + idx_d] : wt[pos_i];
 
 	if (grp_Info[pre_grpId].WithSTP) {
 		// if pre-group has STP enabled, we need to modulate the weight
@@ -3379,16 +3697,10 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 		// use u^+ (value right after spike-update) but x^- (value right before spike-update)
 
 		// dI/dt = -I/tau_S + A * u^+ * x^- * \delta(t-t_{spk})
-		// I noticed that for connect(.., RangeDelay(1), ..) tD will be 0
-		int ind_minus = STP_BUF_POS(pre_i,(simTime-tD-1));
-		int ind_plus  = STP_BUF_POS(pre_i,(simTime-tD));
-
-		change *= grp_Info[pre_grpId].STP_A*stpu[ind_plus]*stpx[ind_minus];
-
-//		fprintf(stderr,"%d: %d[%d], numN=%d, td=%d, maxDelay_=%d, ind-=%d, ind+=%d, stpu=[%f,%f], stpx=[%f,%f], change=%f, wt=%f\n",
-//			simTime, pre_grpId, pre_i,
-//					numN, tD, maxDelay_, ind_minus, ind_plus,
-//					stpu[ind_minus], stpu[ind_plus], stpx[ind_minus], stpx[ind_plus], change, wt[pos_i]);
+		// STP only supports RangeDelay(1), so tD is 0 and the spike is the last one of pre_i (see addSpikeToTable)
+		assert(tD == 0);
+		int k = stpGrpOffset_[pre_grpId] + pre_i - grp_Info[pre_grpId].StartN;
+		change *= grp_Info[pre_grpId].STP_A*stpLastU[k]*stpLastX[k];
 	}
 
 	// update currents
@@ -3422,7 +3734,11 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 
 	// Got one spike from dopaminergic neuron, increase dopamine concentration in the target area
 	if (pre_type & TARGET_DA) {
-		cpuNetPtrs.grpDA[post_grpId] += 0.04;
+		if (daSpikeCnt == NULL) {
+			cpuNetPtrs.grpDA[post_grpId] += 0.04;
+		} else {
+			daSpikeCnt[post_grpId]++;
+		}
 	}
 
 	// STDP calculation: the post-synaptic neuron fires before the arrival of a pre-synaptic spike
@@ -3430,36 +3746,24 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 		int stdp_tDiff = (simTime-lastSpikeTime[post_i]);
 
 		if (stdp_tDiff >= 0) {
+			// the lookup tables hold the complete E-/I-STDP curves, including the cutoff (see buildSTDPLookupTables)
 			if (grp_Info[post_grpId].WithISTDP && ((pre_type & TARGET_GABAa) || (pre_type & TARGET_GABAb))) { // inhibitory syanpse
-				// Handle I-STDP curve
-				switch (grp_Info[post_grpId].WithISTDPcurve) {
-				case EXP_CURVE: // exponential curve
-					if ((stdp_tDiff*grp_Info[post_grpId].TAU_MINUS_INV_INB)<25) { // LTD of inhibitory syanpse, which increase synapse weight
-						wtChange[pos_i] -= STDP(stdp_tDiff, grp_Info[post_grpId].ALPHA_MINUS_INB, grp_Info[post_grpId].TAU_MINUS_INV_INB);
+				const stdp_lut_t& ltdInb = ltdInbLUT_[post_grpId];
+				if (stdp_tDiff < ltdInb.len) {
+					wtChangePending[post_i] = 1;
+					if (stdpPostTraceInb != NULL && grp_Info[post_grpId].WithISTDPcurve == EXP_CURVE) {
+						// LTD of inhibitory syanpse, which increase synapse weight
+						wtChange[pos_i] -= grp_Info[post_grpId].ALPHA_MINUS_INB*stdpPostTraceInb[post_i];
+					} else {
+						wtChange[pos_i] += ltdInb.wtChange[stdp_tDiff];
 					}
-					break;
-				case PULSE_CURVE: // pulse curve
-					if (stdp_tDiff <= grp_Info[post_grpId].LAMBDA) { // LTP of inhibitory synapse, which decreases synapse weight
-						wtChange[pos_i] -= grp_Info[post_grpId].BETA_LTP;
-					} else if (stdp_tDiff <= grp_Info[post_grpId].DELTA) { // LTD of inhibitory syanpse, which increase synapse weight
-						wtChange[pos_i] -= grp_Info[post_grpId].BETA_LTD;
-					} else { /*do nothing*/ }
-					break;
-				default:
-					KERNEL_ERROR("Invalid I-STDP curve");
-					break;
 				}
 			} else if (grp_Info[post_grpId].WithESTDP && ((pre_type & TARGET_AMPA) || (pre_type & TARGET_NMDA))) { // excitatory synapse
-				// Handle E-STDP curve
-				switch (grp_Info[post_grpId].WithESTDPcurve) {
-				case EXP_CURVE: // exponential curve
-				case TIMING_BASED_CURVE: // sc curve
-					if (stdp_tDiff * grp_Info[post_grpId].TAU_MINUS_INV_EXC < 25)
-						wtChange[pos_i] += STDP(stdp_tDiff, grp_Info[post_grpId].ALPHA_MINUS_EXC, grp_Info[post_grpId].TAU_MINUS_INV_EXC);
-					break;
-				default:
-					KERNEL_ERROR("Invalid E-STDP curve");
-					break;
+				const stdp_lut_t& ltdExc = ltdExcLUT_[post_grpId];
+				if (stdp_tDiff < ltdExc.len) {
+					wtChangePending[post_i] = 1;
+					wtChange[pos_i] += (stdpPostTraceExc != NULL) ? grp_Info[post_grpId].ALPHA_MINUS_EXC*stdpPostTraceExc[post_i]
+						: ltdExc.wtChange[stdp_tDiff];
 				}
 			} else { /*do nothing*/ }
 		}
@@ -3467,15 +3771,57 @@ void CpuSNN::generatePostSpike(unsigned int pre_i, unsigned int idx_d, unsigned
 	}
 }
 
+void CpuSNN::generatePostSpikes(unsigned int pre_i, unsigned int bucketIdx, int startPostN, int endPostN,
+	int* daSpikeCnt)
+{
+	assert(bucketIdx>=postDelayBucketCum[pre_i] && bucketIdx<postDelayBucketCum[pre_i+1]);
+	delay_bucket_t dPar = postDelayBuckets[bucketIdx];
+	unsigned int tD = dPar.tD;
+	unsigned int offset = cumulativePost[pre_i];
+
+	int idxStart = dPar.delay_index_start;
+	int idxEnd = dPar.delay_index_start + dPar.delay_length;
+
+	// the synapses of each delay are sorted by post-synaptic neuron id (see reorganizeDelay), so the synapses
+	// that project to [startPostN, endPostN) are a contiguous range that we can find with a binary search
+	if (startPostN > 0) {
+		int lo = idxStart, hi = idxEnd;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if ((int)GET_CONN_NEURON_ID(postSynapticIds[offset + mid]) < startPostN)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		idxStart = lo;
+	}
+	if (endPostN < numNReg) {
+		int lo = idxStart, hi = idxEnd;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if ((int)GET_CONN_NEURON_ID(postSynapticIds[offset + mid]) < endPostN)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		idxEnd = lo;
+	}
+
+	// for each delay variables
+	for(int idx_d = idxStart; idx_d < idxEnd; idx_d++) {
+		generatePostSpike(pre_i, idx_d, offset, tD, daSpikeCnt);
+	}
+}
+
 void CpuSNN::generateSpikes() {
+	// the spikes scheduled for the current time step are stored contiguously
 	PropagatedSpikeBuffer::const_iterator srg_iter;
 	PropagatedSpikeBuffer::const_iterator srg_iter_end = pbuf->endSpikeTargetGroups();
 
 	for( srg_iter = pbuf->beginSpikeTargetGroups(); srg_iter != srg_iter_end; ++srg_iter )  {
 		// Get the target neurons for the given groupId
-		int nid	 = srg_iter->stg;
-		//delaystep_t del = srg_iter->delay;
-		//generate a spike to all the target neurons from source neuron nid with a delay of del
+		int nid	 = *srg_iter;
+		//generate a spike to all the target neurons from source neuron nid
 		short int g = grpIds[nid];
 
 		addSpikeToTable (nid, g);
@@ -3539,12 +3885,7 @@ void CpuSNN::generateSpikesFromFuncPtr(int grpId) {
 }
 
 void CpuSNN::generateSpikesFromRate(int grpId) {
-	bool done;
 	PoissonRate* rate = grp_Info[grpId].RatePtr;
-	float refPeriod = grp_Info[grpId].RefractPeriod;
-	int timeSlice   = grp_Info[grpId].CurrTimeSlice;
-	unsigned int currTime = simTime;
-	int spikeCnt = 0;
 
 	if (rate == NULL)
 		return;
@@ -3561,41 +3902,74 @@ void CpuSNN::generateSpikesFromRate(int grpId) {
 		exitSimulation(1);
 	}
 
-	for (int neurId=0; neurId<nNeur; neurId++) {
-		float frate = rate->getRate(neurId);
-
-		// start the time from the last time it spiked, that way we can ensure that the refractory period is maintained
-		unsigned int nextTime = lastSpikeTime[grp_Info[grpId].StartN + neurId];
-		if (nextTime == MAX_SIMULATION_TIME)
-			nextTime = 0;
-
-		done = false;
-		while (!done && frate>0) {
-			nextTime = poissonSpike(nextTime, frate/1000.0, refPeriod);
-			// found a valid timeSlice
-			if (nextTime < (currTime+timeSlice)) {
-				if (nextTime >= currTime) {
-//					int nid = grp_Info[grpId].StartN+cnt;
-					pbuf->scheduleSpikeTargetGroup(grp_Info[grpId].StartN + neurId, nextTime-currTime);
-					spikeCnt++;
-
-					// update number of spikes if SpikeCounter set
-					if (grp_Info[grpId].withSpikeCounter) {
-						int bufPos = grp_Info[grpId].spkCntBufPos; // retrieve buf pos
-						spkCntBuf[bufPos][neurId]++;
-					}
-				}
-			}
-			else {
-				done=true;
-			}
-		}
+	// every thread fills its own shard of the spike buffer, the shards are then appended in the order of the neurons
+	rateGenGrpId_ = grpId;
+	if (threadPool_ == NULL) {
+		generateSpikesFromRateShards(0, 1);
+	} else {
+		runThreadTask(&CpuSNN::generateSpikesFromRateShards, threadPool_->getNumThreads());
 	}
+	pbuf->mergeShards();
 }
 
-inline int CpuSNN::getPoissNeuronPos(int nid) {
-	int nPos = nid-numNReg;
-	assert(nid >= numNReg);
+void CpuSNN::generateSpikesFromRateShards(int startShard, int endShard) {
+	int grpId = rateGenGrpId_;
+	const float* rates = grp_Info[grpId].RatePtr->getRatePtrCPU();
+	int refPeriod = (int)grp_Info[grpId].RefractPeriod;
+	unsigned int currTime = simTime;
+	unsigned int endTime = simTime + grp_Info[grpId].CurrTimeSlice;
+	int nNeur = grp_Info[grpId].SizeN;
+	int numShards = (threadPool_ == NULL) ? 1 : threadPool_->getNumThreads();
+
+	// refractory period must be 1 or greater, 0 means could have multiple spikes specified at the same time.
+	assert(refPeriod>0);
+
+	for (int shard=startShard; shard<endShard; shard++) {
+		int startNeur = (int)((long long)nNeur * shard / numShards);
+		int endNeur = (int)((long long)nNeur * (shard+1) / numShards);
+
+		for (int neurId=startNeur; neurId<endNeur; neurId++) {
+			float frate = rates[neurId];
+			assert(frate>=0.0f);
+			if (frate <= 0.0f)
+				continue;
+
+			// ISIs are drawn from an exponential distribution (in ms, rounded down), and ISIs shorter than the
+			// refractory period are rejected. The exponential distribution is memoryless, so this is the same as
+			// drawing an ISI from the first time step the neuron is allowed to spike again: that is, from the end of
+			// the refractory period after the last spike, or from the beginning of the current time slice.
+			int nid = grp_Info[grpId].StartN + neurId;
+			unsigned int lastTime = lastSpikeTime[nid];
+			unsigned int nextTime = (lastTime == MAX_SIMULATION_TIME ? 0 : lastTime) + refPeriod;
+			if (nextTime < currTime)
+				nextTime = currTime;
+
+			// the random numbers only depend on (seed, neuron, time slice), not on the thread that draws them
+			CpuCounterRandom rng(randSeed_, cpuRandomStreamId(RAND_STREAM_POISSON, grpId, neurId), currTime);
+			float meanISI = 1000.0f/frate;
+			while (nextTime < endTime) {
+				float isi = -logf(rng.nextFloatOpenClosed()) * meanISI;
+				if (isi >= (float)(endTime - nextTime))
+					break;
+
+				nextTime += (unsigned int)isi;
+				pbuf->scheduleSpikeTargetGroup(nid, nextTime-currTime, shard);
+
+				// update number of spikes if SpikeCounter set
+				if (grp_Info[grpId].withSpikeCounter) {
+					int bufPos = grp_Info[grpId].spkCntBufPos; // retrieve buf pos
+					spkCntBuf[bufPos][neurId]++;
+				}
+
+				nextTime += refPeriod;
+			}
+		}
+	}
+}
+
+inline int CpuSNN::getPoissNeuronPos(int nid) {
+	int nPos = nid-numNReg;
+	assert(nid >= numNReg);
 	assert(nid < numN);
 	assert((nid-numNReg) < numNPois);
 	return nPos;
@@ -3604,7 +3978,7 @@ inline int CpuSNN::getPoissNeuronPos(int nid) {
 //We need pass the neuron id (nid) and the grpId just for the case when we want to
 //ramp up/down the weights.  In that case we need to set the weights of each synapse
 //depending on their nid (their position with respect to one another). -- KDC
-float CpuSNN::getWeights(int connProp, float initWt, float maxWt, unsigned int nid, int grpId) {
+float CpuSNN::getWeights(int connProp, float initWt, float maxWt, unsigned int nid, int grpId, CpuRandomStream& rng) {
 	float actWts;
 	// \FIXME: are these ramping thingies still supported?
 	bool setRandomWeights   = GET_INITWTS_RANDOM(connProp);
@@ -3612,7 +3986,7 @@ float CpuSNN::getWeights(int connProp, float initWt, float maxWt, unsigned int n
 	bool setRampUpWeights   = GET_INITWTS_RAMPUP(connProp);
 
 	if (setRandomWeights)
-		actWts = initWt * drand48();
+		actWts = initWt * rng.nextDouble();
 	else if (setRampUpWeights)
 		actWts = (initWt + ((nid - grp_Info[grpId].StartN) * (maxWt - initWt) / grp_Info[grpId].SizeN));
 	else if (setRampDownWeights)
@@ -3649,6 +4023,163 @@ float dudtIzhikevich9(float volt, float recov, float voltRest, float izhA, float
 	return ( izhA * (izhB * (volt - voltRest) - recov) * timeStep );
 }
 
+// The integration kernels below work on whole ranges of neurons of the same group. Instead of branching on a spike,
+// the spike condition is evaluated into a flag that selects between reset and non-reset values. This keeps the loop
+// bodies free of control flow, which allows the compiler to vectorize them. For that to work:
+// - all arrays are passed as restrict-qualified arguments, so that the loops don't need alias checks
+// - the reset parameters are loaded unconditionally, and the recovery reset is added as flag*d (a conditional float
+//   add would be turned back into a branch because it might trap)
+// - the flag is an int and the spike array is written as bytes (bool stores are not vectorized)
+static void integrateEulerIzhikevich4Kernel(int startN, int endN, float dt, const float* RESTRICT Itot,
+	const float* RESTRICT izhA, const float* RESTRICT izhB, const float* RESTRICT izhC, const float* RESTRICT izhD,
+	const float* RESTRICT vCurr, float* RESTRICT vNext, float* RESTRICT u, unsigned char* RESTRICT spk)
+{
+	for (int i=startN; i<=endN; i++) {
+		float v = vCurr[i] + dvdtIzhikevich4(vCurr[i], u[i], Itot[i], dt);
+		float c = izhC[i];
+		float d = izhD[i];
+		int hasSpiked = v > 30.0f;
+		float rec = u[i] + (float)hasSpiked * d;
+		v = hasSpiked ? c : v;
+		v = (v < -90.0f) ? -90.0f : v;
+
+		// To maintain consistency with Izhikevich' original Matlab code, recovery is based on nextVoltage.
+		u[i] = rec + dudtIzhikevich4(v, rec, izhA[i], izhB[i], dt);
+		vNext[i] = v;
+		spk[i] |= (unsigned char)hasSpiked;
+	}
+}
+
+static void integrateEulerIzhikevich9Kernel(int startN, int endN, float dt, const float* RESTRICT Itot,
+	const float* RESTRICT izhCapac, const float* RESTRICT izhK, const float* RESTRICT izhVr,
+	const float* RESTRICT izhVt, const float* RESTRICT izhVpeak, const float* RESTRICT izhA,
+	const float* RESTRICT izhB, const float* RESTRICT izhC, const float* RESTRICT izhD, const float* RESTRICT vCurr,
+	float* RESTRICT vNext, float* RESTRICT u, unsigned char* RESTRICT spk)
+{
+	for (int i=startN; i<=endN; i++) {
+		float inverse_C = 1.0f / izhCapac[i];
+		float v = vCurr[i] + dvdtIzhikevich9(vCurr[i], u[i], inverse_C, izhK[i], izhVr[i], izhVt[i], Itot[i], dt);
+		float c = izhC[i];
+		float d = izhD[i];
+		int hasSpiked = v > izhVpeak[i];
+		float rec = u[i] + (float)hasSpiked * d;
+		v = hasSpiked ? c : v;
+		v = (v < -90.0f) ? -90.0f : v;
+
+		// To maintain consistency with Izhikevich' original Matlab code, recovery is based on nextVoltage.
+		u[i] = rec + dudtIzhikevich9(v, rec, izhVr[i], izhA[i], izhB[i], dt);
+		vNext[i] = v;
+		spk[i] |= (unsigned char)hasSpiked;
+	}
+}
+
+static void integrateRK4Izhikevich4Kernel(int startN, int endN, float dt, const float* RESTRICT Itot,
+	const float* RESTRICT izhA, const float* RESTRICT izhB, const float* RESTRICT izhC, const float* RESTRICT izhD,
+	const float* RESTRICT vCurr, float* RESTRICT vNext, float* RESTRICT u, unsigned char* RESTRICT spk)
+{
+	for (int i=startN; i<=endN; i++) {
+		float v0 = vCurr[i];
+		float u0 = u[i];
+		float I = Itot[i];
+		float a = izhA[i];
+		float b = izhB[i];
+
+		float k1 = dvdtIzhikevich4(v0, u0, I, dt);
+		float l1 = dudtIzhikevich4(v0, u0, a, b, dt);
+
+		float k2 = dvdtIzhikevich4(v0 + k1/2.0f, u0 + l1/2.0f, I, dt);
+		float l2 = dudtIzhikevich4(v0 + k1/2.0f, u0 + l1/2.0f, a, b, dt);
+
+		float k3 = dvdtIzhikevich4(v0 + k2/2.0f, u0 + l2/2.0f, I, dt);
+		float l3 = dudtIzhikevich4(v0 + k2/2.0f, u0 + l2/2.0f, a, b, dt);
+
+		float k4 = dvdtIzhikevich4(v0 + k3, u0 + l3, I, dt);
+		float l4 = dudtIzhikevich4(v0 + k3, u0 + l3, a, b, dt);
+
+		float v = v0 + (1.0f / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
+		float c = izhC[i];
+		float d = izhD[i];
+		int hasSpiked = v > 30.0f;
+		float rec = u0 + (float)hasSpiked * d;
+		v = hasSpiked ? c : v;
+		v = (v < -90.0f) ? -90.0f : v;
+
+		u[i] = rec + (1.0f / 6.0f) * (l1 + 2.0f * l2 + 2.0f * l3 + l4);
+		vNext[i] = v;
+		spk[i] |= (unsigned char)hasSpiked;
+	}
+}
+
+static void integrateRK4Izhikevich9Kernel(int startN, int endN, float dt, const float* RESTRICT Itot,
+	const float* RESTRICT izhCapac, const float* RESTRICT izhK, const float* RESTRICT izhVr,
+	const float* RESTRICT izhVt, const float* RESTRICT izhVpeak, const float* RESTRICT izhA,
+	const float* RESTRICT izhB, const float* RESTRICT izhC, const float* RESTRICT izhD, const float* RESTRICT vCurr,
+	float* RESTRICT vNext, float* RESTRICT u, unsigned char* RESTRICT spk)
+{
+	for (int i=startN; i<=endN; i++) {
+		float v0 = vCurr[i];
+		float u0 = u[i];
+		float I = Itot[i];
+		float inverse_C = 1.0f / izhCapac[i];
+		float k = izhK[i];
+		float vr = izhVr[i];
+		float vt = izhVt[i];
+		float a = izhA[i];
+		float b = izhB[i];
+
+		float k1 = dvdtIzhikevich9(v0, u0, inverse_C, k, vr, vt, I, dt);
+		float l1 = dudtIzhikevich9(v0, u0, vr, a, b, dt);
+
+		float k2 = dvdtIzhikevich9(v0 + k1/2.0f, u0 + l1/2.0f, inverse_C, k, vr, vt, I, dt);
+		float l2 = dudtIzhikevich9(v0 + k1/2.0f, u0 + l1/2.0f, vr, a, b, dt);
+
+		float k3 = dvdtIzhikevich9(v0 + k2/2.0f, u0 + l2/2.0f, inverse_C, k, vr, vt, I, dt);
+		float l3 = dudtIzhikevich9(v0 + k2/2.0f, u0 + l2/2.0f, vr, a, b, dt);
+
+		float k4 = dvdtIzhikevich9(v0 + k3, u0 + l3, inverse_C, k, vr, vt, I, dt);
+		float l4 = dudtIzhikevich9(v0 + k3, u0 + l3, vr, a, b, dt);
+
+		float v = v0 + (1.0f / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
+		float c = izhC[i];
+		float d = izhD[i];
+		int hasSpiked = v > izhVpeak[i];
+		float rec = u0 + (float)hasSpiked * d;
+		v = hasSpiked ? c : v;
+		v = (v < -90.0f) ? -90.0f : v;
+
+		u[i] = rec + (1.0f / 6.0f) * (l1 + 2.0f * l2 + 2.0f * l3 + l4);
+		vNext[i] = v;
+		spk[i] |= (unsigned char)hasSpiked;
+	}
+}
+
+// sums up the synaptic current of a COBA group, see updateTotalCurrent
+template<bool withNMDArise, bool withGABAbRise>
+static void sumConductanceCurrentKernel(int startN, int endN, const float* RESTRICT v, const float* RESTRICT Iext,
+	const float* RESTRICT gAMPA, const float* RESTRICT gNMDA, const float* RESTRICT gNMDA_d,
+	const float* RESTRICT gNMDA_r, const float* RESTRICT gGABAa, const float* RESTRICT gGABAb,
+	const float* RESTRICT gGABAb_d, const float* RESTRICT gGABAb_r, float* RESTRICT Itot)
+{
+	for (int i=startN; i<=endN; i++) {
+		float tmp_gNMDA = withNMDArise ? gNMDA_d[i]-gNMDA_r[i] : gNMDA[i];
+		float tmp_gGABAb = withGABAbRise ? gGABAb_d[i]-gGABAb_r[i] : gGABAb[i];
+		float tmp_iNMDA = (v[i] + 80.0f) * (v[i] + 80.0f) / 60.0f / 60.0f;
+		Itot[i] = Iext[i] - (gAMPA[i] * (v[i] - 0.0f) +
+			tmp_gNMDA * tmp_iNMDA / (1.0f + tmp_iNMDA) * (v[i] - 0.0f) +
+			gGABAa[i] * (v[i] + 70.0f) +
+			tmp_gGABAb * (v[i] + 90.0f));
+	}
+}
+
+// sums up the synaptic current of a CUBA group, see updateTotalCurrent
+static void sumCurrentKernel(int startN, int endN, const float* RESTRICT Iext, const float* RESTRICT I,
+	float* RESTRICT Itot)
+{
+	for (int i=startN; i<=endN; i++) {
+		Itot[i] = Iext[i] + I[i];
+	}
+}
+
 float CpuSNN::getCompCurrent(int grpId, int neurId, float const0, float const1) {
 	float compCurrent = 0.0f;
 	for (int k=0; k<grp_Info[grpId].numCompNeighbors; k++) {
@@ -3670,175 +4201,249 @@ void  CpuSNN::globalStateUpdate() {
 	// We do it this way because compartmental currents depend on neighboring neuron's voltages.
 	// We don't need a nextRecovery buffer because every neuron depends only on its own recovery value.
 	for (int j=1; j<=simNumStepsPerMs_; j++) {
+		// update group dopamine
 		for(int g=0; g<numGrp; g++) {
 			if (grp_Info[g].Type & POISSON_NEURON) {
 				continue;
 			}
-
-			// update group dopamine
 			cpuNetPtrs.grpDABuffer[g][simTimeMs] = cpuNetPtrs.grpDA[g];
+		}
 
-			for (int i=grp_Info[g].StartN; i<=grp_Info[g].EndN; i++) {
-				// pre-load izhikevich variables to avoid unnecessary memory accesses + unclutter the code.
-				float k = Izh_k[i];
-				float vr = Izh_vr[i];
-				float vt = Izh_vt[i];
-				float inverse_C = 1.0f / Izh_C[i];
-				float a = Izh_a[i];
-				float b = Izh_b[i];
-
-				// sum up total current = synaptic + external + compartmental
-				float totalCurrent = extCurrent[i];
-				if (sim_with_conductances) { // COBA model
-					float tmp_gNMDA = sim_with_NMDA_rise ? gNMDA_d[i]-gNMDA_r[i] : gNMDA[i];
-					float tmp_gGABAb = sim_with_GABAb_rise ? gGABAb_d[i]-gGABAb_r[i] : gGABAb[i];
-					float tmp_iNMDA = (voltage[i] + 80.0f) * (voltage[i] + 80.0f) / 60.0f / 60.0f;
-
-					totalCurrent += -(gAMPA[i] * (voltage[i] - 0.0f) +
-						tmp_gNMDA * tmp_iNMDA / (1.0f + tmp_iNMDA) * (voltage[i] - 0.0f) +
-						gGABAa[i] * (voltage[i] + 70.0f) +
-						tmp_gGABAb * (voltage[i] + 90.0f));
-				} else { // CUBA model
-					totalCurrent += current[i];
-				}
-				if (grp_Info[g].withCompartments) {
-					totalCurrent += getCompCurrent(g, i);
-				}
-
-				switch (simIntegrationMethod_) {
-				case FORWARD_EULER:
-					if (!grp_Info[g].withParamModel_9) {
-						// 4-param Izhikevich
-						nextVoltage[i] = voltage[i] + dvdtIzhikevich4(voltage[i], recovery[i], totalCurrent, timeStep_);
-						if (nextVoltage[i] > 30.0f) {
-							nextVoltage[i] = 30.0f;
-							curSpike[i] = true;
-							nextVoltage[i] = Izh_c[i];
-							recovery[i] += Izh_d[i];
-						}
-					} else {
-						// 9-param Izhikevich
-						nextVoltage[i] = voltage[i] + dvdtIzhikevich9(voltage[i], recovery[i], inverse_C, k, vr, vt, 
-							totalCurrent, timeStep_);
-						if (nextVoltage[i] > Izh_vpeak[i]) {
-							nextVoltage[i] = Izh_vpeak[i];
-							curSpike[i] = true;
-							nextVoltage[i] = Izh_c[i];
-							recovery[i] += Izh_d[i];
-						}
-					}
-					if (nextVoltage[i] < -90.0f) {
-						nextVoltage[i] = -90.0f;
-					}
-					#if defined(WIN32) || defined(WIN64)
-						assert(!_isnan(nextVoltage[i]));
-						assert(_finite(nextVoltage[i]));
-					#else
-						assert(!isnan(nextVoltage[i]));
-						assert(!isinf(nextVoltage[i]));
-					#endif
-
-					// To maintain consistency with Izhikevich' original Matlab code, recovery is based on nextVoltage.
-					if (!grp_Info[g].withParamModel_9) {
-						recovery[i] += dudtIzhikevich4(nextVoltage[i], recovery[i], a, b, timeStep_);
-					} else {
-						recovery[i] += dudtIzhikevich9(nextVoltage[i], recovery[i], vr, a, b, timeStep_);
-					}
-
-					break;
-				case RUNGE_KUTTA4:
-					// TODO for Stas
-					if (!grp_Info[g].withParamModel_9) {
-						// 4-param Izhikevich
-						float k1 = dvdtIzhikevich4(voltage[i], recovery[i], totalCurrent, timeStep_);
-						float l1 = dudtIzhikevich4(voltage[i], recovery[i], a, b, timeStep_);
-
-						float k2 = dvdtIzhikevich4(voltage[i] + k1/2.0f, recovery[i] + l1/2.0f, totalCurrent, 
-							timeStep_);
-						float l2 = dudtIzhikevich4(voltage[i] + k1/2.0f, recovery[i] + l1/2.0f, a, b, timeStep_);
-
-						float k3 = dvdtIzhikevich4(voltage[i] + k2/2.0f, recovery[i] + l2/2.0f, totalCurrent, 
-							timeStep_);
-						float l3 = dudtIzhikevich4(voltage[i] + k2/2.0f, recovery[i] + l2/2.0f, a, b, timeStep_);
-
-						float k4 = dvdtIzhikevich4(voltage[i] + k3, recovery[i] + l3, totalCurrent, timeStep_);
-						float l4 = dudtIzhikevich4(voltage[i] + k3, recovery[i] + l3, a, b, timeStep_);
-
-						nextVoltage[i] = voltage[i] + (1.0f / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
-						if (nextVoltage[i] > 30.0f) {
-							nextVoltage[i] = 30.0f;
-							curSpike[i] = true;
-							nextVoltage[i] = Izh_c[i];
-							recovery[i] += Izh_d[i];
-						}
-						if (nextVoltage[i] < -90.0f) {
-							nextVoltage[i] = -90.0f;
-						}
-						#if defined(WIN32) || defined(WIN64)
-						assert(!_isnan(nextVoltage[i]));
-						assert(_finite(nextVoltage[i]));
-						#else
-						assert(!isnan(nextVoltage[i]));
-						assert(!isinf(nextVoltage[i]));
-						#endif
-
-						recovery[i] += (1.0f / 6.0f) * (l1 + 2.0f * l2 + 2.0f * l3 + l4);
-					} else {
-						// 9-param Izhikevich
-
-						float k1 = dvdtIzhikevich9(voltage[i], recovery[i], inverse_C, k, vr, vt, totalCurrent, 
-							timeStep_);
-						float l1 = dudtIzhikevich9(voltage[i], recovery[i], vr, a, b, timeStep_);
-
-						float k2 = dvdtIzhikevich9(voltage[i] + k1/2.0f, recovery[i] + l1/2.0f, inverse_C, k, vr, vt, 
-							totalCurrent, timeStep_);
-						float l2 = dudtIzhikevich9(voltage[i] + k1/2.0f, recovery[i] + l1/2.0f, vr, a, b, timeStep_);
-
-						float k3 = dvdtIzhikevich9(voltage[i] + k2/2.0f, recovery[i] + l2/2.0f, inverse_C, k, vr, vt,
-							totalCurrent, timeStep_);
-						float l3 = dudtIzhikevich9(voltage[i] + k2/2.0f, recovery[i] + l2/2.0f, vr, a, b, timeStep_);
-
-						float k4 = dvdtIzhikevich9(voltage[i] + k3, recovery[i] + l3, inverse_C, k, vr, vt, 
-							totalCurrent, timeStep_);
-						float l4 = dudtIzhikevich9(voltage[i] + k3, recovery[i] + l3, vr, a, b, timeStep_);
-
-						nextVoltage[i] = voltage[i] + (1.0f / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
-
-						if (nextVoltage[i] > Izh_vpeak[i]) {
-							nextVoltage[i] = Izh_vpeak[i];
-							curSpike[i] = true;
-							nextVoltage[i] = Izh_c[i];
-							recovery[i] += Izh_d[i];
-						}
-
-						if (nextVoltage[i] < -90.0f) {
-							nextVoltage[i] = -90.0f;
-						}
-						#if defined(WIN32) || defined(WIN64)
-						assert(!_isnan(nextVoltage[i]));
-						assert(_finite(nextVoltage[i]));
-						#else
-						assert(!isnan(nextVoltage[i]));
-						assert(!isinf(nextVoltage[i]));
-						#endif
-
-						recovery[i] += (1.0f / 6.0f) * (l1 + 2.0f * l2 + 2.0f * l3 + l4);
-					}
-					break;
-				case UNKNOWN_INTEGRATION:
-				default:
-					KERNEL_ERROR("Unknown integration method.");
-					exitSimulation(1);
-				}
-			}  // end StartN...EndN
-		}  // end numGrp
+		// every neuron only writes to its own state variables, so the neurons can be split across threads
+		runThreadTask(&CpuSNN::globalStateUpdateNeurons, numNReg);
 
 		// Only after we are done computing nextVoltage for all neurons do we copy the new values to the voltage array.
-		// This is crucial for GPU (asynchronous kernel launch) and in the future for a multi-threaded CARLsim version.
+		// This is crucial for GPU (asynchronous kernel launch) and for multi-threaded CPU mode.
 		memcpy(voltage, nextVoltage, sizeof(float)*numNReg);
 	}  // end simNumStepsPerMs_ loop
 }
 
+void CpuSNN::globalStateUpdateNeurons(int startN, int endN) {
+	for(int g=0; g<numGrp; g++) {
+		// Poisson groups don't have an update function
+		if (grpUpdateFunc_[g] == NULL) {
+			continue;
+		}
+
+		// only look at the part of the group that falls into [startN, endN)
+		int grpStartN = std::max(grp_Info[g].StartN, startN);
+		int grpEndN = std::min(grp_Info[g].EndN, endN-1);
+		if (grpStartN > grpEndN) {
+			continue;
+		}
+
+		// the neuron model, integration method, and synapse model of a group are fixed after setupNetwork, so all
+		// decisions have been made at compile time (see selectGroupStateFuncs)
+		(this->*grpUpdateFunc_[g])(g, grpStartN, grpEndN);
+
+		// sanity check in a separate loop (is compiled away together with the asserts)
+		for (int i=grpStartN; i<=grpEndN; i++) {
+			#if defined(WIN32) || defined(WIN64)
+			assert(!_isnan(nextVoltage[i]));
+			assert(_finite(nextVoltage[i]));
+			#else
+			assert(!isnan(nextVoltage[i]));
+			assert(!isinf(nextVoltage[i]));
+			#endif
+		}
+	}  // end numGrp
+}
+
+template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments, bool withParamModel9,
+	bool withRK4>
+void CpuSNN::updateGroupState(int grpId, int startN, int endN) {
+	// sum up total current = synaptic + external + compartmental
+	updateTotalCurrent<withConductances, withNMDArise, withGABAbRise, withCompartments>(grpId, startN, endN);
+
+	// single integration step
+	if (withRK4) {
+		if (withParamModel9) {
+			integrateRK4Izhikevich9(startN, endN);
+		} else {
+			integrateRK4Izhikevich4(startN, endN);
+		}
+	} else {
+		if (withParamModel9) {
+			integrateEulerIzhikevich9(startN, endN);
+		} else {
+			integrateEulerIzhikevich4(startN, endN);
+		}
+	}
+}
+
+template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments>
+void CpuSNN::updateTotalCurrent(int grpId, int startN, int endN) {
+	if (withConductances) { // COBA model
+		sumConductanceCurrentKernel<withNMDArise, withGABAbRise>(startN, endN, voltage, extCurrent, gAMPA, gNMDA,
+			gNMDA_d, gNMDA_r, gGABAa, gGABAb, gGABAb_d, gGABAb_r, totalCurrent);
+	} else { // CUBA model
+		sumCurrentKernel(startN, endN, extCurrent, current, totalCurrent);
+	}
+
+	if (withCompartments) {
+		for (int i=startN; i<=endN; i++) {
+			totalCurrent[i] += getCompCurrent(grpId, i);
+		}
+	}
+}
+// The following helpers turn the run-time flags of a group into template arguments, one flag at a time.
+template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments, bool withParamModel9>
+CpuSNN::GroupStateFunc CpuSNN::selectGroupUpdateFunc(bool withRK4) {
+	if (withRK4)
+		return &CpuSNN::updateGroupState<withConductances, withNMDArise, withGABAbRise, withCompartments,
+			withParamModel9, true>;
+	return &CpuSNN::updateGroupState<withConductances, withNMDArise, withGABAbRise, withCompartments,
+		withParamModel9, false>;
+}
+
+template<bool withConductances, bool withNMDArise, bool withGABAbRise, bool withCompartments>
+CpuSNN::GroupStateFunc CpuSNN::selectGroupUpdateFunc(bool withParamModel9, bool withRK4) {
+	if (withParamModel9)
+		return selectGroupUpdateFunc<withConductances, withNMDArise, withGABAbRise, withCompartments, true>(withRK4);
+	return selectGroupUpdateFunc<withConductances, withNMDArise, withGABAbRise, withCompartments, false>(withRK4);
+}
+
+template<bool withConductances, bool withNMDArise, bool withGABAbRise>
+CpuSNN::GroupStateFunc CpuSNN::selectGroupUpdateFunc(bool withCompartments, bool withParamModel9, bool withRK4) {
+	if (withCompartments)
+		return selectGroupUpdateFunc<withConductances, withNMDArise, withGABAbRise, true>(withParamModel9, withRK4);
+	return selectGroupUpdateFunc<withConductances, withNMDArise, withGABAbRise, false>(withParamModel9, withRK4);
+}
+
+template<bool withHomeostasis>
+CpuSNN::GroupStateFunc CpuSNN::selectGroupDecayFunc(bool withConductances) {
+	if (!withConductances)
+		return withHomeostasis ? &CpuSNN::decayGroupState<withHomeostasis, false, false, false> : NULL;
+	if (sim_with_NMDA_rise)
+		return sim_with_GABAb_rise ? &CpuSNN::decayGroupState<withHomeostasis, true, true, true>
+			: &CpuSNN::decayGroupState<withHomeostasis, true, true, false>;
+	return sim_with_GABAb_rise ? &CpuSNN::decayGroupState<withHomeostasis, true, false, true>
+		: &CpuSNN::decayGroupState<withHomeostasis, true, false, false>;
+}
+
+void CpuSNN::selectGroupStateFuncs() {
+	bool withRK4 = (simIntegrationMethod_ == RUNGE_KUTTA4);
+
+	for (int g=0; g<numGrp; g++) {
+		bool isPoisson = (grp_Info[g].Type & POISSON_NEURON) != 0;
+
+		// decay: Poisson groups have homeostasis, but no conductances (NULL if there is nothing to decay)
+		// STP is always decayed in closed form when a neuron spikes, and so is homeostasis with lazy decay (see
+		// addSpikeToTable)
+		bool withConductances = sim_with_conductances && !isPoisson;
+		bool withHomeostasis = grp_Info[g].WithHomeostasis && !withLazyDecay_;
+		grpDecayFunc_[g] = withHomeostasis ? selectGroupDecayFunc<true>(withConductances)
+			: selectGroupDecayFunc<false>(withConductances);
+
+		// update: Poisson groups are not integrated
+		if (isPoisson) {
+			grpUpdateFunc_[g] = NULL;
+			continue;
+		}
+
+		bool withComp = grp_Info[g].withCompartments;
+		bool with9 = grp_Info[g].withParamModel_9;
+		if (!sim_with_conductances) {
+			grpUpdateFunc_[g] = selectGroupUpdateFunc<false, false, false>(withComp, with9, withRK4);
+		} else if (sim_with_NMDA_rise) {
+			grpUpdateFunc_[g] = sim_with_GABAb_rise ? selectGroupUpdateFunc<true, true, true>(withComp, with9, withRK4)
+				: selectGroupUpdateFunc<true, true, false>(withComp, with9, withRK4);
+		} else {
+			grpUpdateFunc_[g] = sim_with_GABAb_rise ? selectGroupUpdateFunc<true, false, true>(withComp, with9, withRK4)
+				: selectGroupUpdateFunc<true, false, false>(withComp, with9, withRK4);
+		}
+	}
+}
+
+// curSpike is written as bytes by the integration kernels (see integrateEulerIzhikevich4Kernel)
+void CpuSNN::integrateEulerIzhikevich4(int startN, int endN) {
+	integrateEulerIzhikevich4Kernel(startN, endN, timeStep_, totalCurrent, Izh_a, Izh_b, Izh_c, Izh_d, voltage,
+		nextVoltage, recovery, (unsigned char*)curSpike);
+}
+
+void CpuSNN::integrateEulerIzhikevich9(int startN, int endN) {
+	integrateEulerIzhikevich9Kernel(startN, endN, timeStep_, totalCurrent, Izh_C, Izh_k, Izh_vr, Izh_vt, Izh_vpeak,
+		Izh_a, Izh_b, Izh_c, Izh_d, voltage, nextVoltage, recovery, (unsigned char*)curSpike);
+}
+
+void CpuSNN::integrateRK4Izhikevich4(int startN, int endN) {
+	integrateRK4Izhikevich4Kernel(startN, endN, timeStep_, totalCurrent, Izh_a, Izh_b, Izh_c, Izh_d, voltage,
+		nextVoltage, recovery, (unsigned char*)curSpike);
+}
+
+void CpuSNN::integrateRK4Izhikevich9(int startN, int endN) {
+	integrateRK4Izhikevich9Kernel(startN, endN, timeStep_, totalCurrent, Izh_C, Izh_k, Izh_vr, Izh_vt, Izh_vpeak,
+		Izh_a, Izh_b, Izh_c, Izh_d, voltage, nextVoltage, recovery, (unsigned char*)curSpike);
+}
+
+// runs a multi-threaded phase: split [0, numItems) into one contiguous chunk per thread
+void CpuSNN::runThreadTask(ThreadTask task, int numItems) {
+	if (threadPool_ == NULL) {
+		(this->*task)(0, numItems);
+		return;
+	}
+
+	threadTask_ = task;
+	threadTaskNumItems_ = numItems;
+	threadPool_->run(&CpuSNN::runThreadTaskChunk, this);
+}
+
+void CpuSNN::connectBlocks(grpConnectInfo_t* info, ThreadTask task, bool parallel) {
+	int grpSrc = info->grpSrc;
+	int grpDest = info->grpDest;
+	int numPre = grp_Info[grpSrc].SizeN;
+
+	connBlockInfo_ = info;
+	connBlockSynapses_.resize(std::min(numPre, CONN_SAMPLE_BLOCK_SIZE));
+	connBlockFailed_.assign(connBlockSynapses_.size(), 0);
+
+	// fill a block of pre-neurons (in parallel), then add the synapses in the order of the pre-neurons, so that the
+	// synaptic arrays look the same no matter how many threads were used
+	for (int blockStart=0; blockStart<numPre; blockStart+=CONN_SAMPLE_BLOCK_SIZE) {
+		int blockSize = std::min(numPre-blockStart, CONN_SAMPLE_BLOCK_SIZE);
+		connBlockPreStartN_ = grp_Info[grpSrc].StartN + blockStart;
+		if (parallel)
+			runThreadTask(task, blockSize);
+		else
+			(this->*task)(0, blockSize);
+
+		// the task has already reported the error
+		for (int i=0; i<blockSize; i++) {
+			if (connBlockFailed_[i])
+				exitSimulation(1);
+		}
+
+		for (int i=0; i<blockSize; i++) {
+			for (unsigned int j=0; j<connBlockSynapses_[i].size(); j++) {
+				const pending_synapse_t& syn = connBlockSynapses_[i][j];
+				setConnection(grpSrc, grpDest, syn.src, syn.dest, syn.wt, syn.maxWt, syn.delay, info->connProp,
+					info->connId);
+				info->numberOfConnections++;
+
+				// user-defined connections keep track of the largest delay and weight they have seen
+				if (info->type == CONN_USER_DEFINED) {
+					info->maxWt = std::max(info->maxWt, (float)fabs(syn.maxWt));
+					if (syn.delay > info->maxDelay)
+						info->maxDelay = syn.delay;
+				}
+			}
+		}
+	}
+
+	std::vector< std::vector<pending_synapse_t> >().swap(connBlockSynapses_);
+	std::vector<char>().swap(connBlockFailed_);
+	connBlockInfo_ = NULL;
+}
+
+void CpuSNN::runThreadTaskChunk(void* snn, int threadId, int numThreads) {
+	CpuSNN* s = (CpuSNN*)snn;
+	int startIdx = (int)((long long)s->threadTaskNumItems_ * threadId / numThreads);
+	int endIdx = (int)((long long)s->threadTaskNumItems_ * (threadId+1) / numThreads);
+	if (startIdx < endIdx) {
+		(s->*(s->threadTask_))(startIdx, endIdx);
+	}
+}
+
 // initialize all the synaptic weights to appropriate values..
 // total size of the synaptic connection is 'length' ...
 void CpuSNN::initSynapticWeights() {
@@ -4111,35 +4716,6 @@ void CpuSNN::makePtrInfo() {
 	cpuNetPtrs.stpx				= stpx;
 }
 
-// will be used in generateSpikesFromRate
-// The time between each pair of consecutive events has an exponential distribution with parameter \lambda and
-// each of these ISI values is assumed to be independent of other ISI values.
-// What follows a Poisson distribution is the actual number of spikes sent during a certain interval.
-unsigned int CpuSNN::poissonSpike(unsigned int currTime, float frate, int refractPeriod) {
-	// refractory period must be 1 or greater, 0 means could have multiple spikes specified at the same time.
-	assert(refractPeriod>0);
-	assert(frate>=0.0f);
-
-	bool done = false;
-	unsigned int nextTime = 0;
-	while (!done) {
-		// A Poisson process will always generate inter-spike-interval (ISI) values from an exponential distribution.
-		float randVal = drand48();
-		unsigned int tmpVal  = -log(randVal)/frate;
-
-		// add new ISI to current time
-		// this might be faster than keeping currTime fixed until drand48() returns a large enough value for the ISI
-		nextTime = currTime + tmpVal;
-
-		// reject new firing time if ISI is smaller than refractory period
-		if ((nextTime - currTime) >= (unsigned) refractPeriod)
-			done = true;
-	}
-
-	assert(nextTime != 0);
-	return nextTime;
-}
-
 int CpuSNN::loadSimulation_internal(bool onlyPlastic) {
 	// TSC: so that we can restore the file position later...
 	// MB: not sure why though...
@@ -4334,9 +4910,10 @@ int CpuSNN::loadSimulation_internal(bool onlyPlastic) {
 			// read delay
 			result = fread(&delay, sizeof(uint8_t), 1, loadSimFID);
 			readErr |= (result!=1);
-			if (delay > MAX_SynapticDelay) {
-				KERNEL_ERROR("loadSimulation: delay in file (%d) is larger than MAX_SynapticDelay (%d)",
-					(int)delay, (int)MAX_SynapticDelay);
+			// delays are stored as uint8_t, which covers MAX_SynapticDelay in CPU_MODE, but not the GPU limit
+			int maxDelayMode = (simMode_ == GPU_MODE) ? MAX_SynapticDelay_GPU : MAX_SynapticDelay;
+			if (delay < 1 || delay > maxDelayMode) {
+				KERNEL_ERROR("loadSimulation: delay in file (%d) is not in the range [1,%d]", (int)delay, maxDelayMode);
 				exitSimulation(-1);
 			}
 
@@ -4371,52 +4948,74 @@ int CpuSNN::loadSimulation_internal(bool onlyPlastic) {
 
 // The post synaptic connections are sorted based on delay here so that we can reduce storage requirement
 // and generation of spike at the post-synaptic side.
-// We also create the delay_info array has the delay_start and delay_length parameter
+// We also create the delay buckets: for every neuron, one bucket per delay that is actually in use, which holds the
+// delay_start and delay_length parameter. This way the memory and the work per spike scale with the number of
+// distinct delays of a neuron, not with maxDelay_. In GPU_MODE, the dense postDelayInfo table is filled, too.
 void CpuSNN::reorganizeDelay() {
-	int tdMax = maxDelay_ > 1 ? maxDelay_ : 1;
-	for (int grpId=0; grpId < numGrp; grpId++) {
-		for (int nid=grp_Info[grpId].StartN; nid <= grp_Info[grpId].EndN; nid++) {
-			unsigned int jPos=0;					// this points to the top of the delay queue
-			unsigned int cumN=cumulativePost[nid];	// cumulativePost[] is unsigned int
-			unsigned int cumDelayStart=0; 			// Npost[] is unsigned short
-
-			// in a network without connections, where maxDelay_==0, we still need to enter the loop in order
-			// to set the appropriate postDelayInfo entries to zero
-			// otherwise the simulation might segfault because delay_length and delay_index_start are not
-			// correctly initialized
-			for (int td = 0; td < tdMax; td++) {
-				unsigned int j=jPos;				// start searching from top of the queue until the end
-				unsigned int cnt=0;					// store the number of nodes with a delay of td;
-				while (j < Npost[nid]) {
-					// found a node j with delay=td and we put
-					// the delay value = 1 at array location td=0;
-					if (td == (tmp_SynapticDelay[cumN+j]-1)) {
-						assert(jPos<Npost[nid]);
-						swapConnections(nid, j, jPos);
-
-						jPos++;
-						cnt++;
-					}
-					j++;
+	// first pass: count the delays in use, so that the buckets of all neurons fit into one array
+	unsigned int numBuckets = 0;
+	for (int nid=0; nid < numN; nid++) {
+		bool delayUsed[MAX_SynapticDelay+1] = {false};
+		unsigned int cumN=cumulativePost[nid];	// cumulativePost[] is unsigned int
+
+		postDelayBucketCum[nid] = numBuckets;
+		for (unsigned int j=0; j < Npost[nid]; j++) {
+			if (!delayUsed[tmp_SynapticDelay[cumN+j]]) {
+				delayUsed[tmp_SynapticDelay[cumN+j]] = true;
+				numBuckets++;
+			}
+		}
+	}
+	postDelayBucketCum[numN] = numBuckets;
+	postDelayBuckets = new delay_bucket_t[numBuckets];
+	cpuSnnSz.networkInfoSize += sizeof(delay_bucket_t)*numBuckets;
+
+	for (int nid=0; nid < numN; nid++) {
+		unsigned int jPos=0;					// this points to the top of the delay queue
+		unsigned int cumN=cumulativePost[nid];	// cumulativePost[] is unsigned int
+		unsigned int bucketIdx=postDelayBucketCum[nid];
+
+		while (jPos < Npost[nid]) {
+			// the smallest delay among the synapses that are not yet in a bucket
+			uint8_t delay = tmp_SynapticDelay[cumN+jPos];
+			for (unsigned int j=jPos+1; j < Npost[nid]; j++)
+				delay = (std::min)(delay, tmp_SynapticDelay[cumN+j]);
+
+			// move all synapses with that delay to the top of the queue
+			unsigned int cumDelayStart=jPos; 	// Npost[] is unsigned short
+			for (unsigned int j=jPos; j < Npost[nid]; j++) {
+				if (tmp_SynapticDelay[cumN+j] == delay) {
+					swapConnections(nid, j, jPos);
+					jPos++;
 				}
-
-				// update the delay_length and start values...
-				postDelayInfo[nid*(maxDelay_+1)+td].delay_length	     = cnt;
-				postDelayInfo[nid*(maxDelay_+1)+td].delay_index_start  = cumDelayStart;
-				cumDelayStart += cnt;
-
-				assert(cumDelayStart <= Npost[nid]);
 			}
+			unsigned int cnt = jPos - cumDelayStart;
+
+			// sort the synapses of this delay by post-synaptic neuron id, which allows multi-threaded spike
+			// delivery to look up the synapses that project to a range of post-synaptic neurons
+			sortConnectionsByPostId(nid, cumDelayStart, jPos);
+
+			// update the delay_length and start values...
+			assert(bucketIdx < postDelayBucketCum[nid+1]);
+			postDelayBuckets[bucketIdx].delay_length      = cnt;
+			postDelayBuckets[bucketIdx].delay_index_start = cumDelayStart;
+			postDelayBuckets[bucketIdx].tD                = delay-1;
+			bucketIdx++;
+
+			// the entries of unused delays were set to zero on allocation
+			if (postDelayInfo != NULL) {
+				postDelayInfo[nid*(maxDelay_+1)+delay-1].delay_length	   = cnt;
+				postDelayInfo[nid*(maxDelay_+1)+delay-1].delay_index_start = cumDelayStart;
+			}
+		}
 
-			// total cumulative delay should be equal to number of post-synaptic connections at the end of the loop
-			assert(cumDelayStart == Npost[nid]);
-			for (unsigned int j=1; j < Npost[nid]; j++) {
-				unsigned int cumN=cumulativePost[nid]; // cumulativePost[] is unsigned int
-				if (tmp_SynapticDelay[cumN+j] < tmp_SynapticDelay[cumN+j-1]) {
-	  				KERNEL_ERROR("Post-synaptic delays not sorted correctly... id=%d, delay[%d]=%d, delay[%d]=%d",
-						nid, j, tmp_SynapticDelay[cumN+j], j-1, tmp_SynapticDelay[cumN+j-1]);
-					assert( tmp_SynapticDelay[cumN+j] >= tmp_SynapticDelay[cumN+j-1]);
-				}
+		// every bucket should have been filled at the end of the loop
+		assert(bucketIdx == postDelayBucketCum[nid+1]);
+		for (unsigned int j=1; j < Npost[nid]; j++) {
+			if (tmp_SynapticDelay[cumN+j] < tmp_SynapticDelay[cumN+j-1]) {
+  				KERNEL_ERROR("Post-synaptic delays not sorted correctly... id=%d, delay[%d]=%d, delay[%d]=%d",
+					nid, j, tmp_SynapticDelay[cumN+j], j-1, tmp_SynapticDelay[cumN+j-1]);
+				assert( tmp_SynapticDelay[cumN+j] >= tmp_SynapticDelay[cumN+j-1]);
 			}
 		}
 	}
@@ -4440,8 +5039,8 @@ void CpuSNN::reorganizeNetwork(bool removeTempMemory) {
 	// time to build the complete network with relevant parameters..
 	buildNetwork();
 
-	//..minimize any other wastage in that array by compacting the store
-	compactConnections();
+	// allocate the synaptic arrays with exact size and fill them
+	buildConnectionArrays();
 
 	// The post synaptic connections are sorted based on delay here
 	reorganizeDelay();
@@ -4575,15 +5174,18 @@ void CpuSNN::resetNeuron(unsigned int neurId, int grpId) {
 		exitSimulation(1);
 	}
 
-	Izh_C[neurId] = grp_Info2[grpId].Izh_C + grp_Info2[grpId].Izh_C_sd*(float)drand48();
-	Izh_k[neurId] = grp_Info2[grpId].Izh_k + grp_Info2[grpId].Izh_k_sd*(float)drand48();
-	Izh_vr[neurId] = grp_Info2[grpId].Izh_vr + grp_Info2[grpId].Izh_vr_sd*(float)drand48();
-	Izh_vt[neurId] = grp_Info2[grpId].Izh_vt + grp_Info2[grpId].Izh_vt_sd*(float)drand48();
-	Izh_a[neurId] = grp_Info2[grpId].Izh_a + grp_Info2[grpId].Izh_a_sd*(float)drand48();
-	Izh_b[neurId] = grp_Info2[grpId].Izh_b + grp_Info2[grpId].Izh_b_sd*(float)drand48();
-	Izh_vpeak[neurId] = grp_Info2[grpId].Izh_vpeak + grp_Info2[grpId].Izh_vpeak_sd*(float)drand48();
-	Izh_c[neurId] = grp_Info2[grpId].Izh_c + grp_Info2[grpId].Izh_c_sd*(float)drand48();
-	Izh_d[neurId] = grp_Info2[grpId].Izh_d + grp_Info2[grpId].Izh_d_sd*(float)drand48();
+	// every neuron has its own random stream, so that its parameters do not depend on the order of initialization
+	CpuRandomStream rng(randSeed_, cpuRandomStreamId(RAND_STREAM_NEURON, grpId, neurId-grp_Info[grpId].StartN));
+
+	Izh_C[neurId] = grp_Info2[grpId].Izh_C + grp_Info2[grpId].Izh_C_sd*(float)rng.nextDouble();
+	Izh_k[neurId] = grp_Info2[grpId].Izh_k + grp_Info2[grpId].Izh_k_sd*(float)rng.nextDouble();
+	Izh_vr[neurId] = grp_Info2[grpId].Izh_vr + grp_Info2[grpId].Izh_vr_sd*(float)rng.nextDouble();
+	Izh_vt[neurId] = grp_Info2[grpId].Izh_vt + grp_Info2[grpId].Izh_vt_sd*(float)rng.nextDouble();
+	Izh_a[neurId] = grp_Info2[grpId].Izh_a + grp_Info2[grpId].Izh_a_sd*(float)rng.nextDouble();
+	Izh_b[neurId] = grp_Info2[grpId].Izh_b + grp_Info2[grpId].Izh_b_sd*(float)rng.nextDouble();
+	Izh_vpeak[neurId] = grp_Info2[grpId].Izh_vpeak + grp_Info2[grpId].Izh_vpeak_sd*(float)rng.nextDouble();
+	Izh_c[neurId] = grp_Info2[grpId].Izh_c + grp_Info2[grpId].Izh_c_sd*(float)rng.nextDouble();
+	Izh_d[neurId] = grp_Info2[grpId].Izh_d + grp_Info2[grpId].Izh_d_sd*(float)rng.nextDouble();
 
 	// initialize membrane potential to reset potential
 	float vreset = grp_Info[grpId].withParamModel_9 ? Izh_vr[neurId] : Izh_c[neurId];
@@ -4594,10 +5196,10 @@ void CpuSNN::resetNeuron(unsigned int neurId, int grpId) {
 
  	if (grp_Info[grpId].WithHomeostasis) {
 		// set the baseFiring with some standard deviation.
-		if (drand48()>0.5)   {
-			baseFiring[neurId] = grp_Info2[grpId].baseFiring + grp_Info2[grpId].baseFiringSD*-log(drand48());
+		if (rng.nextDouble()>0.5)   {
+			baseFiring[neurId] = grp_Info2[grpId].baseFiring + grp_Info2[grpId].baseFiringSD*-log(1.0-rng.nextDouble());
 		} else  {
-			baseFiring[neurId] = grp_Info2[grpId].baseFiring - grp_Info2[grpId].baseFiringSD*-log(drand48());
+			baseFiring[neurId] = grp_Info2[grpId].baseFiring - grp_Info2[grpId].baseFiringSD*-log(1.0-rng.nextDouble());
 			if(baseFiring[neurId] < 0.1) baseFiring[neurId] = 0.1;
 		}
 
@@ -4607,11 +5209,16 @@ void CpuSNN::resetNeuron(unsigned int neurId, int grpId) {
 			baseFiring[neurId] = 0.0;
 			avgFiring[neurId]  = 0;
 		}
+		if (avgFiringTime != NULL)
+			avgFiringTime[neurId] = simTime; // not yet decayed in the current time step
 	}
 
 	lastSpikeTime[neurId]  = MAX_SIMULATION_TIME;
 
-	if(grp_Info[grpId].WithSTP) {
+	if (grp_Info[grpId].WithSTP && stpLastU != NULL) {
+		stpLastU[stpGrpOffset_[grpId] + neurId - grp_Info[grpId].StartN] = 0.0f;
+		stpLastX[stpGrpOffset_[grpId] + neurId - grp_Info[grpId].StartN] = 1.0f;
+	} else if (grp_Info[grpId].WithSTP) {
 		for (int j=0; j<=maxDelay_; j++) { // is of size maxDelay_+1
 			int ind = STP_BUF_POS(neurId,j);
 			stpu[ind] = 0.0f;
@@ -4659,6 +5266,12 @@ void CpuSNN::resetPointers(bool deallocate) {
 	if (spikeGenBits!=NULL && deallocate) delete[] spikeGenBits;
 	pbuf=NULL; spikeGenBits=NULL;
 
+	// joins all worker threads
+	if (threadPool_!=NULL && deallocate) delete threadPool_;
+	if (threadPostStartN_!=NULL && deallocate) delete[] threadPostStartN_;
+	if (threadDASpikeCnt_!=NULL && deallocate) delete[] threadDASpikeCnt_;
+	threadPool_=NULL; threadPostStartN_=NULL; threadDASpikeCnt_=NULL;
+
 	// clear all existing connection info
 	if (deallocate) {
 		while (connectBegin) {
@@ -4719,8 +5332,12 @@ void CpuSNN::resetPointers(bool deallocate) {
 	if (recovery!=NULL && deallocate) delete[] recovery;
 	if (current!=NULL && deallocate) delete[] current;
 	if (extCurrent!=NULL && deallocate) delete[] extCurrent;
+	if (totalCurrent!=NULL && deallocate) delete[] totalCurrent;
+	totalCurrent=NULL;
 	if (curSpike!=NULL && deallocate) delete[] curSpike;
+	if (firedSTDP!=NULL && deallocate) delete[] firedSTDP;
 	voltage=NULL; nextVoltage=NULL; recovery=NULL; current=NULL; extCurrent=NULL; curSpike = NULL;
+	firedSTDP = NULL;
 
 	if (Izh_C != NULL && deallocate) delete[] Izh_C;
 	if (Izh_k != NULL && deallocate) delete[] Izh_k;
@@ -4756,20 +5373,30 @@ void CpuSNN::resetPointers(bool deallocate) {
 	if (stpu!=NULL && deallocate) delete[] stpu;
 	if (stpx!=NULL && deallocate) delete[] stpx;
 	stpu=NULL; stpx=NULL;
+	if (stpLastU!=NULL && deallocate) delete[] stpLastU;
+	if (stpLastX!=NULL && deallocate) delete[] stpLastX;
+	stpLastU=NULL; stpLastX=NULL;
 
 	if (avgFiring!=NULL && deallocate) delete[] avgFiring;
 	if (baseFiring!=NULL && deallocate) delete[] baseFiring;
-	avgFiring=NULL; baseFiring=NULL;
+	if (avgFiringTime!=NULL && deallocate) delete[] avgFiringTime;
+	avgFiring=NULL; baseFiring=NULL; avgFiringTime=NULL;
 
 	if (lastSpikeTime!=NULL && deallocate) delete[] lastSpikeTime;
 	if (synSpikeTime !=NULL && deallocate) delete[] synSpikeTime;
 	if (nSpikeCnt!=NULL && deallocate) delete[] nSpikeCnt;
 	lastSpikeTime=NULL; synSpikeTime=NULL; nSpikeCnt=NULL;
 
+	if (tmp_SynapticDelay!=NULL && deallocate) delete[] tmp_SynapticDelay;
+	tmp_SynapticDelay=NULL;
+	clearPendingSynapses();
+
 	if (postDelayInfo!=NULL && deallocate) delete[] postDelayInfo;
+	if (postDelayBuckets!=NULL && deallocate) delete[] postDelayBuckets;
+	if (postDelayBucketCum!=NULL && deallocate) delete[] postDelayBucketCum;
 	if (preSynapticIds!=NULL && deallocate) delete[] preSynapticIds;
 	if (postSynapticIds!=NULL && deallocate) delete[] postSynapticIds;
-	postDelayInfo=NULL; preSynapticIds=NULL; postSynapticIds=NULL;
+	postDelayInfo=NULL; postDelayBuckets=NULL; postDelayBucketCum=NULL; preSynapticIds=NULL; postSynapticIds=NULL;
 
 	if (wt!=NULL && deallocate) delete[] wt;
 	if (maxSynWt!=NULL && deallocate) delete[] maxSynWt;
@@ -4790,6 +5417,24 @@ void CpuSNN::resetPointers(bool deallocate) {
 	if (timeTableD1!=NULL && deallocate) delete[] timeTableD1;
 	firingTableD2=NULL; firingTableD1=NULL; timeTableD2=NULL; timeTableD1=NULL;
 
+	if (postSynPreIdx!=NULL && deallocate) delete[] postSynPreIdx;
+	if (preSynPostIdx!=NULL && deallocate) delete[] preSynPostIdx;
+	if (postSynWt!=NULL && deallocate) delete[] postSynWt;
+	if (postSynConnId!=NULL && deallocate) delete[] postSynConnId;
+	postSynPreIdx=NULL; preSynPostIdx=NULL; postSynWt=NULL; postSynConnId=NULL;
+	if (stdpPostTraceExc!=NULL && deallocate) delete[] stdpPostTraceExc;
+	if (stdpPostTraceInb!=NULL && deallocate) delete[] stdpPostTraceInb;
+	if (stdpPreTrace!=NULL && deallocate) delete[] stdpPreTrace;
+	if (synDelayIdx!=NULL && deallocate) delete[] synDelayIdx;
+	stdpPostTraceExc=NULL; stdpPostTraceInb=NULL; stdpPreTrace=NULL; synDelayIdx=NULL;
+	if (stdpLUTBuf!=NULL && deallocate) delete[] stdpLUTBuf;
+	stdpLUTBuf=NULL;
+	if (wtChangePending!=NULL && deallocate) delete[] wtChangePending;
+	if (wtUpdateLast!=NULL && deallocate) delete[] wtUpdateLast;
+	wtChangePending=NULL; wtUpdateLast=NULL;
+	if (spikeDelayRing_!=NULL && deallocate) delete[] spikeDelayRing_;
+	spikeDelayRing_=NULL;
+
 #ifndef __CPU_ONLY__
 	// clear poisson generator
 	if (gpuPoissonRand != NULL) delete gpuPoissonRand;
@@ -4801,10 +5446,16 @@ void CpuSNN::resetPointers(bool deallocate) {
 void CpuSNN::resetPoissonNeuron(unsigned int nid, int grpId) {
 	assert(nid < (unsigned int)numN);
 	lastSpikeTime[nid]  = MAX_SIMULATION_TIME;
-	if (grp_Info[grpId].WithHomeostasis)
+	if (grp_Info[grpId].WithHomeostasis) {
 		avgFiring[nid]      = 0.0;
+		if (avgFiringTime != NULL)
+			avgFiringTime[nid] = simTime; // not yet decayed in the current time step
+	}
 
-	if(grp_Info[grpId].WithSTP) {
+	if (grp_Info[grpId].WithSTP && stpLastU != NULL) {
+		stpLastU[stpGrpOffset_[grpId] + nid - grp_Info[grpId].StartN] = 0.0f;
+		stpLastX[stpGrpOffset_[grpId] + nid - grp_Info[grpId].StartN] = 1.0f;
+	} else if (grp_Info[grpId].WithSTP) {
 		for (int j=0; j<=maxDelay_; j++) { // is of size maxDelay_+1
 			int ind = STP_BUF_POS(nid,j);
 			stpu[ind] = 0.0f;
@@ -4864,6 +5515,8 @@ void CpuSNN::resetSynapticConnections(bool changeWeights) {
 			float* synWtPtr       = &wt[cumulativePre[nid]];
 			float* maxWtPtr       = &maxSynWt[cumulativePre[nid]];
 			int prevPreGrp  = -1;
+			CpuRandomStream rng(randSeed_, cpuRandomStreamId(RAND_STREAM_WEIGHT_RESET, destGrp,
+				nid-grp_Info[destGrp].StartN));
 
 			for (j=0; j < Npre[nid]; j++,preIdPtr++, synWtPtr++, maxWtPtr++) {
 				int preId    = GET_CONN_NEURON_ID((*preIdPtr));
@@ -4900,7 +5553,7 @@ void CpuSNN::resetSynapticConnections(bool changeWeights) {
 				// if connection was plastic or if the connection weights were updated we need to reset the weights
 				// TODO: How to account for user-defined connection reset
 				if ((synWtType == SYN_PLASTIC) || connInfo->newUpdates) {
-					*synWtPtr = getWeights(connInfo->connProp, connInfo->initWt, connInfo->maxWt, nid, srcGrp);
+					*synWtPtr = getWeights(connInfo->connProp, connInfo->initWt, connInfo->maxWt, nid, srcGrp, rng);
 					*maxWtPtr = connInfo->maxWt;
 				}
 			}
@@ -4919,19 +5572,24 @@ void CpuSNN::resetSynapticConnections(bool changeWeights) {
 void CpuSNN::resetTimingTable() {
 		memset(timeTableD2, 0, sizeof(int) * (1000 + maxDelay_ + 1));
 		memset(timeTableD1, 0, sizeof(int) * (1000 + maxDelay_ + 1));
+
+		// pending spikes belong to the old time line
+		for (int i=0; spikeDelayRing_!=NULL && i<maxDelay_; i++)
+			spikeDelayRing_[i].clear();
 }
 
 
 //! nid=neuron id, sid=synapse id, grpId=group id.
 inline post_info_t CpuSNN::SET_CONN_ID(int nid, int sid, int grpId) {
-	if (sid > CONN_SYN_MASK) {
-		KERNEL_ERROR("Error: Syn Id (%d) exceeds maximum limit (%d) for neuron %d (group %d)", sid, CONN_SYN_MASK, nid,
-			grpId);
+	if ((uint64_t)sid > CONN_SYN_MASK) {
+		KERNEL_ERROR("Error: Syn Id (%d) exceeds maximum limit (%llu) for neuron %d (group %d)", sid,
+			(unsigned long long)CONN_SYN_MASK, nid, grpId);
 		exitSimulation(1);
 	}
+	assert(grpId>=0 && (uint64_t)grpId<=CONN_SYN_GRP_MASK);
 	post_info_t p;
-	p.postId = (((sid)<<CONN_SYN_NEURON_BITS)+((nid)&CONN_SYN_NEURON_MASK));
-	p.grpId  = grpId;
+	p.postId = ((uint64_t)sid << (CONN_SYN_NEURON_BITS+CONN_SYN_GRP_BITS))
+		| ((uint64_t)grpId << CONN_SYN_NEURON_BITS) | ((uint64_t)nid & CONN_SYN_NEURON_MASK);
 	return p;
 }
 
@@ -4939,7 +5597,7 @@ inline post_info_t CpuSNN::SET_CONN_ID(int nid, int sid, int grpId) {
 inline void CpuSNN::setConnection(int srcGrp,  int destGrp,  unsigned int src, unsigned int dest, float synWt,
 	float maxWt, uint8_t dVal, int connProp, short int connId)
 {
-	assert(dest<=CONN_SYN_NEURON_MASK);			// total number of neurons is less than 1 million within a GPU
+	assert(dest<=CONN_SYN_NEURON_MASK);
 	assert((dVal >=1) && (dVal <= maxDelay_));
 
 	// adjust sign of weight based on pre-group (negative if pre is inhibitory)
@@ -4961,26 +5619,19 @@ inline void CpuSNN::setConnection(int srcGrp,  int destGrp,  unsigned int src, u
 		exitSimulation(1);
 	}
 
-	int p = Npost[src];
-
 	assert(Npost[src] >= 0);
 	assert(Npre[dest] >= 0);
-	assert((src*numPostSynapses_+p)/numN < (unsigned int)numPostSynapses_); // divide by numN to prevent INT overflow
-
-	unsigned int post_pos = cumulativePost[src] + Npost[src];
-	unsigned int pre_pos  = cumulativePre[dest] + Npre[dest];
-
-	assert(post_pos < postSynCnt);
-	assert(pre_pos  < preSynCnt);
-
-	//generate a new postSynapticIds id for the current connection
-	postSynapticIds[post_pos]   = SET_CONN_ID(dest, Npre[dest], destGrp);
-	tmp_SynapticDelay[post_pos] = dVal;
-
-	preSynapticIds[pre_pos] = SET_CONN_ID(src, Npost[src], srcGrp);
-	wt[pre_pos] 	  = synWt;
-	maxSynWt[pre_pos] = maxWt;
-	cumConnIdPre[pre_pos] = connId;
+	assert(grpIds[src] == srcGrp && grpIds[dest] == destGrp);
+
+	// the synaptic arrays are only allocated once all connections are known (see buildConnectionArrays)
+	pendingSrc_.push_back(src);
+	pendingDest_.push_back(dest);
+	pendingPostSlot_.push_back(Npost[src]);
+	pendingPreSlot_.push_back(Npre[dest]);
+	pendingWt_.push_back(synWt);
+	pendingMaxWt_.push_back(maxWt);
+	pendingConnId_.push_back(connId);
+	pendingDelay_.push_back(dVal);
 
 	bool synWtType = GET_FIXED_PLASTIC(connProp);
 
@@ -5032,9 +5683,64 @@ int CpuSNN::setRandSeed(int seed) {
 // of all variable for carrying out the simulation..
 // this code is run only one time during network initialization
 void CpuSNN::setupNetwork(bool removeTempMem) {
+	// spawn the worker threads once, they are used to build the connections and reused in every time step
+	if (simMode_ == CPU_MODE && numThreads_ > 1 && threadPool_ == NULL) {
+		threadPool_ = new CpuThreadPool(numThreads_);
+		KERNEL_INFO("Running CPU simulation on %d threads", threadPool_->getNumThreads());
+
+		// nothing has been scheduled yet: give every thread its own shard to fill with Poisson spikes
+		delete pbuf;
+		pbuf = new PropagatedSpikeBuffer(0, PROPAGATED_BUFFER_SIZE, threadPool_->getNumThreads());
+	}
+
 	if(!doneReorganization)
 		reorganizeNetwork(removeTempMem);
 
+	// group flags can no longer change: pick the specialized update/decay function of every group
+	selectGroupStateFuncs();
+
+	if (simMode_ == CPU_MODE && withPostOrderedSynapses_ && postSynPreIdx == NULL)
+		buildPostOrderedSynapses();
+
+	if (simMode_ == CPU_MODE && sim_with_stdp && stdpLUTBuf == NULL)
+		buildSTDPLookupTables();
+
+	if (simMode_ == CPU_MODE && withTraceBasedSTDP_ && sim_with_stdp && synDelayIdx == NULL)
+		buildSTDPTraces();
+
+	// skip-list of the weight update: start with all neurons pending, so that the first update visits everyone
+	if (simMode_ == CPU_MODE && sim_with_stdp && wtChangePending == NULL) {
+		wtChangePending = new uint8_t[numNReg];
+		memset(wtChangePending, 1, sizeof(uint8_t)*numNReg);
+		if (wtChangeDecay_ > 0.0f) {
+			wtUpdateLast = new unsigned int[numNReg];
+			memset(wtUpdateLast, 0, sizeof(unsigned int)*numNReg);
+		}
+	}
+
+	if (threadPool_ != NULL && threadPostStartN_ == NULL) {
+		int numThreads = threadPool_->getNumThreads();
+
+		// partition the regular neurons for spike delivery such that every thread owns about the same number of
+		// incoming synapses
+		threadPostStartN_ = new int[numThreads+1];
+		threadDASpikeCnt_ = new int[numThreads*numGrp];
+		unsigned int numSynTotal = 0;
+		for (int i=0; i<numNReg; i++)
+			numSynTotal += Npre[i];
+
+		unsigned int numSynCum = 0;
+		int t = 1;
+		threadPostStartN_[0] = 0;
+		for (int i=0; i<numNReg && t<numThreads; i++) {
+			numSynCum += Npre[i];
+			while (t<numThreads && (unsigned long long)numSynCum*numThreads >= (unsigned long long)numSynTotal*t)
+				threadPostStartN_[t++] = i+1;
+		}
+		while (t<=numThreads)
+			threadPostStartN_[t++] = numNReg;
+	}
+
 #ifndef __CPU_ONLY__
 	if((simMode_ == GPU_MODE) && (cpu_gpuNetPtrs.allocated == false))
 		allocateSNN_GPU();
@@ -5071,6 +5777,10 @@ void CpuSNN::startTesting(bool shallUpdateWeights) {
 			float storeScaleSTDP = stdpScaleFactor_;
 			stdpScaleFactor_ = 1.0f/wtANDwtChangeUpdateIntervalCnt_;
 
+			// the scale factor differs from the one of regular updates, so this update must not be skipped by anyone
+			if (wtChangePending != NULL)
+				memset(wtChangePending, 1, sizeof(uint8_t)*numNReg);
+
 			if (simMode_ == CPU_MODE) {
 				updateWeights();
 #ifndef __CPU_ONLY__
@@ -5107,6 +5817,234 @@ void CpuSNN::stopTesting() {
 }
 
 
+// orders post-synaptic connections by post-synaptic neuron id
+static bool comparePostId(const post_info_t& a, const post_info_t& b) {
+	return GET_CONN_NEURON_ID(a) < GET_CONN_NEURON_ID(b);
+}
+
+// sorts the post-synaptic connections [startPos, endPos) of neuron nid by post-synaptic neuron id
+// the sort is stable, so that multiple synapses onto the same neuron keep their relative order
+void CpuSNN::sortConnectionsByPostId(int nid, int startPos, int endPos) {
+	if (endPos - startPos < 2)
+		return;
+
+	unsigned int cumN=cumulativePost[nid];
+	std::stable_sort(&postSynapticIds[cumN+startPos], &postSynapticIds[cumN+endPos], comparePostId);
+
+	// all synapses that moved need the pre-information of their post-synaptic neuron updated
+	for (int pos=startPos; pos<endPos; pos++) {
+		post_info_t postInfo = postSynapticIds[cumN+pos];
+		int post_nid = GET_CONN_NEURON_ID(postInfo);
+		int post_sid = GET_CONN_SYN_ID(postInfo);
+
+		post_info_t* preId = &preSynapticIds[cumulativePre[post_nid]+post_sid];
+		assert(GET_CONN_NEURON_ID((*preId)) == (unsigned int)nid);
+		*preId = SET_CONN_ID(nid, pos, GET_CONN_GRP_ID((*preId)));
+	}
+}
+
+void CpuSNN::buildPostOrderedSynapses() {
+	unsigned int numPostSyn = cumulativePost[numN-1] + Npost[numN-1];
+	unsigned int numPreSyn = cumulativePre[numN-1] + Npre[numN-1];
+
+	postSynPreIdx = new unsigned int[numPostSyn];
+	preSynPostIdx = new unsigned int[numPreSyn];
+	postSynWt = new float[numPostSyn];
+	postSynConnId = new short int[numPostSyn];
+	cpuSnnSz.synapticInfoSize += (2*sizeof(unsigned int) + sizeof(float) + sizeof(short int)) * numPostSyn;
+
+	for (int nid=0; nid<numN; nid++) {
+		unsigned int offset = cumulativePost[nid];
+		for (int j=0; j<Npost[nid]; j++) {
+			post_info_t post_info = postSynapticIds[offset + j];
+			unsigned int post_i = GET_CONN_NEURON_ID(post_info);
+			unsigned int pos_i = cumulativePre[post_i] + GET_CONN_SYN_ID(post_info);
+			assert(pos_i < numPreSyn);
+
+			postSynPreIdx[offset + j] = pos_i;
+			preSynPostIdx[pos_i] = offset + j;
+			postSynWt[offset + j] = wt[pos_i];
+			postSynConnId[offset + j] = cumConnIdPre[pos_i];
+		}
+	}
+
+	KERNEL_INFO("Built post-ordered synapse storage for %u synapses", numPostSyn);
+}
+
+void CpuSNN::buildSTDPTraces() {
+	// find the decay factors of every STDP group, and share one pre-synaptic trace among all groups with the same tau+
+	numSTDPPreTraceSlots_ = 0;
+	for (int g=0; g<numGrp; g++) {
+		stdpPreTraceSlotExc_[g] = -1;
+		stdpPreTraceSlotInb_[g] = -1;
+		stdpPostTraceDecayExc_[g] = 0.0f;
+		stdpPostTraceDecayInb_[g] = 0.0f;
+		if (!grp_Info[g].WithSTDP)
+			continue;
+
+		float tauPlusInv[2] = {-1.0f, -1.0f};
+		if (grp_Info[g].WithESTDP) {
+			// EXP_CURVE and TIMING_BASED_CURVE both use exponentials
+			tauPlusInv[0] = grp_Info[g].TAU_PLUS_INV_EXC;
+			stdpPostTraceDecayExc_[g] = exp(-grp_Info[g].TAU_MINUS_INV_EXC);
+		}
+		if (grp_Info[g].WithISTDP && grp_Info[g].WithISTDPcurve == EXP_CURVE) {
+			tauPlusInv[1] = grp_Info[g].TAU_PLUS_INV_INB;
+			stdpPostTraceDecayInb_[g] = exp(-grp_Info[g].TAU_MINUS_INV_INB);
+		}
+
+		for (int e=0; e<2; e++) {
+			if (tauPlusInv[e] < 0.0f)
+				continue;
+			float decay = exp(-tauPlusInv[e]);
+			int slot = 0;
+			while (slot < numSTDPPreTraceSlots_ && stdpPreTraceDecay_[slot] != decay)
+				slot++;
+			if (slot == numSTDPPreTraceSlots_)
+				stdpPreTraceDecay_[numSTDPPreTraceSlots_++] = decay;
+			if (e == 0)
+				stdpPreTraceSlotExc_[g] = slot;
+			else
+				stdpPreTraceSlotInb_[g] = slot;
+		}
+	}
+
+	stdpPostTraceExc = new float[numNReg];
+	stdpPostTraceInb = new float[numNReg];
+	memset(stdpPostTraceExc, 0, sizeof(float)*numNReg);
+	memset(stdpPostTraceInb, 0, sizeof(float)*numNReg);
+	cpuSnnSz.neuronInfoSize += 2*sizeof(float)*numNReg;
+
+	stdpPreTrace = new float[numSTDPPreTraceSlots_*numN*(maxDelay_+1)];
+	memset(stdpPreTrace, 0, sizeof(float)*numSTDPPreTraceSlots_*numN*(maxDelay_+1));
+	cpuSnnSz.neuronInfoSize += sizeof(float)*numSTDPPreTraceSlots_*numN*(maxDelay_+1);
+
+	// delay index of every incoming synapse, from the delay-sorted outgoing synapses of its pre-neuron
+	unsigned int numPreSyn = cumulativePre[numN-1] + Npre[numN-1];
+	synDelayIdx = new uint8_t[numPreSyn];
+	memset(synDelayIdx, 0, sizeof(uint8_t)*numPreSyn);
+	cpuSnnSz.synapticInfoSize += sizeof(uint8_t)*numPreSyn;
+	for (int nid=0; nid<numN; nid++) {
+		unsigned int offset = cumulativePost[nid];
+		for (unsigned int b=postDelayBucketCum[nid]; b<postDelayBucketCum[nid+1]; b++) {
+			delay_bucket_t dPar = postDelayBuckets[b];
+			for (int j=dPar.delay_index_start; j<dPar.delay_index_start+dPar.delay_length; j++) {
+				post_info_t post_info = postSynapticIds[offset + j];
+				unsigned int pos_i = cumulativePre[GET_CONN_NEURON_ID(post_info)] + GET_CONN_SYN_ID(post_info);
+				assert(pos_i < numPreSyn);
+				synDelayIdx[pos_i] = dPar.tD;
+			}
+		}
+	}
+
+	KERNEL_INFO("Built trace-based STDP with %d pre-synaptic trace(s)", numSTDPPreTraceSlots_);
+}
+
+// fills a lookup table with alpha*exp(-t*tauInv) for all t that pass the cutoff t*tauInv < 25, negated if sign < 0
+// the table is at most STDP_LUT_MAX_LEN long: isCutOff is set if the curve had to be cut off earlier
+static int fillSTDPExpTable(float* lut, float alpha, float tauInv, float sign, bool* isCutOff) {
+	int len = 0;
+	while (len < STDP_LUT_MAX_LEN && len*tauInv < 25) {
+		if (lut != NULL)
+			lut[len] = sign*STDP(len, alpha, tauInv);
+		len++;
+	}
+	*isCutOff = (len == STDP_LUT_MAX_LEN && len*tauInv < 25);
+	return len;
+}
+
+// fills a lookup table with the pulse I-STDP curve, which is the same for LTP and LTD
+// the table is at most STDP_LUT_MAX_LEN long: isCutOff is set if the pulse is wider than that
+static int fillSTDPPulseTable(float* lut, float betaLTP, float betaLTD, float lambda, float delta, bool* isCutOff) {
+	*isCutOff = (delta >= STDP_LUT_MAX_LEN);
+	int len = (delta >= 0.0f) ? (*isCutOff ? STDP_LUT_MAX_LEN : (int)floor(delta)+1) : 0;
+	if (lut != NULL) {
+		for (int t=0; t<len; t++)
+			lut[t] = (t <= lambda) ? -betaLTP : -betaLTD;
+	}
+	return len;
+}
+
+int CpuSNN::fillSTDPLookupTables(int grpId, float* buf) {
+	group_info_t* grp = &grp_Info[grpId];
+	stdp_lut_t* lut[4] = {&ltpExcLUT_[grpId], &ltdExcLUT_[grpId], &ltpInbLUT_[grpId], &ltdInbLUT_[grpId]};
+	int len[4] = {0, 0, 0, 0};
+	bool isCutOff[4] = {false, false, false, false};
+
+	if (grp->WithESTDP) {
+		switch (grp->WithESTDPcurve) {
+		case EXP_CURVE: // exponential curve
+			len[0] = fillSTDPExpTable(buf, grp->ALPHA_PLUS_EXC, grp->TAU_PLUS_INV_EXC, 1.0f, &isCutOff[0]);
+			break;
+		case TIMING_BASED_CURVE: // sc curve
+			len[0] = fillSTDPExpTable(buf, grp->ALPHA_PLUS_EXC, grp->TAU_PLUS_INV_EXC, 1.0f, &isCutOff[0]);
+			for (int t=0; buf != NULL && t<len[0]; t++)
+				buf[t] = (t <= grp->GAMMA) ? grp->OMEGA + grp->KAPPA*buf[t] : -buf[t];
+			break;
+		default:
+			KERNEL_ERROR("Invalid E-STDP curve!");
+			break;
+		}
+		len[1] = fillSTDPExpTable(buf ? buf+len[0] : NULL, grp->ALPHA_MINUS_EXC, grp->TAU_MINUS_INV_EXC, 1.0f,
+			&isCutOff[1]);
+	}
+
+	if (grp->WithISTDP) {
+		float* bufInb = buf ? buf+len[0]+len[1] : NULL;
+		switch (grp->WithISTDPcurve) {
+		case EXP_CURVE: // exponential curve, LTP of inhibitory synapse decreases synapse weight and vice versa
+			len[2] = fillSTDPExpTable(bufInb, grp->ALPHA_PLUS_INB, grp->TAU_PLUS_INV_INB, -1.0f, &isCutOff[2]);
+			len[3] = fillSTDPExpTable(bufInb ? bufInb+len[2] : NULL, grp->ALPHA_MINUS_INB, grp->TAU_MINUS_INV_INB,
+				-1.0f, &isCutOff[3]);
+			break;
+		case PULSE_CURVE: // pulse curve
+			len[2] = fillSTDPPulseTable(bufInb, grp->BETA_LTP, grp->BETA_LTD, grp->LAMBDA, grp->DELTA, &isCutOff[2]);
+			len[3] = fillSTDPPulseTable(bufInb ? bufInb+len[2] : NULL, grp->BETA_LTP, grp->BETA_LTD, grp->LAMBDA,
+				grp->DELTA, &isCutOff[3]);
+			break;
+		default:
+			KERNEL_ERROR("Invalid I-STDP curve!");
+			break;
+		}
+	}
+
+	// only warn in the pass that fills the tables (see buildSTDPLookupTables)
+	const char* lutName[4] = {"E-STDP LTP", "E-STDP LTD", "I-STDP LTP", "I-STDP LTD"};
+	for (int k=0; buf != NULL && k<4; k++) {
+		if (isCutOff[k])
+			KERNEL_WARN("%s curve of group %s is cut off after %d ms (its time constant or pulse width is too large)",
+				lutName[k], grp_Info2[grpId].Name.c_str(), STDP_LUT_MAX_LEN);
+	}
+
+	int offset = 0;
+	for (int k=0; k<4; k++) {
+		lut[k]->wtChange = (buf != NULL && len[k] > 0) ? buf+offset : NULL;
+		lut[k]->len = len[k];
+		offset += len[k];
+	}
+	return offset;
+}
+
+void CpuSNN::buildSTDPLookupTables() {
+	// first pass finds the size of all tables, second pass fills them
+	int numEntries = 0;
+	for (int g=0; g<numGrp; g++) {
+		if (grp_Info[g].WithSTDP)
+			numEntries += fillSTDPLookupTables(g, NULL);
+	}
+
+	stdpLUTBuf = new float[std::max(numEntries,1)];
+	cpuSnnSz.synapticInfoSize += sizeof(float)*numEntries;
+
+	numEntries = 0;
+	for (int g=0; g<numGrp; g++) {
+		if (grp_Info[g].WithSTDP)
+			numEntries += fillSTDPLookupTables(g, &stdpLUTBuf[numEntries]);
+	}
+
+	KERNEL_DEBUG("Built STDP lookup tables with %d entries", numEntries);
+}
+
 void CpuSNN::swapConnections(int nid, int oldPos, int newPos) {
 	unsigned int cumN=cumulativePost[nid];
 
@@ -5148,13 +6086,17 @@ void CpuSNN::swapConnections(int nid, int oldPos, int newPos) {
 }
 
 void CpuSNN::updateConnectionMonitor(short int connId) {
+	// weights skipped by updateWeights must be up to date for the snapshot
+	if (wtUpdateLast != NULL) {
+		runThreadTask(&CpuSNN::catchUpWeightsNeurons, numNReg);
+	}
+
 	for (int monId=0; monId<numConnectionMonitor; monId++) {
 		if (connId==ALL || connMonCoreList[monId]->getConnectId()==connId) {
 			int timeInterval = connMonCoreList[monId]->getUpdateTimeIntervalSec();
 			if (timeInterval==1 || (timeInterval>1 && (getSimTime()%timeInterval)==0)) {
 				// this ConnectionMonitor wants periodic recording
-				connMonCoreList[monId]->writeConnectFileSnapshot(simTime,
-					getWeightMatrix2D(connMonCoreList[monId]->getConnectId()));
+				connMonCoreList[monId]->writeConnectFileSnapshot(simTime);
 			}
 		}
 	}
@@ -5164,51 +6106,65 @@ void CpuSNN::updateConnectionMonitor(short int connId) {
 std::vector< std::vector<float> > CpuSNN::getWeightMatrix2D(short int connId) {
 	assert(connId!=ALL);
 	grpConnectInfo_t* connInfo = connectBegin;
-	std::vector< std::vector<float> > wtConnId;
+	while (connInfo && connInfo->connId!=connId)
+		connInfo = connInfo->next;
+	assert(connInfo!=NULL);
+	int grpIdPre = connInfo->grpSrc;
+	int grpIdPost = connInfo->grpDest;
 
-	// loop over all connections and find the ones with Connection Monitors
-	while (connInfo) {
-		if (connInfo->connId==connId) {
-			int grpIdPre = connInfo->grpSrc;
-			int grpIdPost = connInfo->grpDest;
-
-			// init weight matrix with right dimensions
-			for (int i=0; i<grp_Info[grpIdPre].SizeN; i++) {
-				std::vector<float> wtSlice;
-				for (int j=0; j<grp_Info[grpIdPost].SizeN; j++) {
-					wtSlice.push_back(NAN);
-				}
-				wtConnId.push_back(wtSlice);
-			}
+	// init weight matrix with right dimensions
+	std::vector< std::vector<float> > wtConnId(grp_Info[grpIdPre].SizeN,
+		std::vector<float>(grp_Info[grpIdPost].SizeN, NAN));
+
+	std::vector<float> wts;
+	std::vector<int> preIds, postIds;
+	getConnectionWeights(connId, wts);
+	getConnectionSynapseIds(connId, preIds, postIds);
+	for (size_t k=0; k<wts.size(); k++)
+		wtConnId[preIds[k]][postIds[k]] = wts[k];
+
+	return wtConnId;
+}
+
+void CpuSNN::getConnectionWeights(short int connId, std::vector<float>& wts) {
+	assert(connId>=0 && connId<(int)connSynRanges_.size());
+	const std::vector<syn_range_t>& ranges = connSynRanges_[connId];
 
 #ifndef __CPU_ONLY__
-			// copy the weights for a given post-group from device
-			// \TODO: check if the weights for this grpIdPost have already been copied
-			// \TODO: even better, but tricky because of ordering, make copyWeightState connection-based
-			if (simMode_==GPU_MODE) {
-				copyWeightState(&cpuNetPtrs, &cpu_gpuNetPtrs, cudaMemcpyDeviceToHost, false, grpIdPost);
-			}
+	// copy the weights for a given post-group from device
+	// \TODO: even better, but tricky because of ordering, make copyWeightState connection-based
+	if (simMode_==GPU_MODE && ranges.size()) {
+		copyWeightState(&cpuNetPtrs, &cpu_gpuNetPtrs, cudaMemcpyDeviceToHost, false, grpIds[ranges[0].nid]);
+	}
 #endif
 
-			for (int postId=grp_Info[grpIdPost].StartN; postId<=grp_Info[grpIdPost].EndN; postId++) {
-				unsigned int pos_ij = cumulativePre[postId];
-				for (int i=0; i<Npre[postId]; i++, pos_ij++) {
-					// skip synapses that belong to a different connection ID
-					if (cumConnIdPre[pos_ij]!=connInfo->connId)
-						continue;
-
-					// find pre-neuron ID and update ConnectionMonitor container
-					int preId = GET_CONN_NEURON_ID(preSynapticIds[pos_ij]);
-					wtConnId[preId-getGroupStartNeuronId(grpIdPre)][postId-getGroupStartNeuronId(grpIdPost)] =
-						fabs(wt[pos_ij]);
-				}
-			}
-			break;
-		}
-		connInfo = connInfo->next;
+	size_t nSyn = 0;
+	for (size_t r=0; r<ranges.size(); r++)
+		nSyn += ranges[r].length;
+	wts.resize(nSyn);
+
+	size_t k = 0;
+	for (size_t r=0; r<ranges.size(); r++) {
+		const float* wtRange = &wt[ranges[r].start];
+		for (unsigned int i=0; i<ranges[r].length; i++)
+			wts[k++] = fabs(wtRange[i]);
 	}
+}
 
-	return wtConnId;
+void CpuSNN::getConnectionSynapseIds(short int connId, std::vector<int>& preIds, std::vector<int>& postIds) {
+	assert(connId>=0 && connId<(int)connSynRanges_.size());
+
+	preIds.clear();
+	postIds.clear();
+	const std::vector<syn_range_t>& ranges = connSynRanges_[connId];
+	for (size_t r=0; r<ranges.size(); r++) {
+		int postId = ranges[r].nid - grp_Info[grpIds[ranges[r].nid]].StartN;
+		for (unsigned int pos=ranges[r].start; pos<ranges[r].start+ranges[r].length; pos++) {
+			int preId = GET_CONN_NEURON_ID(preSynapticIds[pos]);
+			preIds.push_back(preId - grp_Info[grpIds[preId]].StartN);
+			postIds.push_back(postId);
+		}
+	}
 }
 
 void CpuSNN::updateGroupMonitor(int grpId) {
@@ -5470,18 +6426,39 @@ void CpuSNN::updateSpikeMonitor(int grpId) {
 	if (!numSpikeMonitor)
 		return;
 
-	if (grpId==ALL) {
-		for (int g=0; g<numGrp; g++)
-			updateSpikeMonitor(g);
-	} else {
-		// update spike monitor of a specific group
-
+	// find the time interval in which to update spikes
+	// usually, we call updateSpikeMonitor once every second, so the time interval is [0,1000)
+	// however, updateSpikeMonitor can be called at any time t \in [0,1000)... so we can have the cases
+	// [0,t), [t,1000), and even [t1, t2)
+	// the upper bound is the same for all groups, but every group has its own lower bound (the last time its monitor
+	// was updated)
+	int numMsMax = getSimTimeMs(); // upper bound is given by current time
+	if (numMsMax==0)
+		numMsMax = 1000; // special case: full second
+
+	// current time is last completed second in milliseconds (plus t to be added below)
+	// special case is after each completed second where !getSimTimeMs(): here we look 1s back
+	int currentTimeSec = getSimTimeSec();
+	if (!getSimTimeMs())
+		currentTimeSec--;
+
+	// per group: lower bound of the time interval (INT_MAX if the group does not need an update), the monitor if it
+	// has a spike file, whether to write spikes to the AER array, and whether to update the spike counts
+	std::vector<int> grpNumMsMin(numGrp, INT_MAX);
+	std::vector<SpikeMonitorCore*> grpSpkFileMon(numGrp, (SpikeMonitorCore*)NULL);
+	std::vector<bool> grpWriteToArray(numGrp, false);
+	std::vector<bool> grpCountSpikes(numGrp, false);
+	int numMsMinAll = numMsMax;
+
+	int grpStart = (grpId==ALL) ? 0 : grpId;
+	int grpEnd = (grpId==ALL) ? numGrp-1 : grpId;
+	for (int g=grpStart; g<=grpEnd; g++) {
 		// find index in spike monitor arrays
-		int monitorId = grp_Info[grpId].SpikeMonitorId;
+		int monitorId = grp_Info[g].SpikeMonitorId;
 
 		// don't continue if no spike monitor enabled for this group
 		if (monitorId<0)
-			return;
+			continue;
 
 		// find last update time for this group
 		SpikeMonitorCore* spkMonObj = spikeMonCoreList[monitorId];
@@ -5489,196 +6466,266 @@ void CpuSNN::updateSpikeMonitor(int grpId) {
 
 		// don't continue if time interval is zero (nothing to update)
 		if ( ((int64_t)getSimTime()) - lastUpdate <=0)
-			return;
+			continue;
 
 		if ( ((int64_t)getSimTime()) - lastUpdate > 1000)
-			KERNEL_ERROR("updateSpikeMonitor(grpId=%d) must be called at least once every second",grpId);
+			KERNEL_ERROR("updateSpikeMonitor(grpId=%d) must be called at least once every second",g);
 
         // AER buffer max size warning here.
         // Because of C++ short-circuit evaluation, the last condition should not be evaluated
         // if the previous conditions are false.
         if (spkMonObj->getAccumTime() > LONG_SPIKE_MON_DURATION \
-                && this->getGroupNumNeurons(grpId) > LARGE_SPIKE_MON_GRP_SIZE \
+                && this->getGroupNumNeurons(g) > LARGE_SPIKE_MON_GRP_SIZE \
                 && spkMonObj->isBufferBig()){
             // change this warning message to correct message
-            KERNEL_WARN("updateSpikeMonitor(grpId=%d) is becoming very large. (>%lu MB)",grpId,(int64_t) MAX_SPIKE_MON_BUFFER_SIZE/1024 );// make this better
-            KERNEL_WARN("Reduce the cumulative recording time (currently %lu minutes) or the group size (currently %d) to avoid this.",spkMonObj->getAccumTime()/(1000*60),this->getGroupNumNeurons(grpId));
-		}
-#ifndef __CPU_ONLY__
-		if (simMode_ == GPU_MODE) {
-			// copy the neuron firing information from the GPU to the CPU..
-			copyFiringInfo_GPU();
+            KERNEL_WARN("updateSpikeMonitor(grpId=%d) is becoming very large. (>%lu MB)",g,(int64_t) MAX_SPIKE_MON_BUFFER_SIZE/1024 );// make this better
+            KERNEL_WARN("Reduce the cumulative recording time (currently %lu minutes) or the group size (currently %d) to avoid this.",spkMonObj->getAccumTime()/(1000*60),this->getGroupNumNeurons(g));
 		}
-#endif
 
-		// find the time interval in which to update spikes
-		// usually, we call updateSpikeMonitor once every second, so the time interval is [0,1000)
-		// however, updateSpikeMonitor can be called at any time t \in [0,1000)... so we can have the cases
-		// [0,t), [t,1000), and even [t1, t2)
 		int numMsMin = lastUpdate%1000; // lower bound is given by last time we called update
-		int numMsMax = getSimTimeMs(); // upper bound is given by current time
-		if (numMsMax==0)
-			numMsMax = 1000; // special case: full second
 		assert(numMsMin<numMsMax);
 
-		// current time is last completed second in milliseconds (plus t to be added below)
-		// special case is after each completed second where !getSimTimeMs(): here we look 1s back
-		int currentTimeSec = getSimTimeSec();
-		if (!getSimTimeMs())
-			currentTimeSec--;
-
 		// save current time as last update time
 		spkMonObj->setLastUpdated( (int64_t)getSimTime() );
 
 		// prepare fast access
-		FILE* spkFileId = spikeMonCoreList[monitorId]->getSpikeFileId();
-		bool writeSpikesToFile = spkFileId!=NULL;
-		bool writeSpikesToArray = spkMonObj->getMode()==AER && spkMonObj->isRecording();
+		grpNumMsMin[g] = numMsMin;
+		if (spkMonObj->getSpikeFileId()!=NULL)
+			grpSpkFileMon[g] = spkMonObj;
+		grpWriteToArray[g] = spkMonObj->getMode()==AER && spkMonObj->isRecording();
+		grpCountSpikes[g] = spkMonObj->getMode()==COUNT && spkMonObj->isRecording();
+		numMsMinAll = std::min(numMsMinAll, numMsMin);
+	}
+
+	// don't continue if no monitor needs an update
+	if (numMsMinAll == numMsMax)
+		return;
+
+#ifndef __CPU_ONLY__
+	if (simMode_ == GPU_MODE) {
+		// copy the neuron firing information from the GPU to the CPU..
+		copyFiringInfo_GPU();
+	}
+#endif
 
-		// Read one spike at a time from the buffer and put the spikes to an appopriate monitor buffer. Later the user
-		// may need need to dump these spikes to an output file
+	// Read one spike at a time from the buffer and put the spikes to the appopriate monitor buffer. All monitors are
+	// served in a single pass over the firing tables. Later the user may need need to dump these spikes to an output
+	// file
+	// the spikes of both tables are visited millisecond by millisecond, so that every monitor gets them in order
+	for(int t=numMsMinAll; t<numMsMax; t++) {
 		for (int k=0; k < 2; k++) {
 			unsigned int* timeTablePtr = (k==0)?timeTableD2:timeTableD1;
 			unsigned int* fireTablePtr = (k==0)?firingTableD2:firingTableD1;
-			for(int t=numMsMin; t<numMsMax; t++) {
-				for(unsigned int i=timeTablePtr[t+maxDelay_]; i<timeTablePtr[t+maxDelay_+1];i++) {
-					// retrieve the neuron id
-					int nid   = fireTablePtr[i];
-					if (simMode_ == GPU_MODE)
-						nid = GET_FIRING_TABLE_NID(nid);
-					assert(nid < numN);
-
-					// make sure neuron belongs to currently relevant group
-					int this_grpId = grpIds[nid];
-					if (this_grpId != grpId)
-						continue;
-
-					// adjust nid to be 0-indexed for each group
-					// this way, if a group has 10 neurons, their IDs in the spike file and spike monitor will be
-					// indexed from 0..9, no matter what their real nid is
-					nid -= grp_Info[grpId].StartN;
-					assert(nid>=0);
-
-					// current time is last completed second plus whatever is leftover in t
-					int time = currentTimeSec*1000 + t;
-
-					if (writeSpikesToFile) {
-						int cnt;
-						cnt = fwrite(&time, sizeof(int), 1, spkFileId); assert(cnt==1);
-						cnt = fwrite(&nid,  sizeof(int), 1, spkFileId); assert(cnt==1);
-					}
+			for(unsigned int i=timeTablePtr[t+maxDelay_]; i<timeTablePtr[t+maxDelay_+1];i++) {
+				// retrieve the neuron id
+				int nid   = fireTablePtr[i];
+				if (simMode_ == GPU_MODE)
+					nid = GET_FIRING_TABLE_NID(nid);
+				assert(nid < numN);
+
+				// make sure the group of the neuron is monitored and has not been updated past t
+				int this_grpId = grpIds[nid];
+				if (t < grpNumMsMin[this_grpId])
+					continue;
 
-					if (writeSpikesToArray) {
-						spkMonObj->pushAER(time,nid);
-					}
+				// adjust nid to be 0-indexed for each group
+				// this way, if a group has 10 neurons, their IDs in the spike file and spike monitor will be
+				// indexed from 0..9, no matter what their real nid is
+				nid -= grp_Info[this_grpId].StartN;
+				assert(nid>=0);
+
+				// current time is last completed second plus whatever is leftover in t
+				int time = currentTimeSec*1000 + t;
+
+				if (grpSpkFileMon[this_grpId]!=NULL) {
+					grpSpkFileMon[this_grpId]->pushSpikeToFile(time,nid);
+				}
+
+				if (grpWriteToArray[this_grpId]) {
+					spikeMonCoreList[grp_Info[this_grpId].SpikeMonitorId]->pushAER(time,nid);
+				} else if (grpCountSpikes[this_grpId]) {
+					spikeMonCoreList[grp_Info[this_grpId].SpikeMonitorId]->pushSpikeCount(time,nid);
 				}
 			}
 		}
+	}
 
-		if (spkFileId!=NULL) // flush spike file
-			fflush(spkFileId);
+	// close the count windows that have passed, including those without any spikes
+	for (int g=grpStart; g<=grpEnd; g++) {
+		if (grpCountSpikes[g])
+			spikeMonCoreList[grp_Info[g].SpikeMonitorId]->updateCountWindows(currentTimeSec*1000 + numMsMax);
+	}
+
+	// hand full spike file buffers to the I/O thread, the rest is written by flushSpikeFiles
+	for (int g=grpStart; g<=grpEnd; g++) {
+		if (grpSpkFileMon[g]!=NULL && grpSpkFileMon[g]->getSpikeFileBufferSize() >= SPIKE_FILE_BUFFER_SIZE) {
+			if (spikeFileWriter_ == NULL)
+				spikeFileWriter_ = new AsyncFileWriter(SPIKE_FILE_MAX_QUEUED_BUFFERS);
+			grpSpkFileMon[g]->writeSpikeFileBuffer(spikeFileWriter_);
+		}
+	}
+}
+
+void CpuSNN::flushSpikeFiles() {
+	// the buffers that are already queued come first
+	syncSpikeFileWriter();
+
+	for (unsigned int i=0; i<numSpikeMonitor; i++) {
+		if (spikeMonCoreList[i]!=NULL)
+			spikeMonCoreList[i]->writeSpikeFileBuffer(NULL);
 	}
 }
 
+void CpuSNN::syncSpikeFileWriter() {
+	if (spikeFileWriter_ != NULL && !spikeFileWriter_->sync())
+		KERNEL_ERROR("Could not write to spike file");
+}
+
 // This function updates the synaptic weights from its derivatives..
 void CpuSNN::updateWeights() {
 	// at this point we have already checked for sim_in_testing and sim_with_fixedwts
 	assert(sim_in_testing==false);
 	assert(sim_with_fixedwts==false);
 
-	// update synaptic weights here for all the neurons..
-	for(int g = 0; g < numGrp; g++) {
-		// no changable weights so continue without changing..
-		if(grp_Info[g].FixedInputWts || !(grp_Info[g].WithSTDP))
+	// fold STDP type, dopamine and STDP scale factor into a single factor per group and synapse type
+	// E-STDP applies to excitatory synapses and I-STDP to inhibitory ones. If a group has only one of the two, it
+	// applies to all plastic synapses of the group.
+	for (int g=0; g<numGrp; g++) {
+		if (grp_Info[g].FixedInputWts || !grp_Info[g].WithSTDP)
 			continue;
 
-		for(int i = grp_Info[g].StartN; i <= grp_Info[g].EndN; i++) {
-			assert(i < numNReg);
-			unsigned int offset = cumulativePre[i];
-			float diff_firing = 0.0;
-			float homeostasisScale = 1.0;
-
-			if(grp_Info[g].WithHomeostasis) {
-				assert(baseFiring[i]>0);
-				diff_firing = 1-avgFiring[i]/baseFiring[i];
-				homeostasisScale = grp_Info[g].homeostasisScale;
+		float change[2];
+		stdpType_t type[2] = {grp_Info[g].WithESTDPtype, grp_Info[g].WithISTDPtype};
+		for (int k=0; k<2; k++) {
+			switch (type[k]) {
+			case STANDARD:
+				// with homeostasis, the STDP scale factor is not applied
+				change[k] = grp_Info[g].WithHomeostasis ? 1.0f : stdpScaleFactor_;
+				break;
+			case DA_MOD:
+				change[k] = cpuNetPtrs.grpDA[g] * stdpScaleFactor_;
+				break;
+			case UNKNOWN_STDP:
+			default:
+				change[k] = 0.0f;
+				break;
 			}
+		}
+		if (type[0] == UNKNOWN_STDP)
+			change[0] = change[1];
+		if (type[1] == UNKNOWN_STDP)
+			change[1] = change[0];
 
-			if (i==grp_Info[g].StartN)
-				KERNEL_DEBUG("Weights, Change at %lu (diff_firing: %f)", simTimeSec, diff_firing);
-
-			for(int j = 0; j < Npre_plastic[i]; j++) {
-				//	if (i==grp_Info[g].StartN)
-				//		KERNEL_DEBUG("%1.2f %1.2f \t", wt[offset+j]*10, wtChange[offset+j]*10);
-				float effectiveWtChange = stdpScaleFactor_ * wtChange[offset + j];
-//				if (wtChange[offset+j])
-//					printf("connId=%d, wtChange[%d]=%f\n",cumConnIdPre[offset+j],offset+j,wtChange[offset+j]);
-
-				// homeostatic weight update
-				// FIXME: check WithESTDPtype and WithISTDPtype first and then do weight change update
-				switch (grp_Info[g].WithESTDPtype) {
-				case STANDARD:
-					if (grp_Info[g].WithHomeostasis) {
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + wtChange[offset+j])*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						// just STDP weight update
-						wt[offset+j] += effectiveWtChange;
-					}
-					break;
-				case DA_MOD:
-					if (grp_Info[g].WithHomeostasis) {
-						effectiveWtChange = cpuNetPtrs.grpDA[g] * effectiveWtChange;
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + effectiveWtChange)*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						wt[offset+j] += cpuNetPtrs.grpDA[g] * effectiveWtChange;
-					}
-					break;
-				case UNKNOWN_STDP:
-				default:
-					// we shouldn't even be in here if !WithSTDP
-					break;
-				}
+		wtUpdateCoeff_[g].changeExc = change[0];
+		wtUpdateCoeff_[g].changeInb = change[1];
+		wtUpdateCoeff_[g].homeoRate = grp_Info[g].WithHomeostasis ? 1.0f/grp_Info[g].avgTimeScale : 0.0f;
 
-				switch (grp_Info[g].WithISTDPtype) {
-				case STANDARD:
-					if (grp_Info[g].WithHomeostasis) {
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + wtChange[offset+j])*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						// just STDP weight update
-						wt[offset+j] += effectiveWtChange;
-					}
-					break;
-				case DA_MOD:
-					if (grp_Info[g].WithHomeostasis) {
-						effectiveWtChange = cpuNetPtrs.grpDA[g] * effectiveWtChange;
-						wt[offset+j] += (diff_firing*wt[offset+j]*homeostasisScale + effectiveWtChange)*baseFiring[i]/grp_Info[g].avgTimeScale/(1+fabs(diff_firing)*50);
-					} else {
-						wt[offset+j] += cpuNetPtrs.grpDA[g] * effectiveWtChange;
-					}
-					break;
-				case UNKNOWN_STDP:
-				default:
-					// we shouldn't even be in here if !WithSTDP
-					break;
-				}
+		// homeostasis changes weights without any wtChange, and the dopamine level differs from update to update,
+		// so only groups with neither can skip neurons (and catch up later with the same coefficients)
+		wtUpdateCoeff_[g].onlyPending = !grp_Info[g].WithHomeostasis && type[0] != DA_MOD && type[1] != DA_MOD;
+	}
 
-				// It is users' choice to decay weight change or not
-				// see setWeightAndWeightChangeUpdate()
-				wtChange[offset+j] *= wtChangeDecay_;
+	wtUpdateCnt_++;
+	runThreadTask(&CpuSNN::updateWeightsNeurons, numNReg);
+}
 
-				// if this is an excitatory or inhibitory synapse
-				if (maxSynWt[offset + j] >= 0) {
-					if (wt[offset + j] >= maxSynWt[offset + j])
-						wt[offset + j] = maxSynWt[offset + j];
-					if (wt[offset + j] < 0)
-						wt[offset + j] = 0.0;
-				} else {
-					if (wt[offset + j] <= maxSynWt[offset + j])
-						wt[offset + j] = maxSynWt[offset + j];
-					if (wt[offset+j] > 0)
-						wt[offset+j] = 0.0;
-				}
-			}
+void CpuSNN::updateWeightsNeurons(int startN, int endN) {
+	for (int i=startN; i<endN; i++) {
+		int g = grpIds[i];
+
+		// no changable weights so continue without changing..
+		if (grp_Info[g].FixedInputWts || !grp_Info[g].WithSTDP) {
+			if (wtUpdateLast != NULL)
+				wtUpdateLast[i] = wtUpdateCnt_;
+			continue;
+		}
+
+		// no STDP since the last update: wtChange is zero or decaying, which catchUpWeightsNeurons takes care of
+		if (wtUpdateCoeff_[g].onlyPending && !wtChangePending[i])
+			continue;
+		wtChangePending[i] = 0;
+		if (wtUpdateLast != NULL) {
+			assert(wtUpdateLast[i] == wtUpdateCnt_-1);
+			wtUpdateLast[i] = wtUpdateCnt_;
+		}
+
+		// every synapse is updated as wt = wt*a + wtChange*b, followed by clamping to [0,maxSynWt] (excitatory) or
+		// [maxSynWt,0] (inhibitory)
+		float aExc = 1.0f, aInb = 1.0f;
+		float bExc = wtUpdateCoeff_[g].changeExc;
+		float bInb = wtUpdateCoeff_[g].changeInb;
+		if (grp_Info[g].WithHomeostasis) {
+			assert(baseFiring[i]>0);
+			float avgFiringNow = avgFiring[i];
+			if (avgFiringTime != NULL) // lazy decay: decay since the last spike, without storing it
+				avgFiringNow *= getAvgFiringDecay(g, i);
+			float diff_firing = 1.0f-avgFiringNow/baseFiring[i];
+
+			// homeostatic weight update: wt += (diff_firing*wt*homeostasisScale + wtChange)*rate
+			float rate = baseFiring[i]*wtUpdateCoeff_[g].homeoRate/(1.0f+fabsf(diff_firing)*50.0f);
+			aExc = aInb = 1.0f + diff_firing*grp_Info[g].homeostasisScale*rate;
+			bExc *= rate;
+			bInb *= rate;
+		}
+
+		unsigned int offset = cumulativePre[i];
+		int numPlastic = Npre_plastic[i];
+		float* wtPtr = &wt[offset];
+		float* wtChangePtr = &wtChange[offset];
+		const float* maxSynWtPtr = &maxSynWt[offset];
+		for (int j=0; j<numPlastic; j++) {
+			float maxWt = maxSynWtPtr[j];
+			bool isInb = maxWt < 0.0f;
+			float w = wtPtr[j]*(isInb ? aInb : aExc) + wtChangePtr[j]*(isInb ? bInb : bExc);
+			w = std::max(w, std::min(maxWt, 0.0f));
+			wtPtr[j] = std::min(w, std::max(maxWt, 0.0f));
+
+			// It is users' choice to decay weight change or not
+			// see setWeightAndWeightChangeUpdate()
+			wtChangePtr[j] *= wtChangeDecay_;
+		}
+
+		if (postSynWt != NULL) {
+			for (int j=0; j<numPlastic; j++)
+				postSynWt[preSynPostIdx[offset + j]] = wtPtr[j];
+		}
+	}
+}
+
+void CpuSNN::catchUpWeightsNeurons(int startN, int endN) {
+	for (int i=startN; i<endN; i++) {
+		unsigned int numSkipped = wtUpdateCnt_ - wtUpdateLast[i];
+		if (numSkipped == 0)
+			continue;
+		wtUpdateLast[i] = wtUpdateCnt_;
+
+		// only neurons in groups with STANDARD STDP and without homeostasis are ever skipped, their coefficients are
+		// the same in every update
+		int g = grpIds[i];
+		assert(wtUpdateCoeff_[g].onlyPending);
+
+		// every skipped update adds b*wtChange and then decays wtChange, so the total is b*wtChange*sum_k decay^k
+		float decayAll = powf(wtChangeDecay_, (float)numSkipped);
+		float sumDecay = (1.0f-decayAll)/(1.0f-wtChangeDecay_);
+		float bExc = wtUpdateCoeff_[g].changeExc*sumDecay;
+		float bInb = wtUpdateCoeff_[g].changeInb*sumDecay;
+
+		unsigned int offset = cumulativePre[i];
+		int numPlastic = Npre_plastic[i];
+		float* wtPtr = &wt[offset];
+		float* wtChangePtr = &wtChange[offset];
+		const float* maxSynWtPtr = &maxSynWt[offset];
+		for (int j=0; j<numPlastic; j++) {
+			float maxWt = maxSynWtPtr[j];
+			float w = wtPtr[j] + wtChangePtr[j]*(maxWt < 0.0f ? bInb : bExc);
+			w = std::max(w, std::min(maxWt, 0.0f));
+			wtPtr[j] = std::min(w, std::max(maxWt, 0.0f));
+			wtChangePtr[j] *= decayAll;
+		}
+
+		if (postSynWt != NULL) {
+			for (int j=0; j<numPlastic; j++)
+				postSynWt[preSynPostIdx[offset + j]] = wtPtr[j];
 		}
 	}
 }
\ No newline at end of file
@@ -42,7 +42,7 @@
 #include <error_code.h>
 #include <cuda_runtime.h>
 
-#define ROUNDED_TIMING_COUNT  (((1000+MAX_SynapticDelay+1)+127) & ~(127))  // (1000+maxDelay_) rounded to multiple 128
+#define ROUNDED_TIMING_COUNT  (((1000+MAX_SynapticDelay_GPU+1)+127) & ~(127))  // (1000+maxDelay_) rounded to multiple 128
 
 #define  FIRE_CHUNK_CNT    (512)
 
@@ -2943,8 +2943,9 @@ void CpuSNN::copyWeightsGPU(unsigned int nid, int src_grp) {
 void CpuSNN::allocateSNN_GPU() {
 	checkAndSetGPUDevice();
 	// \FIXME why is this even here? shouldn't this be checked way earlier? and then in CPU_MODE, too...
-	if (maxDelay_ > MAX_SynapticDelay) {
-		KERNEL_ERROR("You are using a synaptic delay (%d) greater than MAX_SynapticDelay defined in config.h",maxDelay_);
+	if (maxDelay_ > MAX_SynapticDelay_GPU) {
+		KERNEL_ERROR("You are using a synaptic delay (%d) greater than MAX_SynapticDelay_GPU (%d)",maxDelay_,
+			MAX_SynapticDelay_GPU);
 		exitSimulation(1);
 	}
 
@@ -44,10 +44,6 @@ int SpikeMonitor::getPopNumSpikes() {
 	std::string funcName = "getPopNumSpikes()";
 	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
 
-	// \TODO
-	UserErrors::assertTrue(getMode()==AER, UserErrors::UNKNOWN, funcName, "",
-		"This function is not yet supported in this mode.");
-
 	return spikeMonitorCorePtr_->getPopNumSpikes();	
 }
 
@@ -84,13 +80,19 @@ int SpikeMonitor::getNeuronNumSpikes(int neurId) {
 	std::string funcName = "getNeuronNumSpikes()";
 	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
 
-	// \TODO
-	UserErrors::assertTrue(getMode()==AER, UserErrors::UNKNOWN, funcName, "",
-		"This function is not yet supported in this mode.");
-
 	return spikeMonitorCorePtr_->getNeuronNumSpikes(neurId);
 }
 
+SpikeTimesView SpikeMonitor::getNeuronSpikeTimes(int neurId) {
+	std::string funcName = "getNeuronSpikeTimes()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==AER, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "AER");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,number of neurons in the group)");
+
+	return spikeMonitorCorePtr_->getNeuronSpikeTimes(neurId);
+}
+
 // need to do error check here and maybe throw CARLsim errors.
 int SpikeMonitor::getNumNeuronsWithFiringRate(float min, float max){
 	std::string funcName = "getNumNeuronsWithFiringRate()";
@@ -132,6 +134,66 @@ std::vector<std::vector<int> > SpikeMonitor::getSpikeVector2D() {
 	return spikeMonitorCorePtr_->getSpikeVector2D();
 }
 
+std::vector<float> SpikeMonitor::getAllRecentFiringRates() {
+	std::string funcName = "getAllRecentFiringRates()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+
+	return spikeMonitorCorePtr_->getAllRecentFiringRates();
+}
+
+float SpikeMonitor::getNeuronFanoFactor(int neurId) {
+	std::string funcName = "getNeuronFanoFactor()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,number of neurons in the group)");
+
+	return spikeMonitorCorePtr_->getNeuronFanoFactor(neurId);
+}
+
+float SpikeMonitor::getNeuronIsiCV(int neurId) {
+	std::string funcName = "getNeuronIsiCV()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+	UserErrors::assertTrue(neurId>=0 && neurId<spikeMonitorCorePtr_->getGrpNumNeurons(), UserErrors::MUST_BE_IN_RANGE,
+		funcName, "neurId", "[0,number of neurons in the group)");
+
+	return spikeMonitorCorePtr_->getNeuronIsiCV(neurId);
+}
+
+int SpikeMonitor::getNumCountWindows() {
+	std::string funcName = "getNumCountWindows()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+
+	return spikeMonitorCorePtr_->getNumCountWindows();
+}
+
+float SpikeMonitor::getPopFanoFactor() {
+	std::string funcName = "getPopFanoFactor()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+
+	return spikeMonitorCorePtr_->getPopFanoFactor();
+}
+
+std::vector<int> SpikeMonitor::getPopIsiHistogram() {
+	std::string funcName = "getPopIsiHistogram()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+
+	return spikeMonitorCorePtr_->getPopIsiHistogram();
+}
+
+float SpikeMonitor::getPopMeanIsiCV() {
+	std::string funcName = "getPopMeanIsiCV()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(getMode()==COUNT, UserErrors::CAN_ONLY_BE_CALLED_IN_MODE, funcName, funcName, "COUNT");
+
+	return spikeMonitorCorePtr_->getPopMeanIsiCV();
+}
+
 std::vector<float> SpikeMonitor::getAllFiringRatesSorted(){
 	std::string funcName = "getAllFiringRatesSorted()";
 	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
@@ -205,13 +267,29 @@ spikeMonMode_t SpikeMonitor::getMode() {
 }
 
 void SpikeMonitor::setMode(spikeMonMode_t mode) {
-	// \TODO
-	UserErrors::assertTrue(false, UserErrors::UNKNOWN, "setMode()", "",
-		"This function call is not yet supported.");
+	std::string funcName = "setMode()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
 
 	spikeMonitorCorePtr_->setMode(mode);
 }
 
+void SpikeMonitor::setCountWindowMs(int windowMs) {
+	std::string funcName = "setCountWindowMs()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(windowMs>0, UserErrors::MUST_BE_POSITIVE, funcName, "windowMs");
+
+	spikeMonitorCorePtr_->setCountWindowMs(windowMs);
+}
+
+void SpikeMonitor::setIsiHistogram(int binSizeMs, int numBins) {
+	std::string funcName = "setIsiHistogram()";
+	UserErrors::assertTrue(!isRecording(), UserErrors::CANNOT_BE_ON, funcName, "Recording");
+	UserErrors::assertTrue(binSizeMs>0, UserErrors::MUST_BE_POSITIVE, funcName, "binSizeMs");
+	UserErrors::assertTrue(numBins>0, UserErrors::MUST_BE_POSITIVE, funcName, "numBins");
+
+	spikeMonitorCorePtr_->setIsiHistogram(binSizeMs, numBins);
+}
+
 void SpikeMonitor::setLogFile(const std::string& fileName) {
 	std::string funcName = "setLogFile";
 
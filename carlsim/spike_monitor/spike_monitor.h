@@ -59,15 +59,21 @@ class SpikeMonitorCore; // forward declaration of implementation
  * argument. The setSpikeMonitor call returns a pointer to a SpikeMonitor object which can be queried for spike data.
  *
  * There are two different modes that define what information is collected exactly.
- * - AER:   AER mode will collect the exact spike times of all neurons in the group and store them in a 2D spike
- *          spike vector. The first dimension of the vector is neuron id, the second dimension is spike times. Each
- *          element spkVector[i] is thus a vector of all spike times for the i-th neuron in the group.
+ * - AER:   AER mode will collect the exact spike times of all neurons in the group. The spike times of a neuron
+ *          can be accessed without copying them via getNeuronSpikeTimes, or all spikes can be retrieved as a 2D spike
+ *          vector via getSpikeVector2D. The first dimension of the vector is neuron id, the second dimension is spike
+ *          times. Each element spkVector[i] is thus a vector of all spike times for the i-th neuron in the group.
  *          This mode is activated by default.
  *          Because of the sheer amount of information, it is unwise to run this mode for extended periods of time.
  *          Note that recording in this mode may significantly slow down your simulation.
  * - COUNT:	SpikeCount mode will only collect spike count information, such as the number of spikes per neuron. This
  *          mode cannot retrieve exact spike times. Thus it is not possible to calculate some of the more elaborate
  *          metrics, such as spike-time correlations.
+ *          Instead, every spike updates a set of running statistics: the spike count of every neuron, the mean and
+ *          variance of its inter-spike intervals (ISIs), a histogram of all ISIs in the group, and the spike counts
+ *          in a count window that slides over the recording (see setCountWindowMs). These give rolling firing
+ *          rates, ISI coefficients of variation, and Fano factors. Since no spikes are stored, the memory needed
+ *          does not grow with the recording time, which makes this mode suitable for long simulations.
  *
  * Spike data will not be recorded until the SpikeMonitor member function startRecording() is called.
  * Before any metrics can be computed, the user must call stopRecording(). In general, a new recording period
@@ -168,6 +174,18 @@ class SpikeMonitor {
 	 */
 	std::vector<float> getAllFiringRatesSorted();
 
+	/*!
+	 * \brief Returns the firing rates of all the neurons in the most recent count window (COUNT mode only)
+	 *
+	 * This function returns the rolling firing rate (Hz) of each neuron in the group, that is the rate during the
+	 * most recent count window of the last recording period. The window slides in steps of a tenth of its length
+	 * (see setCountWindowMs), so it ends at most one step before the end of the recording period.
+	 * If no full count window has been recorded in the last recording period, all rates are zero.
+	 * \returns float vector of the recent firing rate of each neuron
+	 * \since v3.1
+	 */
+	std::vector<float> getAllRecentFiringRates();
+
 	/*!
 	 * \brief returns the largest neuronal mean firing rate in the group
 	 *
@@ -218,6 +236,43 @@ class SpikeMonitor {
 	 */
 	int getNeuronNumSpikes(int neurId);
 
+	/*!
+	 * \brief returns the spike times of a specific neuron in the group
+	 *
+	 * This function returns a read-only view of the spike times (ms, ascending) of a specific neuron in the recording
+	 * period. Unlike getSpikeVector2D, no spikes are copied, which makes it the preferred way to analyze the spike
+	 * trains of large groups. The view is only valid until the next call to startRecording (or until the
+	 * SpikeMonitor is deleted), so copy the spike times if you need them longer than that.
+	 * If PersistentMode is off, only the last recording period will be considered. If PersistentMode is on, all the
+	 * recording periods will be considered.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than getNumNeurons)
+	 * \returns SpikeTimesView of the spike times of the neuron
+	 * \since v3.1
+	 */
+	SpikeTimesView getNeuronSpikeTimes(int neurId);
+
+	/*!
+	 * \brief returns the Fano factor of the spike counts of a specific neuron (COUNT mode only)
+	 *
+	 * This function returns the variance divided by the mean of the number of spikes the neuron emitted in the
+	 * complete count windows of the recording periods. It is 1 for a Poisson process, and 0 if the neuron is silent
+	 * or no count window has been completed yet.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than getNumNeurons)
+	 * \since v3.1
+	 */
+	float getNeuronFanoFactor(int neurId);
+
+	/*!
+	 * \brief returns the coefficient of variation of the inter-spike intervals of a specific neuron (COUNT mode only)
+	 *
+	 * This function returns the standard deviation divided by the mean of the inter-spike intervals (ISIs) of the
+	 * neuron. It is 0 for a regular spike train and 1 for a Poisson process. ISIs never span the time between two
+	 * recording periods. If the neuron has fewer than two ISIs, the function returns 0.
+	 * \param[in] neurId the neuron ID (0-indexed, must be smaller than getNumNeurons)
+	 * \since v3.1
+	 */
+	float getNeuronIsiCV(int neurId);
+
 	/*!
 	 * \brief Returns the number of neurons that fall within this particular min/max range (inclusive).
 	 *
@@ -229,6 +284,16 @@ class SpikeMonitor {
 	 */
 	int getNumNeuronsWithFiringRate(float min, float max);
 
+	/*!
+	 * \brief returns the number of complete count windows (COUNT mode only)
+	 *
+	 * This is the number of non-overlapping count windows the Fano factors are computed from. The windows are laid
+	 * back to back from the start of each recording period, and a window is complete once the simulation has run
+	 * past its end while recording. An incomplete window at the end of a recording period is dropped.
+	 * \since v3.1
+	 */
+	int getNumCountWindows();
+
 	/*!
 	 * \brief returns the number of neurons that are silent.
 	 *
@@ -304,12 +369,44 @@ class SpikeMonitor {
 	 */
 	int getPopNumSpikes();
 
+	/*!
+	 * \brief Returns the Fano factor of the spike counts of the entire group (COUNT mode only)
+	 *
+	 * This function returns the variance divided by the mean of the number of spikes the whole group emitted in the
+	 * complete count windows. Since the spike counts of the neurons add up, this is a measure of synchrony: it is
+	 * about as large as the Fano factors of the neurons if they fire independently, and grows with the number of
+	 * neurons if they fire together. Returns 0 if no count window has been completed yet.
+	 * \since v3.1
+	 */
+	float getPopFanoFactor();
+
+	/*!
+	 * \brief Returns the histogram of all inter-spike intervals in the group (COUNT mode only)
+	 *
+	 * Element i of the returned vector counts the inter-spike intervals (ISIs) of all neurons in the group in the
+	 * range [i*binSizeMs, (i+1)*binSizeMs), except for the last element, which also counts all longer ISIs. The bins
+	 * are set with setIsiHistogram.
+	 * \since v3.1
+	 */
+	std::vector<int> getPopIsiHistogram();
+
+	/*!
+	 * \brief Returns the mean ISI coefficient of variation in the group (COUNT mode only)
+	 *
+	 * This function returns the mean of getNeuronIsiCV over all neurons in the group that have at least two
+	 * inter-spike intervals, or 0 if there are no such neurons.
+	 * \since v3.1
+	 */
+	float getPopMeanIsiCV();
+
 	/*!
 	 *\brief returns the 2D spike vector
 	 *
 	 * This function returns a 2D spike vector containing all the spikes of all the neurons in the group.
 	 * The first dimension of the vector is neurons, the second dimension is spike times. Each element spkVector[i]
 	 * is thus a vector of all spike times for the i-th neuron in the group.
+	 * Note that this function copies all recorded spikes. Use getNeuronSpikeTimes to access the spike times of a
+	 * neuron without copying them.
 	 * If PersistentMode is off, only the last recording period will be considered. If PersistentMode is on, all the
 	 * recording periods will be considered. By default, PersistentMode is off, and can be switched on by calling
 	 * setPersistentData(bool). The total time over which the metric is calculated can be retrieved by calling
@@ -438,7 +535,8 @@ class SpikeMonitor {
 	/*!
 	 * \brief Sets the current SpikeMonitor mode
 	 *
-	 * This function returns the current SpikeMonitor mode.
+	 * This function sets the current SpikeMonitor mode. All data recorded in the previous mode is discarded (see
+	 * clear). Recording must be off.
 	 * COUNT:	Will collect only spike count information (such as number of spikes per neuron),
 	 *          not the explicit spike times. COUNT mode cannot retrieve exact spike times per
 	 *          neuron, and is thus not capable of computing spike train correlation etc.
@@ -447,6 +545,31 @@ class SpikeMonitor {
 	 */
 	void setMode(spikeMonMode_t mode=AER);
 
+	/*!
+	 * \brief Sets the length of the count windows (COUNT mode)
+	 *
+	 * In COUNT mode, spikes are counted in count windows of windowMs milliseconds (default: 100 ms). For the
+	 * rolling rates of getAllRecentFiringRates, the window slides in steps of windowMs/10 ms; if windowMs is not a
+	 * multiple of 10, the step is the largest divisor of windowMs below that (at worst 1 ms). For the Fano factors
+	 * of getNeuronFanoFactor and getPopFanoFactor, the recording periods are divided into non-overlapping windows.
+	 * The memory needed grows with the number of steps per window, not with the recording time.
+	 * The statistics of windows recorded with the old length are discarded. Recording must be off.
+	 * \param[in] windowMs length of a count window (ms), must be positive
+	 * \since v3.1
+	 */
+	void setCountWindowMs(int windowMs);
+
+	/*!
+	 * \brief Sets the bins of the ISI histogram (COUNT mode)
+	 *
+	 * The histogram returned by getPopIsiHistogram has numBins bins of binSizeMs milliseconds each (default: 100 bins
+	 * of 1 ms). The ISIs counted so far are discarded. Recording must be off.
+	 * \param[in] binSizeMs bin size (ms), must be positive
+	 * \param[in] numBins number of bins, must be positive
+	 * \since v3.1
+	 */
+	void setIsiHistogram(int binSizeMs, int numBins);
+
 	/*!
 	 * \brief Sets the name of the spike file binary
 	 *
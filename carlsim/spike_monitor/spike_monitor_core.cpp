@@ -3,17 +3,51 @@
 #include <snn.h>				// CARLsim private implementation
 #include <snn_definitions.h>	// KERNEL_ERROR, KERNEL_INFO, ...
 
-#include <algorithm>			// std::sort
+#include <algorithm>			// std::sort, std::min, std::max, std::fill
 #include <string.h> 			// string, strcpy
 
 
+// the count window slides in steps of its largest divisor that is at most 1/SPIKE_MON_COUNT_WINDOW_BINS of its length
+static int findCountBinMs(int windowMs) {
+	int binMs = std::max(windowMs/SPIKE_MON_COUNT_WINDOW_BINS, 1);
+	while (windowMs%binMs)
+		binMs--;
+	return binMs;
+}
+
+// moves the bins of a sliding count window forward by nBin, all spikes since the last call are in the first bin that
+// ended, the other bins are empty. Every time the last slot of the ring buffer is filled, a count window is complete.
+static void closeCountBins(int* ring, int nCountBins, int curBin, int nBin, int& binSpikes, int& recentSpikes,
+	double& winSum, double& winSumSq)
+{
+	// after nCountBins empty bins the ring buffer holds only zeros, and the remaining windows add nothing
+	nBin = std::min(nBin, nCountBins+1);
+	for (int k=0; k<nBin; k++) {
+		int spikes = k ? 0 : binSpikes;
+		recentSpikes += spikes - ring[curBin];
+		ring[curBin] = spikes;
+		if (curBin==nCountBins-1) {
+			winSum += recentSpikes;
+			winSumSq += (double)recentSpikes*recentSpikes;
+		}
+		curBin = (curBin+1)%nCountBins;
+	}
+	binSpikes = 0;
+}
+
 // we aren't using namespace std so pay attention!
 SpikeMonitorCore::SpikeMonitorCore(CpuSNN* snn, int monitorId, int grpId) {
 	snn_ = snn;
 	grpId_= grpId;
 	monitorId_ = monitorId;
 	nNeurons_ = -1;
+	nSpikes_ = 0;
 	spikeFileId_ = NULL;
+	countWinMs_ = SPIKE_MON_COUNT_WINDOW_MS;
+	countBinMs_ = findCountBinMs(countWinMs_);
+	nCountBins_ = countWinMs_/countBinMs_;
+	isiBinMs_ = SPIKE_MON_ISI_BIN_MS;
+	isiHist_.assign(SPIKE_MON_ISI_NUM_BINS, 0);
 	recordSet_ = false;
 	spkMonLastUpdated_ = 0;
 
@@ -32,11 +66,6 @@ void SpikeMonitorCore::init() {
 	nNeurons_ = snn_->getGroupNumNeurons(grpId_);
 	assert(nNeurons_>0);
 
-	// spike vector will be a 2D structure that holds a list of spike times for each neuron in the group
-	// so the first dimension is neuron ID, and each spkVector_[i] holds the list of spike times of that neuron
-	// fix the first dimension of spike vector
-	spkVector_.resize(nNeurons_);
-
 	clear();
 
 	// use KERNEL_{ERROR|WARNING|etc} typesetting (const FILE*)
@@ -47,9 +76,11 @@ void SpikeMonitorCore::init() {
 }
 
 SpikeMonitorCore::~SpikeMonitorCore() {
-	if (spikeFileId_!=NULL) {
-		fclose(spikeFileId_);
-		spikeFileId_ = NULL;
+	closeSpikeFile();
+
+	for (size_t c=0; c<spkTimeChunks_.size(); c++) {
+		delete[] spkTimeChunks_[c];
+		delete[] spkNeurIdChunks_[c];
 	}
 }
 
@@ -65,8 +96,22 @@ void SpikeMonitorCore::clear() {
 	accumTime_ = 0;
 	totalTime_ = -1;
 
-	for (int i=0; i<nNeurons_; i++)
-		spkVector_[i].clear();
+	// keep the chunks around, they will be filled again by the next recording
+	nSpikes_ = 0;
+	spkNeurStart_.assign(nNeurons_+1, 0);
+	spkTimesByNeur_.clear();
+
+	needToCountSpikes_ = false;
+	needToIndexSpikes_ = false;
+
+	// reset the running statistics of COUNT mode
+	neur_spike_stats_t emptyStats = {0, -1, 0, 0.0, 0.0, 0, 0, 0.0, 0.0};
+	neurStats_.assign(nNeurons_, emptyStats);
+	std::fill(isiHist_.begin(), isiHist_.end(), 0);
+	resetCountBins(-1);
+	nCountWin_ = 0;
+	popWinSum_ = 0.0;
+	popWinSumSq_ = 0.0;
 
 	needToCalculateFiringRates_ = true;
 	needToSortFiringRates_ = true;
@@ -106,11 +151,36 @@ float SpikeMonitorCore::getPopStdFiringRate() {
 int SpikeMonitorCore::getPopNumSpikes() {
 	assert(!isRecording());
 
-	int nSpk = 0;
-	for (int i=0; i<nNeurons_; i++)
-		nSpk += getNeuronNumSpikes(i);
+	return nSpikes_;
+}
+
+float SpikeMonitorCore::getPopFanoFactor() {
+	assert(!isRecording());
+	assert(getMode()==COUNT);
 
-	return nSpk;
+	if (!nCountWin_)
+		return 0.0f;
+
+	double mean = popWinSum_/nCountWin_;
+	double var = popWinSumSq_/nCountWin_ - mean*mean;
+	return (mean>0.0) ? std::max(var,0.0)/mean : 0.0f;
+}
+
+float SpikeMonitorCore::getPopMeanIsiCV() {
+	assert(!isRecording());
+	assert(getMode()==COUNT);
+
+	// neurons with fewer than two ISIs don't have a CV
+	double sumCV = 0.0;
+	int nNeurCV = 0;
+	for (int i=0; i<nNeurons_; i++) {
+		if (neurStats_[i].nIsi>1) {
+			sumCV += getNeuronIsiCV(i);
+			nNeurCV++;
+		}
+	}
+
+	return nNeurCV ? sumCV/nNeurCV : 0.0f;
 }
 
 std::vector<float> SpikeMonitorCore::getAllFiringRates() {
@@ -145,12 +215,66 @@ float SpikeMonitorCore::getNeuronMeanFiringRate(int neurId) {
 	return getNeuronNumSpikes(neurId)*1000.0/getRecordingTotalTime();
 }
 
-int SpikeMonitorCore::getNeuronNumSpikes(int neurId) {
+float SpikeMonitorCore::getNeuronFanoFactor(int neurId) {
+	assert(!isRecording());
+	assert(neurId>=0 && neurId<nNeurons_);
+	assert(getMode()==COUNT);
+
+	if (!nCountWin_)
+		return 0.0f;
+
+	const neur_spike_stats_t& stats = neurStats_[neurId];
+	double mean = stats.winSum/nCountWin_;
+	double var = stats.winSumSq/nCountWin_ - mean*mean;
+	return (mean>0.0) ? std::max(var,0.0)/mean : 0.0f;
+}
+
+float SpikeMonitorCore::getNeuronIsiCV(int neurId) {
+	assert(!isRecording());
+	assert(neurId>=0 && neurId<nNeurons_);
+	assert(getMode()==COUNT);
+
+	const neur_spike_stats_t& stats = neurStats_[neurId];
+	if (stats.nIsi<2)
+		return 0.0f;
+
+	double mean = stats.isiSum/stats.nIsi;
+	double var = stats.isiSumSq/stats.nIsi - mean*mean;
+	return sqrt(std::max(var,0.0))/mean;
+}
+
+SpikeTimesView SpikeMonitorCore::getNeuronSpikeTimes(int neurId) {
 	assert(!isRecording());
 	assert(neurId>=0 && neurId<nNeurons_);
 	assert(getMode()==AER);
 
-	return spkVector_[neurId].size();
+	indexSpikes();
+	int nSpk = spkNeurStart_[neurId+1] - spkNeurStart_[neurId];
+	return SpikeTimesView(nSpk ? &spkTimesByNeur_[spkNeurStart_[neurId]] : NULL, nSpk);
+}
+
+int SpikeMonitorCore::getNeuronNumSpikes(int neurId) {
+	assert(!isRecording());
+	assert(neurId>=0 && neurId<nNeurons_);
+
+	if (getMode()==COUNT)
+		return neurStats_[neurId].nSpikes;
+
+	countSpikes();
+	return spkNeurStart_[neurId+1] - spkNeurStart_[neurId];
+}
+
+std::vector<float> SpikeMonitorCore::getAllRecentFiringRates() {
+	assert(!isRecording());
+	assert(getMode()==COUNT);
+
+	std::vector<float> rates(nNeurons_, 0.0f);
+	if (nFullBins_==nCountBins_) {
+		for (int i=0; i<nNeurons_; i++)
+			rates[i] = neurStats_[i].recentSpikes*1000.0f/countWinMs_;
+	}
+
+	return rates;
 }
 
 std::vector<float> SpikeMonitorCore::getAllFiringRatesSorted() {
@@ -204,7 +328,13 @@ std::vector<std::vector<int> > SpikeMonitorCore::getSpikeVector2D(){
 	assert(!isRecording());
 	assert(mode_==AER);
 
-	return spkVector_;
+	std::vector<std::vector<int> > spkVector(nNeurons_);
+	for (int i=0; i<nNeurons_; i++) {
+		SpikeTimesView spkTimes = getNeuronSpikeTimes(i);
+		spkVector[i].assign(spkTimes.begin(), spkTimes.end());
+	}
+
+	return spkVector;
 }
 
 void SpikeMonitorCore::print(bool printSpikeTimes) {
@@ -222,6 +352,17 @@ void SpikeMonitorCore::print(bool printSpikeTimes) {
 		getPopMeanFiringRate(),
 		getPopStdFiringRate());
 
+	if (mode_==COUNT) {
+		KERNEL_INFO("(t=%.3fs) SpikeMonitor for group %s(%d): ISI CV %.2f, Fano factor %.2f (%d windows of %d ms)",
+			(float)(snn_->getSimTime()/1000.0),
+			snn_->getGroupName(grpId_).c_str(),
+			grpId_,
+			getPopMeanIsiCV(),
+			getPopFanoFactor(),
+			nCountWin_,
+			countWinMs_);
+	}
+
 	if (printSpikeTimes && mode_==AER) {
 		// spike times only available in AER mode
 		KERNEL_INFO("| Neur ID | Rate (Hz) | Spike Times (ms)");
@@ -234,13 +375,14 @@ void SpikeMonitorCore::print(bool printSpikeTimes) {
 #else
 			snprintf(buffer, 200, "| %7d | % 9.2f | ", i, getNeuronMeanFiringRate(i));
 #endif
-			int nSpk = spkVector_[i].size();
+			SpikeTimesView spkTimes = getNeuronSpikeTimes(i);
+			int nSpk = spkTimes.size();
 			for (int j=0; j<nSpk; j++) {
 				char times[10];
 #if defined(WIN32) || defined(WIN64)
-				_snprintf(times, 10, "%8d", spkVector_[i][j]);
+				_snprintf(times, 10, "%8d", spkTimes[j]);
 #else
-				snprintf(times, 10, "%8d", spkVector_[i][j]);
+				snprintf(times, 10, "%8d", spkTimes[j]);
 #endif
 				strcat(buffer, times);
 				if (j%dispSpkTimPerRow == dispSpkTimPerRow-1 && j<nSpk-1) {
@@ -257,7 +399,72 @@ void SpikeMonitorCore::pushAER(int time, int neurId) {
 	assert(isRecording());
 	assert(getMode()==AER);
 
-	spkVector_[neurId].push_back(time);
+	int chunk = nSpikes_ / SPIKE_MON_CHUNK_SIZE;
+	int pos = nSpikes_ % SPIKE_MON_CHUNK_SIZE;
+	if (chunk == (int)spkTimeChunks_.size()) {
+		spkTimeChunks_.push_back(new int[SPIKE_MON_CHUNK_SIZE]);
+		spkNeurIdChunks_.push_back(new int[SPIKE_MON_CHUNK_SIZE]);
+	}
+	spkTimeChunks_[chunk][pos] = time;
+	spkNeurIdChunks_[chunk][pos] = neurId;
+	nSpikes_++;
+}
+
+void SpikeMonitorCore::pushSpikeCount(int time, int neurId) {
+	assert(isRecording());
+	assert(getMode()==COUNT);
+
+	// the spike belongs to a later bin: close the current one first
+	if (time >= countBinStart_+countBinMs_)
+		updateCountWindows(time);
+
+	neur_spike_stats_t& stats = neurStats_[neurId];
+	if (stats.lastSpikeTime>=0) {
+		int isi = time - stats.lastSpikeTime;
+		stats.nIsi++;
+		stats.isiSum += isi;
+		stats.isiSumSq += (double)isi*isi;
+		isiHist_[std::min(isi/isiBinMs_, (int)isiHist_.size()-1)]++;
+	}
+	stats.lastSpikeTime = time;
+	stats.nSpikes++;
+	stats.binSpikes++;
+	popBinSpikes_++;
+	nSpikes_++;
+}
+
+void SpikeMonitorCore::setCountWindowMs(int windowMs) {
+	assert(!isRecording());
+	assert(windowMs>0);
+
+	// the statistics of the old count windows no longer apply
+	countWinMs_ = windowMs;
+	countBinMs_ = findCountBinMs(countWinMs_);
+	nCountBins_ = countWinMs_/countBinMs_;
+	for (int i=0; i<nNeurons_; i++) {
+		neurStats_[i].winSum = 0.0;
+		neurStats_[i].winSumSq = 0.0;
+	}
+	resetCountBins(-1);
+	nCountWin_ = 0;
+	popWinSum_ = 0.0;
+	popWinSumSq_ = 0.0;
+}
+
+void SpikeMonitorCore::setIsiHistogram(int binSizeMs, int numBins) {
+	assert(!isRecording());
+	assert(binSizeMs>0 && numBins>0);
+
+	isiBinMs_ = binSizeMs;
+	isiHist_.assign(numBins, 0);
+}
+
+void SpikeMonitorCore::setMode(spikeMonMode_t mode) {
+	assert(!isRecording());
+
+	// the recorded data of one mode is of no use to the other
+	mode_ = mode;
+	clear();
 }
 
 void SpikeMonitorCore::startRecording() {
@@ -272,11 +479,19 @@ void SpikeMonitorCore::startRecording() {
 	// Caution: must be called before recordSet_ is set to true!
 	snn_->updateSpikeMonitor(grpId_);
 
+	needToCountSpikes_ = true;
+	needToIndexSpikes_ = true;
 	needToCalculateFiringRates_ = true;
 	needToSortFiringRates_ = true;
 	recordSet_ = true;
 	int64_t currentTime = snn_->getSimTimeSec()*1000+snn_->getSimTimeMs();
 
+	// COUNT mode: the first count window starts now, and neither count windows nor ISIs span the pause between
+	// recording periods (an incomplete count window of the last recording period is dropped)
+	resetCountBins(currentTime);
+	for (int i=0; i<nNeurons_; i++)
+		neurStats_[i].lastSpikeTime = -1;
+
 	if (persistentData_) {
 		// persistent mode on: accumulate all times
 		// change start time only if this is the first time running it
@@ -313,10 +528,7 @@ void SpikeMonitorCore::setSpikeFileId(FILE* spikeFileId) {
 	assert(!isRecording());
 
 	// close previous file pointer if exists
-	if (spikeFileId_!=NULL) {
-		fclose(spikeFileId_);
-		spikeFileId_ = NULL;
-	}
+	closeSpikeFile();
 
 	// set it to new file id
 	spikeFileId_=spikeFileId;
@@ -330,14 +542,79 @@ void SpikeMonitorCore::setSpikeFileId(FILE* spikeFileId) {
 	}
 }
 
+// count the spikes of every neuron in a single pass over the neuron ID column
+void SpikeMonitorCore::countSpikes() {
+	if (!needToCountSpikes_)
+		return;
+
+	spkNeurStart_.assign(nNeurons_+1, 0);
+	for (int k=0; k<nSpikes_; k++)
+		spkNeurStart_[spkNeurIdChunks_[k/SPIKE_MON_CHUNK_SIZE][k%SPIKE_MON_CHUNK_SIZE]+1]++;
+	for (int i=0; i<nNeurons_; i++)
+		spkNeurStart_[i+1] += spkNeurStart_[i];
+
+	needToCountSpikes_ = false;
+}
+
+// group the spike times by neuron (stable, so every neuron keeps its spikes in the order they were recorded)
+void SpikeMonitorCore::indexSpikes() {
+	if (!needToIndexSpikes_)
+		return;
+
+	countSpikes();
+
+	std::vector<int> fillPos(spkNeurStart_.begin(), spkNeurStart_.end()-1);
+	spkTimesByNeur_.resize(nSpikes_);
+	for (int k=0; k<nSpikes_; k++) {
+		int neurId = spkNeurIdChunks_[k/SPIKE_MON_CHUNK_SIZE][k%SPIKE_MON_CHUNK_SIZE];
+		spkTimesByNeur_[fillPos[neurId]++] = spkTimeChunks_[k/SPIKE_MON_CHUNK_SIZE][k%SPIKE_MON_CHUNK_SIZE];
+	}
+
+	needToIndexSpikes_ = false;
+}
+
+// close all bins that end at or before simTimeMs: the recent count window slides forward by one bin each, and the
+// Fano factors are computed from the non-overlapping count windows completed on the way
+void SpikeMonitorCore::updateCountWindows(int64_t simTimeMs) {
+	assert(getMode()==COUNT);
+	if (countBinStart_+countBinMs_ > simTimeMs)
+		return;
+
+	int nBin = (int)((simTimeMs - countBinStart_)/countBinMs_);
+	for (int i=0; i<nNeurons_; i++) {
+		neur_spike_stats_t& stats = neurStats_[i];
+		closeCountBins(&neurBinRing_[i*nCountBins_], nCountBins_, curBin_, nBin, stats.binSpikes, stats.recentSpikes,
+			stats.winSum, stats.winSumSq);
+	}
+	closeCountBins(&popBinRing_[0], nCountBins_, curBin_, nBin, popBinSpikes_, popRecentSpikes_, popWinSum_,
+		popWinSumSq_);
+
+	nCountWin_ += (curBin_+nBin)/nCountBins_;
+	curBin_ = (curBin_+nBin)%nCountBins_;
+	nFullBins_ = std::min(nFullBins_+nBin, nCountBins_);
+	countBinStart_ += (int64_t)nBin*countBinMs_;
+}
+
+void SpikeMonitorCore::resetCountBins(int64_t binStart) {
+	neurBinRing_.assign(nNeurons_*nCountBins_, 0);
+	popBinRing_.assign(nCountBins_, 0);
+	for (int i=0; i<nNeurons_; i++) {
+		neurStats_[i].binSpikes = 0;
+		neurStats_[i].recentSpikes = 0;
+	}
+	popBinSpikes_ = 0;
+	popRecentSpikes_ = 0;
+	curBin_ = 0;
+	nFullBins_ = 0;
+	countBinStart_ = binStart;
+}
+
 // calculate average firing rate for every neuron if we haven't done so already
 void SpikeMonitorCore::calculateFiringRates() {
 	// only update if we have to
 	if (!needToCalculateFiringRates_)
 		return;
 
-	assert(getMode()==AER);
-
 	// clear, so we get the same answer every time.
 	firingRates_.assign(nNeurons_,0);
 	firingRatesSorted_.assign(nNeurons_,0);
@@ -351,7 +628,7 @@ void SpikeMonitorCore::calculateFiringRates() {
 	// compute firing rate
 	assert(totalTime_>0); // avoid division by zero
 	for(int i=0;i<nNeurons_;i++) {
-		firingRates_[i]=spkVector_[i].size()*1000.0f/totalTime_;
+		firingRates_[i]=getNeuronNumSpikes(i)*1000.0f/totalTime_;
 	}
 
 	needToCalculateFiringRates_ = false;
@@ -404,15 +681,37 @@ void SpikeMonitorCore::writeSpikeFileHeader() {
 	needToWriteFileHeader_ = false;
 }
 
-// Iterate through 2D spike vector and approximate size in memory.
-// This is not exact, we are not counting the buffer overhead, only
-// the size each subvector is memory.
+void SpikeMonitorCore::writeSpikeFileBuffer(AsyncFileWriter* writer) {
+	if (spikeFileId_==NULL || spikeFileBuf_.empty())
+		return;
+
+	if (writer!=NULL) {
+		writer->write(spikeFileId_, spikeFileBuf_);
+	} else {
+		if (fwrite(&spikeFileBuf_[0],sizeof(int),spikeFileBuf_.size(),spikeFileId_) != spikeFileBuf_.size())
+			KERNEL_ERROR("SpikeMonitorCore: writeSpikeFileBuffer has fwrite error");
+		fflush(spikeFileId_);
+		spikeFileBuf_.clear();
+	}
+}
+
+void SpikeMonitorCore::closeSpikeFile() {
+	if (spikeFileId_==NULL)
+		return;
+
+	// the I/O thread might still be writing to the file
+	snn_->syncSpikeFileWriter();
+	writeSpikeFileBuffer(NULL);
+
+	fclose(spikeFileId_);
+	spikeFileId_ = NULL;
+}
+
+// Approximate size of the spike store in memory: the (time,neurId) columns of all recorded spikes.
+// This is not exact, we are not counting unused chunk space or the per-neuron index.
+// COUNT mode does not store spikes, its statistics take the same amount of memory no matter how long we record.
 int64_t SpikeMonitorCore::getBufferSize(){
-    int64_t bufferSize=0; // in bytes
-    for(int i=0; i<spkVector_.size();i++){
-        bufferSize+=spkVector_[i].size()*sizeof(int);
-    }
-    return bufferSize;
+    return (mode_==AER) ? (int64_t)nSpikes_*2*sizeof(int) : 0;
 }
 
 // check if the spike vector is getting large. If it is, return true once until
@@ -48,6 +48,20 @@
 #include <vector>					// std::vector
 
 class CpuSNN; // forward declaration of CpuSNN class
+class AsyncFileWriter; // forward declaration of AsyncFileWriter class
+
+//! running spike statistics of a neuron, updated with every spike in COUNT mode
+typedef struct {
+	int nSpikes;		//!< number of recorded spikes
+	int lastSpikeTime;	//!< time of the last spike (ms) in the current recording period, -1 if none
+	int nIsi;			//!< number of recorded inter-spike intervals (ISIs)
+	double isiSum;		//!< sum of ISIs (ms)
+	double isiSumSq;	//!< sum of squared ISIs (ms^2)
+	int binSpikes;		//!< number of spikes in the current bin
+	int recentSpikes;	//!< number of spikes in the last nCountBins_ complete bins, i.e. the most recent count window
+	double winSum;		//!< sum of spike counts over all complete count windows
+	double winSumSq;	//!< sum of squared spike counts over all complete count windows
+} neur_spike_stats_t;
 
 
 /*
@@ -78,6 +92,15 @@ public:
 	//! returns a list of firing rates for all neurons in the group (sorted by firing rate ascending)
 	std::vector<float> getAllFiringRatesSorted();
 
+	//! returns the firing rates of all neurons in the most recent (sliding) count window (COUNT mode)
+	std::vector<float> getAllRecentFiringRates();
+
+	//! returns the length of the count windows in ms (COUNT mode)
+	int getCountWindowMs() { return countWinMs_; }
+
+	//! returns the step size in ms by which the count window slides (COUNT mode)
+	int getCountBinMs() { return countBinMs_; }
+
 	//! returns the group ID
 	int getGrpId() { return grpId_; }
 
@@ -99,9 +122,21 @@ public:
 	//! returns the recorded mean firing rate for a specific neuron
 	float getNeuronMeanFiringRate(int neurId);
 
+	//! returns a view of the recorded spike times of a specific neuron (no copy)
+	SpikeTimesView getNeuronSpikeTimes(int neurId);
+
+	//! returns the Fano factor of the spike counts of a specific neuron in the count windows (COUNT mode)
+	float getNeuronFanoFactor(int neurId);
+
+	//! returns the coefficient of variation of the ISIs of a specific neuron (COUNT mode)
+	float getNeuronIsiCV(int neurId);
+
 	//! returns the number of recorded spikes of a specific neuron
 	int getNeuronNumSpikes(int neurId);
 
+	//! returns the number of complete count windows (COUNT mode)
+	int getNumCountWindows() { return nCountWin_; }
+
 	//! returns number of neurons whose firing rate was in [min,max] during recording
 	int getNumNeuronsWithFiringRate(float min, float max);
 
@@ -123,6 +158,15 @@ public:
 	//! returns the total number of recorded spikes in the group
 	int getPopNumSpikes();
 
+	//! returns the Fano factor of the spike counts of the whole group in the count windows (COUNT mode)
+	float getPopFanoFactor();
+
+	//! returns the histogram of all recorded ISIs in the group (COUNT mode)
+	std::vector<int> getPopIsiHistogram() { return isiHist_; }
+
+	//! returns the mean coefficient of variation of the ISIs of all neurons with at least two ISIs (COUNT mode)
+	float getPopMeanIsiCV();
+
 	//! computes the standard deviation of firing rates in the group
 	float getPopStdFiringRate();
 
@@ -138,7 +182,7 @@ public:
 	//! returns the timestamp of stopRecording
 	int64_t getRecordingStopTime() { return stopTime_; }
 
-	//! returns the 2D AER vector
+	//! returns the 2D AER vector (a copy of all recorded spikes, see getNeuronSpikeTimes)
 	std::vector<std::vector<int> > getSpikeVector2D();
 
 	//! returns recording status
@@ -147,11 +191,20 @@ public:
 	//! prints the AER vector in human-readable format
 	void print(bool printSpikeTimes);
 
-	//! inserts a (time,neurId) tupel into the 2D spike vector
+	//! appends a (time,neurId) tupel to the spike store
 	void pushAER(int time, int neurId);
 
+	//! adds a (time,neurId) tupel to the running spike statistics (COUNT mode), spikes must arrive in time order
+	void pushSpikeCount(int time, int neurId);
+
+	//! sets the length of the count windows (COUNT mode)
+	void setCountWindowMs(int windowMs);
+
+	//! sets bin size and number of bins of the ISI histogram (COUNT mode)
+	void setIsiHistogram(int binSizeMs, int numBins);
+
 	//! sets recording mode
-	void setMode(spikeMonMode_t mode) { mode_ = mode; }
+	void setMode(spikeMonMode_t mode);
 
 	//! sets status of PersistentData mode
 	void setPersistentData(bool persistentData) { persistentData_ = persistentData; }
@@ -165,7 +218,7 @@ public:
 
 	// +++++ PUBLIC METHODS THAT SHOULD NOT BE EXPOSED TO INTERFACE +++++++++//
 
-	//! deletes data from the 2D spike vector
+	//! deletes all recorded spikes (the memory of the spike store is kept for the next recording)
 	void clear();
 
 	//! returns a pointer to the spike file
@@ -174,6 +227,26 @@ public:
 	//! sets pointer to spike file
 	void setSpikeFileId(FILE* spikeFileId);
 
+	//! appends a (time,neurId) tupel to the spike file buffer (see writeSpikeFileBuffer)
+	void pushSpikeToFile(int time, int neurId) {
+		spikeFileBuf_.push_back(time);
+		spikeFileBuf_.push_back(neurId);
+	}
+
+	//! returns the number of ints in the spike file buffer
+	size_t getSpikeFileBufferSize() { return spikeFileBuf_.size(); }
+
+	/*!
+	 * \brief writes the spike file buffer to the spike file and empties the buffer
+	 *
+	 * If writer is not NULL, the buffer is handed to the I/O thread of writer. Otherwise, it is written (and
+	 * flushed) right away, in which case the caller must make sure that no buffers of this file are still queued.
+	 */
+	void writeSpikeFileBuffer(AsyncFileWriter* writer);
+
+	//! closes all bins (and count windows) that have ended by simTimeMs (COUNT mode)
+	void updateCountWindows(int64_t simTimeMs);
+
 	//! returns timestamp of last SpikeMonitor update
 	int64_t getLastUpdated() { return spkMonLastUpdated_; }
 
@@ -183,7 +256,7 @@ public:
     //! returns true if spike buffer is close to maxAllowedBufferSize
     bool isBufferBig();
 
-    //! returns the approximate size of the spike vector in bytes
+    //! returns the approximate size of the spike store in bytes
     int64_t getBufferSize();
 
     //! returns the total accumulated time
@@ -193,15 +266,33 @@ private:
 	//! initialization method
 	void init();
 
-	//! reads AER vector and updates firing rate member var
+	//! counts the spikes of every neuron in the spike store (spkNeurStart_), if necessary
+	void countSpikes();
+
+	//! groups the spike times in the spike store by neuron (spkTimesByNeur_), if necessary
+	void indexSpikes();
+
+	//! reads spike counts and updates firing rate member var
 	void calculateFiringRates();
 
 	//! reads AER vector and updates sorted firing rate member var
 	void sortFiringRates();
 
+	//! empties the bins of the sliding count window, the next bin starts at binStart (COUNT mode)
+	void resetCountBins(int64_t binStart);
+
 	//! writes the header section (file signature, version number) of a spike file
 	void writeSpikeFileHeader();
 
+	//! writes all pending spikes to the spike file and fcloses it
+	void closeSpikeFile();
+
+	//! whether we have to perform countSpikes()
+	bool needToCountSpikes_;
+
+	//! whether we have to perform indexSpikes()
+	bool needToIndexSpikes_;
+
 	//! whether we have to perform calculateFiringRates()
 	bool needToCalculateFiringRates_;
 
@@ -219,9 +310,35 @@ private:
 	FILE* spikeFileId_;	//!< file pointer to the spike file or NULL
 	int spikeFileSignature_; //!< int signature of spike file
 	float spikeFileVersion_; //!< version number of spike file
-
-	//! Used to analyzed the spike information
-	std::vector<std::vector<int> > spkVector_;
+	std::vector<int> spikeFileBuf_; //!< (time,neurId) tupels that have not yet been written to the spike file
+
+	// the recorded spikes are appended to two columns (spike time, neuron ID), which are allocated in chunks of
+	// SPIKE_MON_CHUNK_SIZE spikes, so that recording never moves spikes around
+	std::vector<int*> spkTimeChunks_;	//!< chunks of the spike time column
+	std::vector<int*> spkNeurIdChunks_;	//!< chunks of the neuron ID column
+	int nSpikes_;						//!< number of recorded spikes
+
+	// per-neuron index of the spike store in CSR format, built on demand once recording has stopped
+	std::vector<int> spkNeurStart_;		//!< spikes of neuron i are [spkNeurStart_[i],spkNeurStart_[i+1])
+	std::vector<int> spkTimesByNeur_;	//!< spike times grouped by neuron ID, in the order they were recorded
+
+	// running statistics of COUNT mode, their size does not depend on the recording time
+	std::vector<neur_spike_stats_t> neurStats_; //!< per neuron: spike count, ISI and count window statistics
+	std::vector<int> isiHist_;	//!< histogram of all ISIs in the group, the last bin also counts all longer ISIs
+	int isiBinMs_;				//!< bin size of the ISI histogram (ms)
+	int countWinMs_;			//!< length of the count windows (ms)
+	int countBinMs_;			//!< the recent count window slides in steps of one bin (ms), countWinMs_ is a multiple
+	int nCountBins_;			//!< number of bins per count window
+	std::vector<int> neurBinRing_; //!< ring buffers of the spike counts of the last nCountBins_ bins, one per neuron
+	std::vector<int> popBinRing_;  //!< ring buffer of the spike counts of the group in the last nCountBins_ bins
+	int curBin_;				//!< slot of the current bin in the ring buffers
+	int nFullBins_;				//!< number of complete bins in the ring buffers (at most nCountBins_)
+	int64_t countBinStart_;		//!< start time of the current bin (ms)
+	int nCountWin_;				//!< number of complete (non-overlapping) count windows
+	int popBinSpikes_;			//!< number of spikes of the group in the current bin
+	int popRecentSpikes_;		//!< number of spikes of the group in the most recent count window
+	double popWinSum_;			//!< sum of the spike counts of the group over all complete count windows
+	double popWinSumSq_;		//!< sum of the squared spike counts of the group over all complete count windows
 
 	std::vector<float> firingRates_;
 	std::vector<float> firingRatesSorted_;
@@ -336,14 +336,117 @@ TEST(ConnMon, weightFile) {
 		// sure they're the same
 		// file should have header+(number of snapshots)*((number of weights)+(timestamp as int64_t))*(bytes per word)
 
+		// a snapshot contains the timestamp as int64_t, the encoding flags, and all the weights of the connection
+
 		// if interval==-1: no snapshots in the file
-		int headerSize = fileLength[0] - 0*(GRP_SIZE*GRP_SIZE+2)*4;
+		int headerSize = fileLength[0] - 0*(GRP_SIZE*GRP_SIZE+3)*4;
 
 		// if interval==1: 11 snapshots from t = 0, 1, 2, ..., 10 sec plus one from 10.200 sec
-		EXPECT_EQ(headerSize, fileLength[1] - 12*(GRP_SIZE*GRP_SIZE+2)*4);
+		EXPECT_EQ(headerSize, fileLength[1] - 12*(GRP_SIZE*GRP_SIZE+3)*4);
 
 		// if interval==3: 4 snapshots from t = 0, 3, 6, 9, plus one from 10.200 sec
-		EXPECT_EQ(headerSize, fileLength[2] - 5*(GRP_SIZE*GRP_SIZE+2)*4);
+		EXPECT_EQ(headerSize, fileLength[2] - 5*(GRP_SIZE*GRP_SIZE+3)*4);
+	}
+}
+
+/*!
+ * \brief sparse connect file with delta-encoded, quantized snapshots
+ *
+ * The header section must list exactly the synapses that exist (CSR format), snapshots without weight changes must
+ * only contain the (empty) list of changed synapses, and decoding all snapshots must reproduce the current weights
+ * up to the quantization error.
+ */
+TEST(ConnMon, sparseSnapshotEncoding) {
+	const int GRP_SIZE = 20;
+	const float maxWt = 0.1f;
+	CARLsim* sim = new CARLsim("ConnMon.sparseSnapshotEncoding",CPU_MODE,SILENT,0,42);
+
+	int g0 = sim->createGroup("g0", GRP_SIZE, EXCITATORY_NEURON);
+	int g1 = sim->createGroup("g1", GRP_SIZE, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g0, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+	short int c0 = sim->connect(g0,g1,"random",RangeWeight(0.0f,0.05f,maxWt),0.2f,RangeDelay(1),RadiusRF(-1),
+		SYN_PLASTIC);
+	sim->setConductances(true);
+	sim->setupNetwork();
+
+	ConnectionMonitor* CM = sim->setConnectionMonitor(g0,g1,"results/weightsSparse.dat");
+	CM->setSnapshotEncoding(true, true);
+
+	// snapshots at t = 0, 1, 2 sec (no weight changes), then at 3 sec (all weights changed)
+	sim->runNetwork(2,0);
+	sim->scaleWeights(c0, 0.5f);
+	sim->runNetwork(1,0);
+	std::vector< std::vector<float> > wt = CM->takeSnapshot();
+	int nSynapses = CM->getNumSynapses();
+	delete sim;
+
+	FILE* fp = fopen("results/weightsSparse.dat","rb");
+	ASSERT_TRUE(fp!=NULL);
+
+	// skip signature, connection ID, group info, number of synapses, isPlastic, minWt
+	float version, wtMax;
+	int nNeurPre = GRP_SIZE;
+	fseek(fp, sizeof(int), SEEK_SET);
+	EXPECT_EQ(fread(&version,sizeof(float),1,fp), 1);
+	EXPECT_FLOAT_EQ(version, 0.4f);
+	fseek(fp, sizeof(short int) + 8*sizeof(int) + sizeof(int) + sizeof(bool) + sizeof(float), SEEK_CUR);
+	EXPECT_EQ(fread(&wtMax,sizeof(float),1,fp), 1);
+	EXPECT_FLOAT_EQ(wtMax, maxWt);
+
+	// CSR section must list the existing synapses
+	std::vector<int> preStart(nNeurPre+1);
+	EXPECT_EQ(fread(&preStart[0],sizeof(int),nNeurPre+1,fp), nNeurPre+1);
+	EXPECT_EQ(preStart[nNeurPre], nSynapses);
+	std::vector<int> postId(preStart[nNeurPre]);
+	EXPECT_EQ(fread(&postId[0],sizeof(int),postId.size(),fp), postId.size());
+	int nExist = 0;
+	for (int i=0; i<nNeurPre; i++) {
+		for (int j=0; j<GRP_SIZE; j++) {
+			nExist += !isnan(wt[i][j]);
+		}
+		for (int k=preStart[i]; k<preStart[i+1]; k++) {
+			EXPECT_FALSE(isnan(wt[i][postId[k]]));
+		}
+	}
+	EXPECT_EQ(nExist, nSynapses);
+
+	// decode the snapshots
+	int64_t expTime[4] = {0, 1000, 2000, 3000};
+	int expFlags[4] = {2, 3, 3, 2}; // quantized (2), delta (1)
+	std::vector<float> wtFile(nSynapses, NAN);
+	for (int s=0; s<4; s++) {
+		int64_t time;
+		int flags, nChanged;
+		float step;
+		EXPECT_EQ(fread(&time,sizeof(int64_t),1,fp), 1);
+		EXPECT_EQ(fread(&flags,sizeof(int),1,fp), 1);
+		EXPECT_EQ(fread(&step,sizeof(float),1,fp), 1);
+		EXPECT_EQ(time, expTime[s]);
+		EXPECT_EQ(flags, expFlags[s]);
+		std::vector<int> synIdx;
+		if (flags & 1) {
+			EXPECT_EQ(fread(&nChanged,sizeof(int),1,fp), 1);
+			EXPECT_EQ(nChanged, 0);
+		} else {
+			for (int k=0; k<nSynapses; k++)
+				synIdx.push_back(k);
+		}
+		std::vector<unsigned short> wtQuant(synIdx.size());
+		if (synIdx.size()) {
+			EXPECT_EQ(fread(&wtQuant[0],sizeof(unsigned short),synIdx.size(),fp), synIdx.size());
+		}
+		for (unsigned int k=0; k<synIdx.size(); k++)
+			wtFile[synIdx[k]] = wtQuant[k]*step;
+	}
+	char c;
+	EXPECT_EQ(fread(&c,1,1,fp), 0); // end of file
+	fclose(fp);
+
+	for (int i=0; i<nNeurPre; i++) {
+		for (int k=preStart[i]; k<preStart[i+1]; k++) {
+			EXPECT_NEAR(wtFile[k], wt[i][postId[k]], maxWt/65535);
+		}
 	}
 }
 
@@ -9,6 +9,68 @@
 /// CONNECT FUNCTIONALITY
 /// **************************************************************************************************************** ///
 
+// connects pre-neuron i to post-neurons i, i+1, ..., i+4 (wrapping around), the fractional delays are truncated
+class RingConnGen : public ConnectionGenerator {
+public:
+	RingConnGen(int numPost) : numPost_(numPost) {}
+
+	void connect(CARLsim* sim, int srcGrp, int i, int destGrp, int j, float& weight, float& maxWt, float& delay,
+		bool& connected) {
+		connected = ((j - i + numPost_) % numPost_) < 5;
+		weight = 0.01f*((i+j)%10);
+		maxWt = 0.1f;
+		delay = 1.7f + (i+j)%4;
+	}
+
+private:
+	int numPost_;
+};
+
+// same connectivity as RingConnGen, but generates all connections of a block of pre-neurons at once
+class RingBatchConnGen : public BatchConnectionGenerator {
+public:
+	RingBatchConnGen(int numPost, bool threadSafe) : numPost_(numPost), threadSafe_(threadSafe) {}
+
+	void connect(CARLsim* sim, int srcGrp, int startI, int endI, int destGrp,
+		std::vector<ConnectionTuple>& connections) {
+		for (int i=startI; i<endI; i++) {
+			for (int k=0; k<5; k++) {
+				int j = (i+k) % numPost_;
+				connections.push_back(ConnectionTuple(i, j, 0.01f*((i+j)%10), 0.1f, 1.7f + (i+j)%4));
+			}
+		}
+	}
+
+	bool isThreadSafe() { return threadSafe_; }
+
+private:
+	int numPost_;
+	bool threadSafe_;
+};
+
+// connects pre-neuron i to post-neuron i with a delay of longDelays[i] ms
+static const int longDelays[] = {1, 21, 100, 255};
+
+class LongDelayConnGen : public ConnectionGenerator {
+public:
+	void connect(CARLsim* sim, int srcGrp, int i, int destGrp, int j, float& weight, float& maxWt, float& delay,
+		bool& connected) {
+		connected = (i == j);
+		weight = 100.0f;
+		maxWt = 100.0f;
+		delay = longDelays[i];
+	}
+};
+
+// lets every neuron fire a single spike at t=10ms
+class SingleSpikeGen : public SpikeGenerator {
+public:
+	unsigned int nextSpikeTime(CARLsim* s, int grpId, int i, unsigned int currentTime,
+		unsigned int lastScheduledSpikeTime, unsigned int endOfTimeSlice) {
+		return (lastScheduledSpikeTime < 10) ? 10 : 0xFFFFFFFF;
+	}
+};
+
 /*
 // \FIXME: deactivate for now, because we don't want to instantiate CpuSNN
 
@@ -194,15 +256,15 @@ TEST(CONNECT, connectRandom) {
 
 	sim->setupNetwork(); // need SETUP state for this function to work
 
-	// from CpuSNN::connect: estimate max number of connections needed using binomial distribution
-	// at 6.5 standard deviations
-	int errorMargin = ceil(6.5*sqrt(prob*(1-prob)*grid.N)) + 1;
-	EXPECT_NEAR(sim->getNumSynapticConnections(c0), prob * grid.N * grid.N, errorMargin);
-	EXPECT_NEAR(sim->getNumSynapticConnections(c1), prob * grid.N * grid.x, errorMargin);
-	EXPECT_NEAR(sim->getNumSynapticConnections(c2), prob * grid.N * grid.x * grid.z, errorMargin);
-	EXPECT_NEAR(sim->getNumSynapticConnections(c3), prob*144, errorMargin); // these numbers are less than what the
-	EXPECT_NEAR(sim->getNumSynapticConnections(c4), prob*224, errorMargin); // grid would say because of edge effects
-	EXPECT_NEAR(sim->getNumSynapticConnections(c5), prob*320, errorMargin);
+	// the number of synapses follows a binomial distribution over all (pre,post) pairs within the RF: allow for
+	// 6.5 standard deviations (same as CpuSNN::connect)
+	// the last three numbers are less than what the grid would say because of edge effects
+	int numPairs[6] = {grid.N * grid.N, grid.N * grid.x, grid.N * grid.x * grid.z, 144, 224, 320};
+	int connIds[6] = {c0, c1, c2, c3, c4, c5};
+	for (int i=0; i<6; i++) {
+		int errorMargin = ceil(6.5*sqrt(prob*(1-prob)*numPairs[i])) + 1;
+		EXPECT_NEAR(sim->getNumSynapticConnections(connIds[i]), prob * numPairs[i], errorMargin);
+	}
 
 	delete sim;
 }
@@ -405,3 +467,162 @@ TEST(CONNECT, connectGaussian) {
 		}
 	}
 }
+
+TEST(CONNECT, connectRandomGaussianNumThreads) {
+	// random and gaussian connections are sampled with one random stream per pre-neuron, so the resulting
+	// connectivity must not depend on the number of threads
+	std::vector< std::vector<float> > wtRand[2], wtGauss[2];
+	int nSynRand[2], nSynGauss[2];
+	int numThreads[2] = {1, 3};
+
+	for (int run=0; run<2; run++) {
+		CARLsim* sim = new CARLsim("CONNECT.connectRandomGaussianNumThreads",CPU_MODE,SILENT,0,42);
+		sim->setNumThreads(numThreads[run]);
+
+		// more pre-neurons than are sampled in one batch
+		int g0=sim->createGroup("pre", Grid3D(20,20,4), EXCITATORY_NEURON);
+		int g1=sim->createGroup("postRand", Grid3D(20,20,4), EXCITATORY_NEURON);
+		int g2=sim->createGroup("postGauss", Grid3D(10,10,2), EXCITATORY_NEURON);
+		sim->setNeuronParameters(g0, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->setNeuronParameters(g2, 0.02f, 0.2f, -65.0f, 8.0f);
+
+		int c0=sim->connect(g0, g1, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.1f, RangeDelay(1,10), RadiusRF(4,4,-1),
+			SYN_PLASTIC);
+		int c1=sim->connect(g0, g2, "gaussian", RangeWeight(0.1f), 0.5f, RangeDelay(1), RadiusRF(3,3,1));
+
+		sim->setupNetwork();
+
+		nSynRand[run] = sim->getNumSynapticConnections(c0);
+		nSynGauss[run] = sim->getNumSynapticConnections(c1);
+		wtRand[run] = sim->setConnectionMonitor(g0, g1, "NULL")->takeSnapshot();
+		wtGauss[run] = sim->setConnectionMonitor(g0, g2, "NULL")->takeSnapshot();
+		delete sim;
+	}
+
+	EXPECT_GT(nSynRand[0], 0);
+	EXPECT_GT(nSynGauss[0], 0);
+	EXPECT_EQ(nSynRand[0], nSynRand[1]);
+	EXPECT_EQ(nSynGauss[0], nSynGauss[1]);
+	for (int c=0; c<2; c++) {
+		std::vector< std::vector<float> >* wt = (c==0) ? wtRand : wtGauss;
+		for (int i=0; i<wt[0].size(); i++) {
+			for (int j=0; j<wt[0][i].size(); j++) {
+#if defined(WIN32) || defined(WIN64)
+				bool isConnected = !_isnan(wt[0][i][j]);
+				EXPECT_EQ(!_isnan(wt[1][i][j]), isConnected);
+#else
+				bool isConnected = !isnan(wt[0][i][j]);
+				EXPECT_EQ(!isnan(wt[1][i][j]), isConnected);
+#endif
+				if (isConnected)
+					EXPECT_FLOAT_EQ(wt[0][i][j], wt[1][i][j]);
+			}
+		}
+	}
+}
+
+TEST(CONNECT, connectBatchConnectionGenerator) {
+	// a BatchConnectionGenerator must give the same network as the equivalent ConnectionGenerator, no matter whether
+	// it is run on one or several threads
+	int numN = 1500; // more pre-neurons than are generated in one batch
+	std::vector< std::vector<float> > wt[3];
+	std::vector<uint8_t> delays[3];
+	int nSyn[3];
+	int maxDelay[3];
+
+	for (int run=0; run<3; run++) {
+		CARLsim* sim = new CARLsim("CONNECT.connectBatchConnectionGenerator",CPU_MODE,SILENT,0,42);
+		sim->setNumThreads(run==2 ? 3 : 1);
+		int g0=sim->createSpikeGeneratorGroup("input", numN, EXCITATORY_NEURON);
+		int g1=sim->createGroup("excit", numN, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+
+		RingConnGen ringCG(numN);
+		RingBatchConnGen ringBCG(numN, run==2);
+		int c0;
+		if (run==0)
+			c0 = sim->connect(g0, g1, &ringCG, SYN_PLASTIC);
+		else
+			c0 = sim->connect(g0, g1, &ringBCG, SYN_PLASTIC);
+
+		sim->setupNetwork();
+
+		nSyn[run] = sim->getNumSynapticConnections(c0);
+		maxDelay[run] = sim->getDelayRange(c0).max;
+		wt[run] = sim->setConnectionMonitor(g0, g1, "NULL")->takeSnapshot();
+		int nPre, nPost;
+		uint8_t* d = sim->getDelays(g0, g1, nPre, nPost);
+		delays[run].assign(d, d+nPre*nPost);
+		delete[] d;
+		delete sim;
+	}
+
+	EXPECT_EQ(nSyn[0], numN*5);
+	EXPECT_EQ(maxDelay[0], 4);
+	for (int run=1; run<3; run++) {
+		EXPECT_EQ(nSyn[run], nSyn[0]);
+		EXPECT_EQ(maxDelay[run], maxDelay[0]);
+		EXPECT_TRUE(delays[run] == delays[0]);
+		for (int i=0; i<numN; i++) {
+			for (int j=0; j<numN; j++) {
+#if defined(WIN32) || defined(WIN64)
+				bool isConnected = !_isnan(wt[0][i][j]);
+				EXPECT_EQ(!_isnan(wt[run][i][j]), isConnected);
+#else
+				bool isConnected = !isnan(wt[0][i][j]);
+				EXPECT_EQ(!isnan(wt[run][i][j]), isConnected);
+#endif
+				if (isConnected)
+					EXPECT_FLOAT_EQ(wt[run][i][j], wt[0][i][j]);
+			}
+		}
+	}
+}
+
+TEST(CONNECT, connectLongDelays) {
+	// delays beyond 20 ms must be stored and delivered correctly, no matter how many threads deliver the spikes
+	int numN = sizeof(longDelays)/sizeof(longDelays[0]);
+	for (int numThreads=1; numThreads<=3; numThreads+=2) {
+		CARLsim* sim = new CARLsim("CONNECT.connectLongDelays",CPU_MODE,SILENT,0,42);
+		sim->setNumThreads(numThreads);
+		int g0=sim->createSpikeGeneratorGroup("input", numN, EXCITATORY_NEURON);
+		int g1=sim->createGroup("excit", numN, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+
+		LongDelayConnGen longDelayCG;
+		int c0 = sim->connect(g0, g1, &longDelayCG, SYN_FIXED);
+		sim->setConductances(false);
+
+		SingleSpikeGen singleSG;
+		sim->setSpikeGenerator(g0, &singleSG);
+
+		sim->setupNetwork();
+		EXPECT_EQ(sim->getDelayRange(c0).min, 1);
+		EXPECT_EQ(sim->getDelayRange(c0).max, 255);
+
+		int nPre, nPost;
+		uint8_t* delays = sim->getDelays(g0, g1, nPre, nPost);
+		for (int i=0; i<numN; i++) {
+			for (int j=0; j<numN; j++) {
+				EXPECT_EQ(delays[i+nPre*j], (i==j) ? longDelays[i] : 0);
+			}
+		}
+		delete[] delays;
+
+		SpikeMonitor* spkMon = sim->setSpikeMonitor(g1, "NULL");
+		spkMon->startRecording();
+		sim->runNetwork(0,300,false);
+		spkMon->stopRecording();
+
+		// every post-neuron fires once, shortly after its input spike (fired at t=10ms) has arrived
+		std::vector<std::vector<int> > spkTimes = spkMon->getSpikeVector2D();
+		for (int i=0; i<numN; i++) {
+			ASSERT_EQ(spkTimes[i].size(), 1);
+			EXPECT_GE(spkTimes[i][0], 10 + longDelays[i]);
+			EXPECT_LE(spkTimes[i][0], 10 + longDelays[i] + 2);
+		}
+
+		delete sim;
+	}
+}
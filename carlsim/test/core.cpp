@@ -3,6 +3,10 @@
 
 #include <carlsim.h>
 #include <vector>
+#include <math.h>	// isnan
+
+#include <propagated_spike_buffer.h>
+#include <cpu_thread_pool.h>
 
 #if defined(WIN32) || defined(WIN64)
 #include <periodic_spikegen.h>
@@ -393,6 +397,36 @@ TEST(CORE, getDelayRange) {
 	}
 }
 
+// getDelays must return the delay of every (pre,post) pair of the two groups, also if the pre-group does not start at
+// neuron 0 (spike generators are placed after all regular neurons), and also for the last pre-neuron
+TEST(CORE, getDelays) {
+	int nNeur = 4;
+	int delay = 3;
+
+	CARLsim* sim = new CARLsim("CORE.getDelays",CPU_MODE,SILENT,0,42);
+	int g0=sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g0, 0.02f, 0.2f,-65.0f,8.0f);
+	int gPre=sim->createSpikeGeneratorGroup("input", nNeur, EXCITATORY_NEURON);
+	int gPost=sim->createGroup("output", nNeur, EXCITATORY_NEURON);
+	sim->setNeuronParameters(gPost, 0.02f, 0.2f,-65.0f,8.0f);
+	sim->connect(gPre, gPost, "one-to-one", RangeWeight(0.5f), 1.0f, RangeDelay(delay));
+	sim->connect(g0, g0, "one-to-one", RangeWeight(0.5f), 1.0f, RangeDelay(1));
+	sim->setConductances(true);
+	sim->setupNetwork();
+
+	int nPre, nPost;
+	uint8_t* delays = sim->getDelays(gPre, gPost, nPre, nPost);
+	ASSERT_EQ(nPre, nNeur);
+	ASSERT_EQ(nPost, nNeur);
+	for (int i=0; i<nPre; i++) {
+		for (int j=0; j<nPost; j++)
+			EXPECT_EQ(delays[i+nPre*j], (i==j) ? delay : 0);
+	}
+
+	delete[] delays;
+	delete sim;
+}
+
 TEST(CORE, getWeightRange) {
 	CARLsim* sim;
 	int nNeur = 10;
@@ -600,6 +634,367 @@ TEST(CORE, startStopTestingPhase) {
 	}
 }
 
+// This test makes sure that multi-threaded CPU mode produces exactly the same spikes and weights as
+// single-threaded CPU mode (for the same random seed)
+// STP does not support delays > 1 ms, so we run once with STP and once with axonal delays (D2 spike delivery)
+TEST(CORE, setNumThreads) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	std::vector<std::vector<int> > spkExcST, spkInhST;
+	std::vector<std::vector<float> > wtST;
+
+	int numThreads[] = {1, 3, 4};
+	for (int hasSTP=0; hasSTP<=1; hasSTP++) {
+		for (int t=0; t<3; t++) {
+			CARLsim* sim = new CARLsim("CORE.setNumThreads",CPU_MODE,SILENT,0,42);
+			sim->setNumThreads(numThreads[t]);
+
+			int gIn = sim->createSpikeGeneratorGroup("input", 100, EXCITATORY_NEURON);
+			int gExc = sim->createGroup("exc", 200, EXCITATORY_NEURON);
+			sim->setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+			int gInh = sim->createGroup("inh", 50, INHIBITORY_NEURON);
+			sim->setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f); // FS
+
+			sim->connect(gIn, gExc, "random", RangeWeight(0.0f, 0.05f, 0.1f), 0.2f, 
+				hasSTP ? RangeDelay(1) : RangeDelay(3), RadiusRF(-1), SYN_PLASTIC);
+			sim->connect(gExc, gInh, "random", RangeWeight(0.05f), 0.1f, RangeDelay(1));
+			sim->connect(gInh, gExc, "random", RangeWeight(0.1f), 0.1f, RangeDelay(1));
+
+			sim->setConductances(true, 5, 20, 150, 6, 100, 150);
+			sim->setESTDP(gExc, true, STANDARD, ExpCurve(2e-4f,20.0f, -6.6e-5f,60.0f));
+			sim->setHomeostasis(gExc, true, 1.0f, 10.0f);
+			sim->setHomeoBaseFiringRate(gExc, 10.0f, 0.0f);
+			if (hasSTP) {
+				sim->setSTP(gInh, true);
+			}
+			sim->setupNetwork();
+
+			SpikeMonitor* spkMonExc = sim->setSpikeMonitor(gExc, "NULL");
+			SpikeMonitor* spkMonInh = sim->setSpikeMonitor(gInh, "NULL");
+			ConnectionMonitor* connMon = sim->setConnectionMonitor(gIn, gExc, "NULL");
+
+			PoissonRate in(100);
+			in.setRates(20.0f);
+			sim->setSpikeRate(gIn, &in);
+
+			spkMonExc->startRecording();
+			spkMonInh->startRecording();
+			sim->runNetwork(2,0,false);
+			spkMonExc->stopRecording();
+			spkMonInh->stopRecording();
+
+			if (numThreads[t] == 1) {
+				// single-threaded: store spikes and weights for future comparison
+				spkExcST = spkMonExc->getSpikeVector2D();
+				spkInhST = spkMonInh->getSpikeVector2D();
+				wtST = connMon->takeSnapshot();
+				EXPECT_GT(spkMonExc->getPopNumSpikes(), 0);
+			} else {
+				// multi-threaded: must be bit-identical
+				EXPECT_TRUE(spkMonExc->getSpikeVector2D() == spkExcST);
+				EXPECT_TRUE(spkMonInh->getSpikeVector2D() == spkInhST);
+				std::vector<std::vector<float> > wtMT = connMon->takeSnapshot();
+				for (int i=0; i<wtST.size(); i++) {
+					for (int j=0; j<wtST[i].size(); j++) {
+						// non-existent synapses are NAN
+						if (isnan(wtST[i][j])) {
+							EXPECT_TRUE(isnan(wtMT[i][j]));
+						} else {
+							EXPECT_EQ(wtMT[i][j], wtST[i][j]);
+						}
+					}
+				}
+			}
+
+			delete sim;
+		}
+	}
+}
+
+// arguments of the scheduling task of CORE.propagatedSpikeBufferShards
+struct SpikeBufferTaskArg {
+	PropagatedSpikeBuffer* buf;
+	int numNeurons;
+	int t;
+};
+
+// the delays of the two spikes that neuron nid schedules at time step t, both smaller than the buffer length
+static int spikeBufferTestDelay(int nid, int t, int k, int len) {
+	return k ? (nid*7 + t*3) % len : (nid + t) % len;
+}
+
+// every thread schedules the spikes of a contiguous range of neurons into its own shard
+static void scheduleSpikeBufferTask(void* arg, int threadId, int numThreads) {
+	SpikeBufferTaskArg* a = (SpikeBufferTaskArg*)arg;
+	int len = (int)a->buf->length();
+	for (int nid=a->numNeurons*threadId/numThreads; nid<a->numNeurons*(threadId+1)/numThreads; nid++) {
+		if ((nid + a->t) % 3 == 0)
+			continue;
+		for (int k=0; k<2; k++)
+			a->buf->scheduleSpikeTargetGroup(nid, spikeBufferTestDelay(nid, a->t, k, len), threadId);
+	}
+}
+
+// Spikes that several threads schedule into their own shards must show up in the right time slots after mergeShards,
+// in the same order as if they had been scheduled from a single thread: the neuron IDs of two groups are split
+// across the threads, the shards write to overlapping slots, and the ring buffer wraps around many times.
+TEST(CORE, propagatedSpikeBufferShards) {
+	const int numThreads = 4;
+	const int maxDelay = 10;
+	const int numNeurons = 2*25; // two groups of 25 neurons, the thread ranges don't align with them
+	const int numSteps = 100;
+
+	PropagatedSpikeBuffer buf(0, maxDelay, numThreads);
+	CpuThreadPool pool(numThreads);
+	int len = (int)buf.length();
+	ASSERT_EQ(len, maxDelay+1);
+
+	// expected spikes per absolute time step, in the order of a single-threaded run
+	std::vector<std::vector<int> > expected(numSteps+2*len);
+	for (int t=0; t<numSteps+len; t++) {
+		if (t < numSteps) {
+			SpikeBufferTaskArg arg = {&buf, numNeurons, t};
+			pool.run(&scheduleSpikeBufferTask, &arg);
+
+			// the new spikes are not visible before the shards are merged
+			for (int d=0; d<len; d++)
+				EXPECT_EQ(buf.numSpikeTargetGroups(d), expected[t+d].size());
+			buf.mergeShards();
+
+			for (int nid=0; nid<numNeurons; nid++) {
+				if ((nid + t) % 3 == 0)
+					continue;
+				for (int k=0; k<2; k++)
+					expected[t + spikeBufferTestDelay(nid, t, k, len)].push_back(nid);
+			}
+		}
+
+		// every slot holds exactly the spikes scheduled for its time step so far
+		for (int d=0; d<len; d++) {
+			std::vector<int> slot(buf.beginSpikeTargetGroups(d), buf.endSpikeTargetGroups(d));
+			EXPECT_TRUE(slot == expected[t+d]);
+		}
+		buf.nextTimeStep();
+	}
+
+	// all spikes have been delivered
+	for (int d=0; d<len; d++)
+		EXPECT_EQ(buf.numSpikeTargetGroups(d), 0);
+}
+
+TEST(CORE, setPostOrderedSynapses) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	std::vector<std::vector<int> > spkExcRef, spkInhRef;
+	std::vector<std::vector<float> > wtRef;
+
+	// run the same network with the default layout, the post-ordered layout, and post-ordered + multi-threaded
+	for (int layout=0; layout<3; layout++) {
+		CARLsim* sim = new CARLsim("CORE.setPostOrderedSynapses",CPU_MODE,SILENT,0,42);
+		sim->setPostOrderedSynapses(layout>0);
+		sim->setNumThreads(layout==2 ? 3 : 1);
+
+		int gIn = sim->createSpikeGeneratorGroup("input", 100, EXCITATORY_NEURON);
+		int gExc = sim->createGroup("exc", 200, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+		int gInh = sim->createGroup("inh", 50, INHIBITORY_NEURON);
+		sim->setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f); // FS
+
+		short int cIn = sim->connect(gIn, gExc, "random", RangeWeight(0.0f, 0.05f, 0.1f), 0.2f, RangeDelay(4),
+			RadiusRF(-1), SYN_PLASTIC);
+		sim->connect(gExc, gInh, "random", RangeWeight(0.05f), 0.1f, RangeDelay(2));
+		short int cInh = sim->connect(gInh, gExc, "random", RangeWeight(0.1f), 0.1f, RangeDelay(1));
+
+		sim->setConductances(true);
+		sim->setESTDP(gExc, true, STANDARD, ExpCurve(2e-4f,20.0f, -6.6e-5f,60.0f));
+		sim->setupNetwork();
+
+		SpikeMonitor* spkMonExc = sim->setSpikeMonitor(gExc, "NULL");
+		SpikeMonitor* spkMonInh = sim->setSpikeMonitor(gInh, "NULL");
+		ConnectionMonitor* connMon = sim->setConnectionMonitor(gIn, gExc, "NULL");
+
+		PoissonRate in(100);
+		in.setRates(20.0f);
+		sim->setSpikeRate(gIn, &in);
+
+		spkMonExc->startRecording();
+		spkMonInh->startRecording();
+		sim->runNetwork(1,0,false);
+
+		// weights changed from outside must reach the post-ordered copy
+		sim->scaleWeights(cInh, 1.5f, true);
+		sim->biasWeights(cIn, 0.01f, false);
+		sim->runNetwork(1,0,false);
+		spkMonExc->stopRecording();
+		spkMonInh->stopRecording();
+
+		if (layout == 0) {
+			spkExcRef = spkMonExc->getSpikeVector2D();
+			spkInhRef = spkMonInh->getSpikeVector2D();
+			wtRef = connMon->takeSnapshot();
+			EXPECT_GT(spkMonExc->getPopNumSpikes(), 0);
+			EXPECT_GT(spkMonInh->getPopNumSpikes(), 0);
+		} else {
+			EXPECT_TRUE(spkMonExc->getSpikeVector2D() == spkExcRef);
+			EXPECT_TRUE(spkMonInh->getSpikeVector2D() == spkInhRef);
+			std::vector<std::vector<float> > wt = connMon->takeSnapshot();
+			for (int i=0; i<wtRef.size(); i++) {
+				for (int j=0; j<wtRef[i].size(); j++) {
+					// non-existent synapses are NAN
+					if (isnan(wtRef[i][j])) {
+						EXPECT_TRUE(isnan(wt[i][j]));
+					} else {
+						EXPECT_EQ(wt[i][j], wtRef[i][j]);
+					}
+				}
+			}
+		}
+
+		delete sim;
+	}
+}
+
+// the kernel draws its random numbers from streams keyed on what they are drawn for (a connection and pre-neuron, a
+// group and neuron, ...), so adding an unrelated group or changing the number of threads must not change the rest of
+// the network
+TEST(CORE, randomStreams) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	std::vector<std::vector<int> > spkRef[2];
+	std::vector<uint8_t> delayRef[2];
+
+	for (int hasExtra=0; hasExtra<=1; hasExtra++) {
+		CARLsim* sim = new CARLsim("CORE.randomStreams",CPU_MODE,SILENT,0,42);
+		sim->setNumThreads(hasExtra ? 3 : 1);
+
+		int gIn = sim->createSpikeGeneratorGroup("input", 50, EXCITATORY_NEURON);
+		int gExc = sim->createGroup("exc", 50, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gExc, 0.02f, 0.005f, 0.2f, 0.01f, -65.0f, 5.0f, 8.0f, 2.0f);
+		int gInh = sim->createGroup("inh", 50, INHIBITORY_NEURON);
+		sim->setNeuronParameters(gInh, 0.1f, 0.01f, 0.2f, 0.01f, -65.0f, 2.0f, 2.0f, 0.5f);
+		sim->connect(gIn, gExc, "full", RangeWeight(0.02f), 1.0f, RangeDelay(1,20));
+		sim->connect(gExc, gInh, "one-to-one", RangeWeight(0.5f), 1.0f, RangeDelay(1,20));
+		if (hasExtra) {
+			int gExtra = sim->createGroup("extra", 30, EXCITATORY_NEURON);
+			sim->setNeuronParameters(gExtra, 0.02f, 0.005f, 0.2f, 0.01f, -65.0f, 5.0f, 8.0f, 2.0f);
+			sim->connect(gIn, gExtra, "full", RangeWeight(0.02f), 1.0f, RangeDelay(1,20));
+		}
+		sim->setConductances(true);
+		sim->setupNetwork();
+
+		SpikeMonitor* spkMon[2];
+		spkMon[0] = sim->setSpikeMonitor(gExc, "NULL");
+		spkMon[1] = sim->setSpikeMonitor(gInh, "NULL");
+
+		PoissonRate in(50);
+		in.setRates(20.0f);
+		sim->setSpikeRate(gIn, &in);
+
+		for (int k=0; k<2; k++)
+			spkMon[k]->startRecording();
+		sim->runNetwork(1,0,false);
+		for (int k=0; k<2; k++)
+			spkMon[k]->stopRecording();
+
+		int grpPre[] = {gIn, gExc}, grpPost[] = {gExc, gInh};
+		for (int k=0; k<2; k++) {
+			int nPre, nPost;
+			uint8_t* delays = sim->getDelays(grpPre[k], grpPost[k], nPre, nPost);
+			std::vector<uint8_t> delayVec(delays, delays+nPre*nPost);
+			delete[] delays;
+
+			if (!hasExtra) {
+				spkRef[k] = spkMon[k]->getSpikeVector2D();
+				delayRef[k] = delayVec;
+				EXPECT_GT(spkMon[k]->getPopNumSpikes(), 0);
+
+				// all delays in the range must be used
+				EXPECT_TRUE(std::find(delayVec.begin(), delayVec.end(), 1) != delayVec.end());
+				EXPECT_TRUE(std::find(delayVec.begin(), delayVec.end(), 20) != delayVec.end());
+			} else {
+				EXPECT_TRUE(spkMon[k]->getSpikeVector2D() == spkRef[k]);
+				EXPECT_TRUE(delayVec == delayRef[k]);
+			}
+		}
+
+		delete sim;
+	}
+}
+
+TEST(CORE, setLazyDecay) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	// run a network with homeostasis once with the default decay and once with lazy decay
+	int numSpkRef[3];
+	std::vector<std::vector<float> > wtRef;
+
+	for (int isLazy=0; isLazy<=1; isLazy++) {
+		CARLsim* sim = new CARLsim("CORE.setLazyDecay",CPU_MODE,SILENT,0,42);
+		sim->setLazyDecay(isLazy==1);
+
+		int gIn = sim->createSpikeGeneratorGroup("input", 100, EXCITATORY_NEURON);
+		int gExc = sim->createGroup("exc", 100, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+		int gInh = sim->createGroup("inh", 25, INHIBITORY_NEURON);
+		sim->setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f); // FS
+
+		sim->connect(gIn, gExc, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.2f, RangeDelay(1,10), RadiusRF(-1),
+			SYN_PLASTIC);
+		sim->connect(gExc, gInh, "random", RangeWeight(0.05f), 0.1f, RangeDelay(1));
+		sim->connect(gInh, gExc, "random", RangeWeight(0.1f), 0.1f, RangeDelay(1));
+
+		sim->setConductances(true);
+		sim->setESTDP(gExc, true, STANDARD, ExpCurve(2e-4f,20.0f, -6.6e-5f,60.0f));
+		sim->setHomeostasis(gExc, true, 1.0f, 0.5f);
+		sim->setHomeoBaseFiringRate(gExc, 10.0f, 0.0f);
+		sim->setupNetwork();
+
+		SpikeMonitor* spkMon[3];
+		spkMon[0] = sim->setSpikeMonitor(gExc, "NULL");
+		spkMon[1] = sim->setSpikeMonitor(gInh, "NULL");
+		spkMon[2] = sim->setSpikeMonitor(gIn, "NULL");
+		ConnectionMonitor* connMon = sim->setConnectionMonitor(gIn, gExc, "NULL");
+
+		PoissonRate in(100);
+		in.setRates(15.0f);
+		sim->setSpikeRate(gIn, &in);
+
+		for (int k=0; k<3; k++)
+			spkMon[k]->startRecording();
+		sim->runNetwork(3,0,false);
+		for (int k=0; k<3; k++)
+			spkMon[k]->stopRecording();
+
+		std::vector<std::vector<float> > wt = connMon->takeSnapshot();
+		if (!isLazy) {
+			for (int k=0; k<3; k++) {
+				numSpkRef[k] = spkMon[k]->getPopNumSpikes();
+				EXPECT_GT(numSpkRef[k], 0);
+			}
+			wtRef = wt;
+		} else {
+			// the input is the same, the rest may only differ by floating-point rounding (pow vs. decaying every ms)
+			EXPECT_EQ(spkMon[2]->getPopNumSpikes(), numSpkRef[2]);
+			for (int k=0; k<2; k++)
+				EXPECT_NEAR(spkMon[k]->getPopNumSpikes(), numSpkRef[k], 0.01*numSpkRef[k]);
+			for (int i=0; i<wtRef.size(); i++) {
+				for (int j=0; j<wtRef[i].size(); j++) {
+					// non-existent synapses are NAN
+#if defined(WIN32) || defined(WIN64)
+					if (!_isnan(wtRef[i][j])) {
+#else
+					if (!isnan(wtRef[i][j])) {
+#endif
+						EXPECT_NEAR(wt[i][j], wtRef[i][j], 1e-4f);
+					}
+				}
+			}
+		}
+
+		delete sim;
+	}
+}
+
 TEST(CORE, saveLoadSimulation) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
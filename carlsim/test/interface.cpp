@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 #include <carlsim.h>
 #include "carlsim_tests.h"
+#include <math.h> // NAN
 
 class DummyCG: public ConnectionGenerator {
 public:
@@ -16,6 +17,33 @@ public:
 	}
 };
 
+class DummyBatchCG: public BatchConnectionGenerator {
+public:
+	DummyBatchCG() {}
+	~DummyBatchCG() {}
+
+	void connect(CARLsim* net, int srcGrp, int startI, int endI, int destGrp, std::vector<ConnectionTuple>& connections) {
+		for (int i=startI; i<endI; i++)
+			connections.push_back(ConnectionTuple(i, 0, 1.0f, 1.0f, 1.0f));
+	}
+};
+
+//! returns one invalid connection per block (which field is invalid is selected by the constructor)
+class InvalidBatchCG: public BatchConnectionGenerator {
+public:
+	InvalidBatchCG(int _i, int _j, float _weight, float _maxWt, float _delay) : i(_i), j(_j), weight(_weight),
+		maxWt(_maxWt), delay(_delay) {}
+	~InvalidBatchCG() {}
+
+	void connect(CARLsim* net, int srcGrp, int startI, int endI, int destGrp, std::vector<ConnectionTuple>& connections) {
+		connections.push_back(ConnectionTuple(startI+i, j, weight, maxWt, delay));
+	}
+
+private:
+	int i, j;
+	float weight, maxWt, delay;
+};
+
 //! trigger all UserErrors
 // TODO: add more error checking
 TEST(Interface, connectDeath) {
@@ -33,6 +61,7 @@ TEST(Interface, connectDeath) {
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.0f,0.01f,0.1f),0.1f),""); // SYN_FIXED wt.init!=wt.max
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.0f,0.01f,0.1f),-0.1f),""); // prob<0
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.0f,0.01f,0.1f),2.3f),""); // prob>1
+	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1,256)),""); // delay.max>255
 	EXPECT_DEATH(sim->connect(g1,g2,"one-to-one",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(3,0,0)),""); // rad>0
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(-1),SYN_FIXED,-1.0f,0.0f),""); // mulSynFast<0
 	EXPECT_DEATH(sim->connect(g1,g2,"random",RangeWeight(0.1f),0.1f,RangeDelay(1),RadiusRF(-1),SYN_FIXED,0.0f,-1.0f),""); // mulSynSlow<0
@@ -53,10 +82,43 @@ TEST(Interface, connectDeath) {
 	EXPECT_DEATH({sim->connect(g1,g2,CG,1.0f,1.0f,SYN_FIXED,-2,0);},""); // maxM<0
 	EXPECT_DEATH({sim->connect(g1,g2,CG,1.0f,1.0f,SYN_FIXED,0,-4);},""); // maxPreM<0
 
+	// custom BatchConnectionGenerator
+	BatchConnectionGenerator* BCGNULL = NULL;
+	DummyBatchCG* BCG = new DummyBatchCG;
+	EXPECT_DEATH({sim->connect(g1,g2,BCGNULL);},""); // BCG=NULL
+	EXPECT_DEATH({sim->connect(g1,g1,BCG);},""); // g-post cannot be PoissonGroup
+	EXPECT_DEATH({sim->connect(g1,g2,BCG,SYN_FIXED,-1,100);},""); // maxM<0
+	EXPECT_DEATH({sim->connect(g1,g2,BCG,1.0f,-1.0f,SYN_FIXED,0,0);},""); // mulSynSlow<0
+
+	delete BCG;
 	delete CG;
 	delete sim;
 }
 
+//! the connections returned by a BatchConnectionGenerator are checked when the network is set up
+TEST(Interface, connectBatchConnectionGeneratorDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	// pre index outside of the block, post index outside of the group, delay out of range, weight > maxWt
+	InvalidBatchCG* BCG[6] = {
+		new InvalidBatchCG(-1, 0, 0.1f, 0.1f, 1.0f), new InvalidBatchCG(0, 24, 0.1f, 0.1f, 1.0f),
+		new InvalidBatchCG(0, 0, 0.1f, 0.1f, 0.6f), new InvalidBatchCG(0, 0, 0.1f, 0.1f, 255.6f),
+		new InvalidBatchCG(0, 0, 0.2f, 0.1f, 1.0f), new InvalidBatchCG(0, 0, NAN, 0.1f, 1.0f)
+	};
+
+	for (int k=0; k<6; k++) {
+		CARLsim* sim = new CARLsim("Interface.connectBatchConnectionGeneratorDeath",CPU_MODE,SILENT,0,42);
+		int g1=sim->createSpikeGeneratorGroup("input", 10, EXCITATORY_NEURON);
+		int g2=sim->createGroup("excit", Grid3D(2,3,4), EXCITATORY_NEURON);
+		sim->setNeuronParameters(g2, 0.02f, 0.2f,-65.0f,8.0f);
+		sim->connect(g1, g2, BCG[k], SYN_PLASTIC);
+		sim->setConductances(false);
+		EXPECT_DEATH({sim->setupNetwork();},"");
+		delete sim;
+		delete BCG[k];
+	}
+}
+
 TEST(Interface, connectCompartmentsDeath) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 	
@@ -412,6 +474,55 @@ TEST(Interface, setConductancesDeath) {
 	delete sim;
 }
 
+TEST(Interface, setNumThreadsDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("Interface.setNumThreadsDeath",CPU_MODE,SILENT,0,42);
+	int g1=sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f,-65.0f,8.0f);
+	sim->connect(g1,g1,"random",RangeWeight(0.01),0.1f,RangeDelay(1));
+
+	EXPECT_DEATH({sim->setNumThreads(0);},"");
+	EXPECT_DEATH({sim->setNumThreads(-1);},"");
+
+	// calling setNumThreads after setupNetwork
+	sim->setNumThreads(2);
+	sim->setupNetwork();
+	EXPECT_DEATH({sim->setNumThreads(1);},"");
+	delete sim;
+}
+
+TEST(Interface, setPostOrderedSynapsesDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("Interface.setPostOrderedSynapsesDeath",CPU_MODE,SILENT,0,42);
+	int g1=sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f,-65.0f,8.0f);
+	sim->connect(g1,g1,"random",RangeWeight(0.01),0.1f,RangeDelay(1));
+
+	// calling setPostOrderedSynapses after setupNetwork
+	sim->setPostOrderedSynapses(true);
+	sim->setupNetwork();
+	EXPECT_DEATH({sim->setPostOrderedSynapses(false);},"");
+	delete sim;
+}
+
+TEST(Interface, setTraceBasedSTDPDeath) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	CARLsim* sim = new CARLsim("Interface.setTraceBasedSTDPDeath",CPU_MODE,SILENT,0,42);
+	int g1=sim->createGroup("excit", 10, EXCITATORY_NEURON);
+	sim->setNeuronParameters(g1, 0.02f, 0.2f,-65.0f,8.0f);
+	sim->connect(g1,g1,"random",RangeWeight(0.0f,0.01f,0.02f),0.1f,RangeDelay(1),RadiusRF(-1),SYN_PLASTIC);
+	sim->setESTDP(g1, true, STANDARD, ExpCurve(2e-4f,20.0f,-6.6e-5f,60.0f));
+
+	// calling setTraceBasedSTDP after setupNetwork
+	sim->setTraceBasedSTDP(true);
+	sim->setupNetwork();
+	EXPECT_DEATH({sim->setTraceBasedSTDP(false);},"");
+	delete sim;
+}
+
 TEST(Interface, setExternalCurrentDeath) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
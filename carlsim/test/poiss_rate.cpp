@@ -137,11 +137,69 @@ TEST(PoissRate, setRateNeurId) {
 	}
 }
 
-//! \NOTE: There is no good way to further test PoissonRate and in a CARLsim environment. Running the network twice
-//! will not reproduce the same spike train (because of the random seed). Comparing CPU mode to GPU mode will not work
-//! because CPU and GPU use different random seeds. Comparing lambda in PoissonRate.setRate(lambda) to the one from
-//! SpikeMonitor.getNeuronMeanFiringRate() will not work because the Poisson process has standard deviation == lambda.
+//! Poisson spike trains on the CPU are drawn from a counter-based generator keyed on (seed, neuron, time slice), so they
+//! must be reproducible and independent of the number of threads. The mean firing rate of a Poisson process with
+//! ISIs rounded down to ms and a refractory period R is 1000/(R + 1/(exp(lambda)-1)) Hz, where lambda is the rate in
+//! spikes per ms.
+//! \NOTE: Comparing CPU mode to GPU mode will not work, because GPU mode uses its own random number generator.
 TEST(PoissRate, runSim) {
-	// \TODO test CARLsim integration
-	// \TODO use cuRAND
-}
\ No newline at end of file
+	std::vector<std::vector<int> > spkST;
+	float rateHz[] = {20.0f, 100.0f};
+	int refPeriod[] = {1, 5};
+
+	int numThreads[] = {1, 3, 1};
+	for (int t=0; t<3; t++) {
+		CARLsim* sim = new CARLsim("PoissRate.runSim",CPU_MODE,SILENT,0,42);
+		sim->setNumThreads(numThreads[t]);
+		int gIn[2];
+		gIn[0] = sim->createSpikeGeneratorGroup("in20", 1000, EXCITATORY_NEURON);
+		gIn[1] = sim->createSpikeGeneratorGroup("in100", 1000, EXCITATORY_NEURON);
+		int gOut = sim->createGroup("out", 10, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->connect(gIn[0], gOut, "random", RangeWeight(0.01f), 0.1f, RangeDelay(1));
+		sim->connect(gIn[1], gOut, "random", RangeWeight(0.01f), 0.1f, RangeDelay(1));
+		sim->setConductances(true);
+		sim->setupNetwork();
+
+		PoissonRate in20(1000), in100(1000);
+		in20.setRates(rateHz[0]);
+		in100.setRates(rateHz[1]);
+		sim->setSpikeRate(gIn[0], &in20, refPeriod[0]);
+		sim->setSpikeRate(gIn[1], &in100, refPeriod[1]);
+
+		SpikeMonitor* spkMon[2];
+		for (int g=0; g<2; g++) {
+			spkMon[g] = sim->setSpikeMonitor(gIn[g], "NULL");
+			spkMon[g]->startRecording();
+		}
+		sim->runNetwork(10,0,false);
+
+		std::vector<std::vector<int> > spk;
+		for (int g=0; g<2; g++) {
+			spkMon[g]->stopRecording();
+			std::vector<std::vector<int> > spkGrp = spkMon[g]->getSpikeVector2D();
+			spk.insert(spk.end(), spkGrp.begin(), spkGrp.end());
+
+			double lambda = rateHz[g]/1000.0;
+			double expRate = 1000.0/(refPeriod[g] + 1.0/(exp(lambda)-1.0));
+			EXPECT_NEAR(spkMon[g]->getPopMeanFiringRate(), expRate, expRate*0.01);
+
+			int minISI = 10000;
+			for (int i=0; i<spkGrp.size(); i++) {
+				for (int j=1; j<spkGrp[i].size(); j++) {
+					minISI = std::min(minISI, spkGrp[i][j]-spkGrp[i][j-1]);
+				}
+			}
+			EXPECT_GE(minISI, refPeriod[g]);
+		}
+
+		if (t == 0) {
+			spkST = spk;
+		} else {
+			// same seed: bit-identical spike trains, no matter how many threads
+			EXPECT_TRUE(spk == spkST);
+		}
+
+		delete sim;
+	}
+}
@@ -6,6 +6,7 @@
 
 #if defined(WIN32) || defined(WIN64)
 #include <periodic_spikegen.h>
+#include <spikegen_from_vector.h>
 #endif
 
 // TODO: I should probably use a google tests figure for this to reduce the
@@ -145,9 +146,20 @@ TEST(SpikeMon, interfaceDeath) {
 	// set up network and test all API calls that are not valid in certain modes
 	sim.setupNetwork();
 
-	// \TODO SpikeMonitor mode COUNT not yet implemented
-	EXPECT_DEATH(spkMon->setMode(COUNT),"");
-	// after mode is implemented, make sure you cannot call getSpikeVector2D in COUNT mode, etc.
+	// test all APIs that cannot be called in COUNT mode, and vice versa
+	spkMon->setMode(COUNT);
+	EXPECT_DEATH(spkMon->getSpikeVector2D(),"");
+	EXPECT_DEATH(spkMon->getNeuronSpikeTimes(0),"");
+	spkMon->setMode(AER);
+	EXPECT_DEATH(spkMon->getAllRecentFiringRates(),"");
+	EXPECT_DEATH(spkMon->getNeuronFanoFactor(0),"");
+	EXPECT_DEATH(spkMon->getNeuronIsiCV(0),"");
+	EXPECT_DEATH(spkMon->getNumCountWindows(),"");
+	EXPECT_DEATH(spkMon->getPopFanoFactor(),"");
+	EXPECT_DEATH(spkMon->getPopIsiHistogram(),"");
+	EXPECT_DEATH(spkMon->getPopMeanIsiCV(),"");
+	EXPECT_DEATH(spkMon->setCountWindowMs(0),"");
+	EXPECT_DEATH(spkMon->setIsiHistogram(1,0),"");
 
 	// test all APIs that cannot be called when recording is on
 	spkMon->startRecording();
@@ -160,6 +172,7 @@ TEST(SpikeMon, interfaceDeath) {
 	EXPECT_DEATH(spkMon->getMinFiringRate(),"");
 	EXPECT_DEATH(spkMon->getNeuronMeanFiringRate(0),"");
 	EXPECT_DEATH(spkMon->getNeuronNumSpikes(0),"");
+	EXPECT_DEATH(spkMon->getNeuronSpikeTimes(0),"");
 	EXPECT_DEATH(spkMon->getNumNeuronsWithFiringRate(0,0),"");
 	EXPECT_DEATH(spkMon->getNumSilentNeurons(),"");
 	EXPECT_DEATH(spkMon->getPercentNeuronsWithFiringRate(0,0),"");
@@ -168,6 +181,9 @@ TEST(SpikeMon, interfaceDeath) {
 	EXPECT_DEATH(spkMon->print(),"");
 	EXPECT_DEATH(spkMon->startRecording(),"");
 	EXPECT_DEATH(spkMon->setLogFile("meow.dat"),"");
+	EXPECT_DEATH(spkMon->setMode(COUNT),"");
+	EXPECT_DEATH(spkMon->setCountWindowMs(100),"");
+	EXPECT_DEATH(spkMon->setIsiHistogram(1,100),"");
 }
 
 
@@ -378,6 +394,184 @@ TEST(SpikeMon, spikeTimes) {
 	}
 }
 
+/*!
+ * \brief COUNT mode keeps running spike statistics instead of the spikes
+ *
+ * A PeriodicSpikeGenerator makes every neuron spike exactly twice per 100 ms count window, so the ISIs are all the
+ * same, and ISI CVs and Fano factors must be zero. A Poisson group must have ISI CVs and Fano factors close to one.
+ */
+TEST(SpikeMon, countMode) {
+	const int GRP_SIZE = 200;
+	const int isi = 50; // inter-spike interval (ms)
+
+	CARLsim* sim = new CARLsim("SpikeMon.countMode",CPU_MODE,SILENT,0,42);
+	int gPer = sim->createSpikeGeneratorGroup("periodic", GRP_SIZE, EXCITATORY_NEURON);
+	int gPoiss = sim->createSpikeGeneratorGroup("poisson", GRP_SIZE, EXCITATORY_NEURON);
+	PeriodicSpikeGenerator spkGen(1000.0f/isi);
+	sim->setSpikeGenerator(gPer, &spkGen);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(20.0f);
+	sim->setSpikeRate(gPoiss, &in);
+
+	SpikeMonitor* smPer = sim->setSpikeMonitor(gPer,"NULL");
+	SpikeMonitor* smPoiss = sim->setSpikeMonitor(gPoiss,"NULL");
+	smPer->setMode(COUNT);
+	smPer->setCountWindowMs(100);
+	smPer->setIsiHistogram(10, 10);
+	smPoiss->setMode(COUNT);
+	smPoiss->setCountWindowMs(100);
+
+	// record in two periods with a pause in between, the second one starts in the middle of a second
+	smPer->setPersistentData(true);
+	smPoiss->setPersistentData(true);
+	smPer->startRecording();
+	smPoiss->startRecording();
+	sim->runNetwork(5,0,false);
+	smPer->stopRecording();
+	smPoiss->stopRecording();
+	sim->runNetwork(0,250,false);
+	smPer->startRecording();
+	smPoiss->startRecording();
+	sim->runNetwork(5,0,false);
+	smPer->stopRecording();
+	smPoiss->stopRecording();
+
+	// 10 s of recording
+	EXPECT_EQ(smPer->getNumCountWindows(), 100);
+	EXPECT_EQ(smPer->getPopNumSpikes(), 10000/isi*GRP_SIZE);
+	for (int i=0; i<GRP_SIZE; i++) {
+		EXPECT_EQ(smPer->getNeuronNumSpikes(i), 10000/isi);
+		EXPECT_FLOAT_EQ(smPer->getNeuronMeanFiringRate(i), 1000.0f/isi);
+		EXPECT_FLOAT_EQ(smPer->getNeuronIsiCV(i), 0.0f);
+		EXPECT_FLOAT_EQ(smPer->getNeuronFanoFactor(i), 0.0f);
+	}
+	EXPECT_FLOAT_EQ(smPer->getPopFanoFactor(), 0.0f);
+	std::vector<float> recentRates = smPer->getAllRecentFiringRates();
+	for (int i=0; i<GRP_SIZE; i++)
+		EXPECT_FLOAT_EQ(recentRates[i], 1000.0f/isi);
+
+	// ISIs don't span the pause between the recording periods
+	std::vector<int> isiHist = smPer->getPopIsiHistogram();
+	ASSERT_EQ(isiHist.size(), 10);
+	for (int b=0; b<10; b++)
+		EXPECT_EQ(isiHist[b], (b==isi/10) ? 2*(5000/isi-1)*GRP_SIZE : 0);
+
+	// Poisson spike trains: ISI CV and Fano factor are about 1, and neurons fire independently
+	EXPECT_NEAR(smPoiss->getPopMeanFiringRate(), 20.0f, 1.0f);
+	EXPECT_NEAR(smPoiss->getPopMeanIsiCV(), 1.0f, 0.1f);
+	float meanFano = 0.0f;
+	for (int i=0; i<GRP_SIZE; i++)
+		meanFano += smPoiss->getNeuronFanoFactor(i)/GRP_SIZE;
+	EXPECT_NEAR(meanFano, 1.0f, 0.1f);
+	EXPECT_NEAR(smPoiss->getPopFanoFactor(), 1.0f, 0.5f);
+
+	// switching modes discards the recorded data
+	smPoiss->setMode(AER);
+	EXPECT_EQ(smPoiss->getPopNumSpikes(), 0);
+
+	delete sim;
+}
+
+/*!
+ * \brief COUNT mode reports rolling rates over a sliding count window
+ *
+ * The neuron is silent for 100 ms and then fires five spikes in [100,150) ms. When recording stops at 150 ms, only
+ * the non-overlapping count window [0,100) is complete, but the recent rate must come from the window [50,150),
+ * which slides in steps of 10 ms. A 97 ms window has no such divisor and slides in steps of 1 ms.
+ */
+TEST(SpikeMon, countModeSlidingWindow) {
+	int spkTimesArr[9] = {105, 115, 125, 135, 145, 160, 170, 200, 210};
+	std::vector<int> spkTimes(&spkTimesArr[0], &spkTimesArr[0]+9);
+
+	CARLsim* sim = new CARLsim("SpikeMon.countModeSlidingWindow",CPU_MODE,SILENT,0,42);
+	int g0 = sim->createSpikeGeneratorGroup("input", 1, EXCITATORY_NEURON);
+	SpikeGeneratorFromVector spkGen(spkTimes);
+	sim->setSpikeGenerator(g0, &spkGen);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	SpikeMonitor* spkMon = sim->setSpikeMonitor(g0,"NULL");
+	spkMon->setMode(COUNT);
+	spkMon->setCountWindowMs(100);
+	spkMon->startRecording();
+	sim->runNetwork(0,150,false);
+	spkMon->stopRecording();
+	EXPECT_EQ(spkMon->getNumCountWindows(), 1);
+	EXPECT_FLOAT_EQ(spkMon->getAllRecentFiringRates()[0], 50.0f);
+
+	// record [150,300): the recent window is [203,300) and contains a single spike
+	spkMon->setCountWindowMs(97);
+	spkMon->startRecording();
+	sim->runNetwork(0,150,false);
+	spkMon->stopRecording();
+	EXPECT_EQ(spkMon->getNumCountWindows(), 1);
+	EXPECT_FLOAT_EQ(spkMon->getAllRecentFiringRates()[0], 1000.0f/97);
+
+	// the sliding window doesn't span the pause between recording periods
+	spkMon->setPersistentData(true);
+	spkMon->startRecording();
+	sim->runNetwork(0,10,false);
+	spkMon->stopRecording();
+	EXPECT_EQ(spkMon->getNumCountWindows(), 1);
+	EXPECT_FLOAT_EQ(spkMon->getAllRecentFiringRates()[0], 0.0f);
+
+	delete sim;
+}
+
+/*!
+ * \brief spike times can be accessed per neuron without copying them
+ *
+ * A PeriodicSpikeGenerator makes every neuron spike at multiples of the inter-spike interval. The views returned by
+ * getNeuronSpikeTimes must list these spike times in ascending order, agree with getSpikeVector2D and
+ * getNeuronNumSpikes, and cover all recording periods in PersistentMode.
+ */
+TEST(SpikeMon, neuronSpikeTimes) {
+	const int GRP_SIZE = 10;
+	const int isi = 50; // inter-spike interval (ms)
+
+	CARLsim* sim = new CARLsim("SpikeMon.neuronSpikeTimes",CPU_MODE,SILENT,0,42);
+	int g0 = sim->createSpikeGeneratorGroup("Input", GRP_SIZE, EXCITATORY_NEURON);
+	PeriodicSpikeGenerator spkGen(1000.0f/isi);
+	sim->setSpikeGenerator(g0, &spkGen);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	SpikeMonitor* spkMon = sim->setSpikeMonitor(g0,"NULL");
+	spkMon->setPersistentData(true);
+	for (int run=1; run<=2; run++) {
+		spkMon->startRecording();
+		sim->runNetwork(1,0,false);
+		spkMon->stopRecording();
+
+		std::vector<std::vector<int> > spkVector = spkMon->getSpikeVector2D();
+		for (int i=0; i<GRP_SIZE; i++) {
+			SpikeTimesView spkTimes = spkMon->getNeuronSpikeTimes(i);
+			EXPECT_EQ(spkTimes.size(), run*1000/isi);
+			EXPECT_EQ(spkTimes.size(), spkMon->getNeuronNumSpikes(i));
+			EXPECT_TRUE(std::vector<int>(spkTimes.begin(), spkTimes.end()) == spkVector[i]);
+			for (int j=0; j<spkTimes.size(); j++) {
+				EXPECT_EQ(spkTimes[j] % isi, 0);
+				if (j>0)
+					EXPECT_GT(spkTimes[j], spkTimes[j-1]);
+			}
+		}
+		EXPECT_EQ(spkMon->getPopNumSpikes(), run*GRP_SIZE*1000/isi);
+	}
+
+	// without PersistentMode, startRecording starts over
+	spkMon->setPersistentData(false);
+	spkMon->startRecording();
+	sim->runNetwork(0,500,false);
+	spkMon->stopRecording();
+	for (int i=0; i<GRP_SIZE; i++)
+		EXPECT_EQ(spkMon->getNeuronSpikeTimes(i).size(), 500/isi);
+
+	delete sim;
+}
+
 /*
  * This test checks for the correctness of the getGroupFiringRate method.
  * A PeriodicSpikeGenerator is used to periodically generate input spikes, so that the input spike times are known.
@@ -671,3 +865,126 @@ TEST(SpikeMon, setLogFile) {
 		delete sim;
 	}
 }
+
+/*!
+ * \brief all spike monitors are updated in a single pass over the firing tables
+ *
+ * Monitors of different groups may have been updated at different times within the current second (e.g., by calling
+ * stopRecording on only one of them). Interrupting the recording of one monitor must neither lose nor duplicate spikes
+ * in any of the monitors.
+ */
+TEST(SpikeMon, multipleMonitorsSinglePass) {
+	std::vector<std::vector<int> > spkVec[2][3];
+
+	for (int run=0; run<2; run++) {
+		CARLsim* sim = new CARLsim("SpikeMon.multipleMonitorsSinglePass",CPU_MODE,SILENT,0,42);
+		int gIn = sim->createSpikeGeneratorGroup("input", 20, EXCITATORY_NEURON);
+		int g1 = sim->createGroup("g1", 20, EXCITATORY_NEURON);
+		int g2 = sim->createGroup("g2", 20, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->setNeuronParameters(g2, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->connect(gIn, g1, "random", RangeWeight(0.2f), 0.5f);
+		sim->connect(g1, g2, "random", RangeWeight(0.2f), 0.5f, RangeDelay(1,10));
+		sim->setConductances(true);
+		sim->setupNetwork();
+
+		PoissonRate in(20);
+		in.setRates(30.0f);
+		sim->setSpikeRate(gIn, &in);
+
+		int grps[3] = {gIn, g1, g2};
+		SpikeMonitor* spkMon[3];
+		for (int i=0; i<3; i++) {
+			spkMon[i] = sim->setSpikeMonitor(grps[i], "NULL");
+			spkMon[i]->setPersistentData(true);
+			spkMon[i]->startRecording();
+		}
+
+		// in the second run, interrupt the recording of g1 within the first and the second second
+		sim->runNetwork(0,250);
+		if (run==1) {
+			spkMon[1]->stopRecording();
+			spkMon[1]->startRecording();
+		}
+		sim->runNetwork(0,650);
+		if (run==1) {
+			spkMon[1]->stopRecording();
+			spkMon[1]->startRecording();
+		}
+		sim->runNetwork(0,600);
+
+		for (int i=0; i<3; i++) {
+			spkMon[i]->stopRecording();
+			spkVec[run][i] = spkMon[i]->getSpikeVector2D();
+		}
+		EXPECT_GT(spkMon[0]->getPopNumSpikes(), 0);
+		EXPECT_GT(spkMon[1]->getPopNumSpikes(), 0);
+		delete sim;
+	}
+
+	for (int i=0; i<3; i++) {
+		ASSERT_EQ(spkVec[0][i].size(), spkVec[1][i].size());
+		for (int n=0; n<spkVec[0][i].size(); n++) {
+			EXPECT_EQ(spkVec[0][i][n], spkVec[1][i][n]);
+		}
+	}
+}
+
+/*!
+ * \brief spike files are written in large batches by a background thread
+ *
+ * Make sure that the spike file is complete after every call to runNetwork, even if the spike buffer has been handed
+ * to the I/O thread several times during the run, and that it contains the same spikes in the same order as the AER
+ * struct.
+ */
+TEST(SpikeMon, bufferedSpikeFile) {
+	const int GRP_SIZE = 2000;
+	CARLsim* sim = new CARLsim("SpikeMon.bufferedSpikeFile",CPU_MODE,SILENT,0,42);
+	int g0 = sim->createSpikeGeneratorGroup("Input", GRP_SIZE, EXCITATORY_NEURON);
+	sim->setConductances(false);
+	sim->setupNetwork();
+
+	PoissonRate in(GRP_SIZE);
+	in.setRates(40.0f);
+	sim->setSpikeRate(g0, &in);
+
+	SpikeMonitor* spkMon = sim->setSpikeMonitor(g0,"spkBuffered.dat");
+	spkMon->setPersistentData(true);
+
+	int* inputArray = NULL;
+	int64_t inputSize;
+	for (int run=0; run<2; run++) {
+		spkMon->startRecording();
+		sim->runNetwork(1,500,false);
+		spkMon->stopRecording();
+
+		// the file must be complete without deleting the network: about 120k spikes per run, which is more than
+		// fits into one spike file buffer
+		readAndReturnSpikeFile("spkBuffered.dat",inputArray,inputSize);
+		EXPECT_GT(spkMon->getPopNumSpikes(), SPIKE_FILE_BUFFER_SIZE/2 * (run+1));
+		EXPECT_EQ(inputSize/2, spkMon->getPopNumSpikes());
+		if (run==0)
+			delete[] inputArray;
+	}
+
+	// the spike times of every neuron must appear in the same order as in the AER struct
+	std::vector<std::vector<int> > spkVector = spkMon->getSpikeVector2D();
+	std::vector<std::vector<int> > spkFile(GRP_SIZE);
+	for (int i=0; i<inputSize; i+=2) {
+		if (i>0)
+			EXPECT_GE(inputArray[i], inputArray[i-2]);
+		ASSERT_GE(inputArray[i+1], 0);
+		ASSERT_LT(inputArray[i+1], GRP_SIZE);
+		spkFile[inputArray[i+1]].push_back(inputArray[i]);
+	}
+	EXPECT_TRUE(spkFile == spkVector);
+
+	delete[] inputArray;
+	delete sim;
+
+#if defined(WIN32) || defined(WIN64)
+	int ret = system("del spkBuffered.dat");
+#else
+	int ret = system("rm -rf spkBuffered.dat");
+#endif
+}
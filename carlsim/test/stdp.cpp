@@ -602,3 +602,298 @@ TEST(STDP, ISTDPPulseCurve) {
 		}
 	}
 }
+
+/*!
+ * \brief testing a pulse I-STDP curve that is too wide for its lookup table
+ * A pulse width of 1e9 ms would need a lookup table of 4 GB. The table must be cut off after STDP_LUT_MAX_LEN ms
+ * instead. Since the pulse is still much wider than the 100 ms between spike pairs, every spike pair also gives LTD
+ * with the spikes of the neighboring pair, which outweighs LTP and drives the weight to its minimum.
+ */
+TEST(STDP, ISTDPPulseCurveCutOff) {
+	float maxInhWeight = 10.0f;
+	float initWeight = 5.0f;
+	float minInhWeight = 0.0f;
+
+	for (int offset = -15; offset <= 15; offset += 10) {
+		CARLsim* sim = new CARLsim("STDP.ISTDPPulseCurveCutOff", CPU_MODE, SILENT, 0, 42);
+		sim->setIntegrationMethod(FORWARD_EULER, 1);
+
+		int g1 = sim->createGroup("excit", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(g1, 0.02f, 0.2f, -65.0f, 8.0f);
+		int gex = sim->createSpikeGeneratorGroup("input-ex", 1, EXCITATORY_NEURON);
+		int gin = sim->createSpikeGeneratorGroup("input-in", 1, INHIBITORY_NEURON);
+		PrePostGroupSpikeGenerator* proPostSpikeGen = new PrePostGroupSpikeGenerator(100, offset, gin, gex);
+
+		sim->connect(gex, g1, "one-to-one", RangeWeight(40.0f), 1.0f, RangeDelay(1), RadiusRF(-1), SYN_FIXED);
+		sim->connect(gin, g1, "one-to-one", RangeWeight(minInhWeight, initWeight, maxInhWeight), 1.0f, RangeDelay(1),
+			RadiusRF(-1), SYN_PLASTIC);
+		sim->setConductances(false);
+		sim->setISTDP(g1, true, STANDARD, PulseCurve(0.10f, -0.14f, 9.0f, 1e9f));
+		sim->setSpikeGenerator(gex, proPostSpikeGen);
+		sim->setSpikeGenerator(gin, proPostSpikeGen);
+		sim->setupNetwork();
+
+		ConnectionMonitor* CM = sim->setConnectionMonitor(gin, g1, "NULL");
+		sim->runNetwork(20, 0, false);
+
+		std::vector< std::vector<float> > weights = CM->takeSnapshot();
+		EXPECT_NEAR(minInhWeight, weights[0][0], 0.5f);
+
+		delete proPostSpikeGen;
+		delete sim;
+	}
+}
+
+/*!
+ * \brief testing trace-based STDP
+ * This function tests whether computing the STDP curves from decaying spike traces (setTraceBasedSTDP) yields the same
+ * weight changes as evaluating the exponentials for every spike pair. Synaptic delays vary between 1 and 10 ms, so
+ * that the pre-synaptic trace history is exercised. All weights are updated once after 1 s, so the spikes until then
+ * must be identical, and the weights must agree up to floating-point rounding.
+ */
+TEST(STDP, setTraceBasedSTDP) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	std::vector<std::vector<int> > spkRef;
+	std::vector<std::vector<float> > wtRef[4];
+
+	for (int withTraces=0; withTraces<2; withTraces++) {
+		CARLsim* sim = new CARLsim("STDP.setTraceBasedSTDP", CPU_MODE, SILENT, 0, 42);
+		sim->setTraceBasedSTDP(withTraces==1);
+
+		int gIn = sim->createSpikeGeneratorGroup("input", 100, EXCITATORY_NEURON);
+		int gExc1 = sim->createGroup("exc1", 100, EXCITATORY_NEURON);
+		int gExc2 = sim->createGroup("exc2", 100, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gExc1, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+		sim->setNeuronParameters(gExc2, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+		int gInh = sim->createGroup("inh", 50, INHIBITORY_NEURON);
+		sim->setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f); // FS
+
+		int c[4];
+		c[0] = sim->connect(gIn, gExc1, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.2f, RangeDelay(1,10),
+			RadiusRF(-1), SYN_PLASTIC);
+		c[1] = sim->connect(gIn, gExc2, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.2f, RangeDelay(1,10),
+			RadiusRF(-1), SYN_PLASTIC);
+		sim->connect(gExc1, gInh, "random", RangeWeight(0.05f), 0.1f, RangeDelay(1));
+		c[2] = sim->connect(gInh, gExc1, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.1f, RangeDelay(1,5),
+			RadiusRF(-1), SYN_PLASTIC);
+		c[3] = sim->connect(gInh, gExc2, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.1f, RangeDelay(1,5),
+			RadiusRF(-1), SYN_PLASTIC);
+
+		sim->setConductances(true);
+		sim->setESTDP(gExc1, true, STANDARD, ExpCurve(2e-4f, 20.0f, -6.6e-5f, 60.0f));
+		sim->setISTDP(gExc1, true, STANDARD, ExpCurve(-1e-4f, 15.0f, 1e-4f, 30.0f));
+		sim->setESTDP(gExc2, true, STANDARD, TimingBasedCurve(2e-4f, 20.0f, -6.6e-5f, 20.0f, 15.0f));
+		sim->setISTDP(gExc2, true, STANDARD, PulseCurve(1e-4f, -1e-4f, 10.0f, 20.0f));
+		sim->setupNetwork();
+
+		SpikeMonitor* spkMon = sim->setSpikeMonitor(gExc1, "NULL");
+		ConnectionMonitor* connMon[4];
+		connMon[0] = sim->setConnectionMonitor(gIn, gExc1, "NULL");
+		connMon[1] = sim->setConnectionMonitor(gIn, gExc2, "NULL");
+		connMon[2] = sim->setConnectionMonitor(gInh, gExc1, "NULL");
+		connMon[3] = sim->setConnectionMonitor(gInh, gExc2, "NULL");
+
+		PoissonRate in(100);
+		in.setRates(30.0f);
+		sim->setSpikeRate(gIn, &in);
+
+		spkMon->startRecording();
+		sim->runNetwork(1,0,false);
+		spkMon->stopRecording();
+
+		if (!withTraces) {
+			spkRef = spkMon->getSpikeVector2D();
+			EXPECT_GT(spkMon->getPopNumSpikes(), 0);
+			for (int k=0; k<4; k++) {
+				EXPECT_GT(connMon[k]->getTotalAbsWeightChange(), 0.0);
+				wtRef[k] = connMon[k]->takeSnapshot();
+			}
+		} else {
+			EXPECT_TRUE(spkMon->getSpikeVector2D() == spkRef);
+			for (int k=0; k<4; k++) {
+				std::vector<std::vector<float> > wt = connMon[k]->takeSnapshot();
+				for (int i=0; i<wtRef[k].size(); i++) {
+					for (int j=0; j<wtRef[k][i].size(); j++) {
+						// non-existent synapses are NAN
+#if defined(WIN32) || defined(WIN64)
+						if (_isnan(wtRef[k][i][j])) {
+							EXPECT_TRUE(_isnan(wt[i][j]));
+#else
+						if (isnan(wtRef[k][i][j])) {
+							EXPECT_TRUE(isnan(wt[i][j]));
+#endif
+						} else {
+							EXPECT_NEAR(wt[i][j], wtRef[k][i][j], 1e-6f);
+						}
+					}
+				}
+			}
+		}
+
+		delete sim;
+	}
+}
+
+/*!
+ * \brief testing that E-STDP and I-STDP each update their own synapses once
+ * A group receives plastic excitatory and inhibitory input. It is run once with E-STDP only, once with I-STDP only,
+ * and once with both. All weights are updated once after 1 s, so the spikes until then are identical. With both
+ * enabled, excitatory weights must match the E-STDP run and inhibitory weights must match the I-STDP run.
+ */
+TEST(STDP, ESTDPandISTDPappliedOnce) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	std::vector<std::vector<float> > wtExcRef, wtInbRef;
+
+	for (int stdpMode=0; stdpMode<3; stdpMode++) {
+		bool hasESTDP = stdpMode != 1;
+		bool hasISTDP = stdpMode != 0;
+
+		CARLsim* sim = new CARLsim("STDP.ESTDPandISTDPappliedOnce", CPU_MODE, SILENT, 0, 42);
+		int gExcIn = sim->createSpikeGeneratorGroup("inputExc", 50, EXCITATORY_NEURON);
+		int gInbIn = sim->createSpikeGeneratorGroup("inputInb", 20, INHIBITORY_NEURON);
+		int gOut = sim->createGroup("output", 50, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+
+		sim->connect(gExcIn, gOut, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.3f, RangeDelay(1,5), RadiusRF(-1),
+			SYN_PLASTIC);
+		sim->connect(gInbIn, gOut, "random", RangeWeight(0.0f, 0.05f, 0.2f), 0.3f, RangeDelay(1,5), RadiusRF(-1),
+			SYN_PLASTIC);
+
+		sim->setConductances(true);
+		if (hasESTDP)
+			sim->setESTDP(gOut, true, STANDARD, ExpCurve(2e-4f, 20.0f, -6.6e-5f, 60.0f));
+		if (hasISTDP)
+			sim->setISTDP(gOut, true, STANDARD, ExpCurve(-1e-4f, 15.0f, 1e-4f, 30.0f));
+		sim->setupNetwork();
+
+		ConnectionMonitor* connMonExc = sim->setConnectionMonitor(gExcIn, gOut, "NULL");
+		ConnectionMonitor* connMonInb = sim->setConnectionMonitor(gInbIn, gOut, "NULL");
+
+		PoissonRate inExc(50), inInb(20);
+		inExc.setRates(30.0f);
+		inInb.setRates(20.0f);
+		sim->setSpikeRate(gExcIn, &inExc);
+		sim->setSpikeRate(gInbIn, &inInb);
+
+		sim->runNetwork(1,0,false);
+
+		std::vector<std::vector<float> > wtExc = connMonExc->takeSnapshot();
+		std::vector<std::vector<float> > wtInb = connMonInb->takeSnapshot();
+		if (stdpMode == 0) {
+			EXPECT_GT(connMonExc->getTotalAbsWeightChange(), 0.0);
+			wtExcRef = wtExc;
+		} else if (stdpMode == 1) {
+			EXPECT_GT(connMonInb->getTotalAbsWeightChange(), 0.0);
+			wtInbRef = wtInb;
+		} else {
+			for (int i=0; i<wtExcRef.size(); i++) {
+				for (int j=0; j<wtExcRef[i].size(); j++) {
+					// non-existent synapses are NAN
+#if defined(WIN32) || defined(WIN64)
+					if (!_isnan(wtExcRef[i][j])) {
+#else
+					if (!isnan(wtExcRef[i][j])) {
+#endif
+						EXPECT_FLOAT_EQ(wtExc[i][j], wtExcRef[i][j]);
+					}
+				}
+			}
+			for (int i=0; i<wtInbRef.size(); i++) {
+				for (int j=0; j<wtInbRef[i].size(); j++) {
+#if defined(WIN32) || defined(WIN64)
+					if (!_isnan(wtInbRef[i][j])) {
+#else
+					if (!isnan(wtInbRef[i][j])) {
+#endif
+						EXPECT_FLOAT_EQ(wtInb[i][j], wtInbRef[i][j]);
+					}
+				}
+			}
+		}
+
+		delete sim;
+	}
+}
+
+/*!
+ * \brief testing that updateWeights may skip neurons without new STDP contributions
+ * Neurons in groups with STANDARD STDP and without homeostasis are only visited by the weight update if STDP touched
+ * them, their decaying weight changes are applied later. DA_MOD groups are visited in every update, and with the
+ * dopamine level at its base value of 1 they follow the same weight update rule. Both are run with an input that
+ * pauses for a while, so that neurons are skipped, and must end up with the same spikes and weights.
+ */
+TEST(STDP, skipUntouchedNeurons) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	for (int hasDecay=0; hasDecay<=1; hasDecay++) {
+		std::vector<std::vector<float> > wtRef;
+		int numSpkRef = 0;
+
+		for (int isDAMod=0; isDAMod<=1; isDAMod++) {
+			CARLsim* sim = new CARLsim("STDP.skipUntouchedNeurons", CPU_MODE, SILENT, 0, 42);
+			int gIn = sim->createSpikeGeneratorGroup("input", 100, EXCITATORY_NEURON);
+			int gDrive = sim->createSpikeGeneratorGroup("drive", 50, EXCITATORY_NEURON);
+			int gOut = sim->createGroup("output", 50, EXCITATORY_NEURON);
+			sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f); // RS
+
+			// the plastic synapses do not drive the output (mulSynFast=mulSynSlow=0), so that rounding differences in
+			// the weights cannot change the spikes
+			sim->connect(gIn, gOut, "random", RangeWeight(0.0f, 0.1f, 0.2f), 0.3f, RangeDelay(1,10), RadiusRF(-1),
+				SYN_PLASTIC, 0.0f, 0.0f);
+			sim->connect(gDrive, gOut, "one-to-one", RangeWeight(1.0f), 1.0f, RangeDelay(1));
+			sim->setConductances(true);
+			sim->setESTDP(gOut, true, isDAMod ? DA_MOD : STANDARD, ExpCurve(2e-3f, 20.0f, -6.6e-4f, 60.0f));
+			sim->setWeightAndWeightChangeUpdate(INTERVAL_10MS, hasDecay==1, 0.9f);
+			sim->setupNetwork();
+
+			SpikeMonitor* spkMon = sim->setSpikeMonitor(gOut, "NULL");
+			ConnectionMonitor* connMon = sim->setConnectionMonitor(gIn, gOut, "NULL");
+
+			PoissonRate in(100), off(100), drive(50), driveOff(50);
+			in.setRates(30.0f);
+			off.setRates(0.0f);
+			drive.setRates(20.0f);
+			driveOff.setRates(0.0f);
+
+			// pause all input in between, and stop the run in the middle of the pause
+			spkMon->startRecording();
+			sim->setSpikeRate(gIn, &in);
+			sim->setSpikeRate(gDrive, &drive);
+			sim->runNetwork(0,500,false);
+			sim->setSpikeRate(gIn, &off);
+			sim->setSpikeRate(gDrive, &driveOff);
+			sim->runNetwork(0,300,false);
+			sim->runNetwork(0,300,false);
+			sim->setSpikeRate(gIn, &in);
+			sim->setSpikeRate(gDrive, &drive);
+			sim->runNetwork(0,500,false);
+			spkMon->stopRecording();
+
+			std::vector<std::vector<float> > wt = connMon->takeSnapshot();
+			if (!isDAMod) {
+				numSpkRef = spkMon->getPopNumSpikes();
+				EXPECT_GT(numSpkRef, 0);
+				EXPECT_GT(connMon->getTotalAbsWeightChange(), 0.0);
+				wtRef = wt;
+			} else {
+				EXPECT_EQ(spkMon->getPopNumSpikes(), numSpkRef);
+				for (int i=0; i<wtRef.size(); i++) {
+					for (int j=0; j<wtRef[i].size(); j++) {
+						// non-existent synapses are NAN
+#if defined(WIN32) || defined(WIN64)
+						if (!_isnan(wtRef[i][j])) {
+#else
+						if (!isnan(wtRef[i][j])) {
+#endif
+							EXPECT_NEAR(wt[i][j], wtRef[i][j], 1e-6f);
+						}
+					}
+				}
+			}
+
+			delete sim;
+		}
+	}
+}
@@ -150,6 +150,68 @@ TEST(STP, firingRateSTDvsSTF) {
 	}
 }
 
+/*!
+ * \brief testing the exact STP modulation of the synaptic conductance
+ *
+ * A SpikeGeneratorFromVector with irregular inter-spike intervals is connected to a single post-neuron in COBA mode.
+ * The jump in AMPA conductance caused by every pre-spike is compared to the Tsodyks-Markram model integrated one
+ * millisecond at a time. This makes sure that STP variables are correctly recovered between two spikes of a neuron,
+ * no matter how far apart they are.
+ */
+TEST(STP, conductanceJumpExact) {
+	::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+	int spkTimesArr[] = {5, 12, 14, 40, 41, 42, 100, 300, 302, 310, 600, 990};
+	std::vector<int> spkTimes(spkTimesArr, spkTimesArr+sizeof(spkTimesArr)/sizeof(int));
+	float wt = 0.05f;
+	float dAMPA = 1.0f-1.0f/5.0f;
+
+	for (int isSTF=0; isSTF<=1; isSTF++) {
+		float STP_U     = isSTF ? 0.15f : 0.45f;
+		float STP_tau_u = isSTF ? 750.0f : 50.0f;
+		float STP_tau_x = isSTF ? 50.0f : 750.0f;
+
+		CARLsim* sim = new CARLsim("STP.conductanceJumpExact",CPU_MODE,SILENT,0,42);
+		int gIn = sim->createSpikeGeneratorGroup("input", 1, EXCITATORY_NEURON);
+		int gOut = sim->createGroup("output", 1, EXCITATORY_NEURON);
+		sim->setNeuronParameters(gOut, 0.02f, 0.2f, -65.0f, 8.0f);
+		sim->connect(gIn, gOut, "full", RangeWeight(wt), 1.0f, RangeDelay(1));
+		sim->setConductances(true, 5, 0, 150, 6, 0, 150);
+		sim->setSTP(gIn, true, STP_U, STP_tau_u, STP_tau_x);
+
+		SpikeGeneratorFromVector spkGen(spkTimes);
+		sim->setSpikeGenerator(gIn, &spkGen);
+		sim->setupNetwork();
+
+		// reference STP variables, integrated every ms
+		float u = 0.0f, x = 1.0f;
+		float gPrev = 0.0f;
+		int numJumps = 0;
+		for (int t=0; t<1000; t++) {
+			sim->runNetwork(0,1,false);
+			float g = sim->getConductanceAMPA(gOut)[0];
+			float jump = g - gPrev*dAMPA;
+			gPrev = g;
+
+			if (jump > 1e-6f) {
+				// a pre-spike arrived: u^+ is used together with x^-
+				float uPlus = u*(1.0f-1.0f/STP_tau_u) + STP_U*(1.0f-u);
+				float xMinus = x;
+				x = x + (1.0f-x)/STP_tau_x - uPlus*x;
+				u = uPlus;
+				EXPECT_NEAR(jump, wt*uPlus*xMinus/STP_U, 1e-4f*wt);
+				numJumps++;
+			} else {
+				u *= 1.0f-1.0f/STP_tau_u;
+				x += (1.0f-x)/STP_tau_x;
+			}
+		}
+		EXPECT_EQ(numJumps, spkTimes.size());
+
+		delete sim;
+	}
+}
+
 TEST(STP, spikeTimesCPUvsGPU) {
 	::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
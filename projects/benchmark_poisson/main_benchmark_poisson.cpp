@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Benchmark for the Poisson spike generators in CPU_MODE: runs large groups of Poisson neurons once at a given mean
+// firing rate and once silent. The difference in wall-clock time is attributed to drawing and delivering the Poisson
+// spikes, and reported as the number of generated spikes per second.
+
+// include CARLsim user interface
+#include <carlsim.h>
+
+#if defined(WIN32) || defined(WIN64)
+#include <stopwatch.h>
+#endif
+
+#include <stdio.h>
+
+
+// runs the network for runTimeSec seconds, returns the wall-clock time in ms
+uint64_t runNetwork(float rateHz, int numThreads, int runTimeSec, int* numSpikes) {
+	int numGrp = 4;
+	int numNeurPerGrp = 25000;
+
+	CARLsim sim("benchmark_poisson", CPU_MODE, SILENT, 0, 42);
+	sim.setNumThreads(numThreads);
+
+	// the Poisson groups are not connected, so that the run time is dominated by the spike generation
+	int gIn[numGrp];
+	for (int g=0; g<numGrp; g++) {
+		gIn[g] = sim.createSpikeGeneratorGroup("input", numNeurPerGrp, EXCITATORY_NEURON);
+		sim.setSpikeCounter(gIn[g]);
+	}
+	int gExc = sim.createGroup("exc", 10, EXCITATORY_NEURON);
+	sim.setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f);
+	sim.connect(gExc, gExc, "random", RangeWeight(0.01f), 0.1f, RangeDelay(1));
+	sim.setConductances(true);
+
+	sim.setupNetwork();
+
+	PoissonRate in(numNeurPerGrp);
+	in.setRates(rateHz);
+	for (int g=0; g<numGrp; g++) {
+		sim.setSpikeRate(gIn[g], &in);
+	}
+
+	Stopwatch watch;
+	sim.runNetwork(runTimeSec, 0, false);
+	uint64_t wallTimeMs = watch.stop(false);
+
+	*numSpikes = 0;
+	for (int g=0; g<numGrp; g++) {
+		int* spkCnt = sim.getSpikeCounter(gIn[g]);
+		for (int i=0; i<numNeurPerGrp; i++) {
+			*numSpikes += spkCnt[i];
+		}
+	}
+	return wallTimeMs;
+}
+
+// returns the number of Poisson spikes generated per second (wall-clock)
+double runBenchmark(float rateHz, int numThreads, int runTimeSec) {
+	int numSpikes = 0;
+	uint64_t timeSilentMs = runNetwork(0.0f, numThreads, runTimeSec, &numSpikes);
+	uint64_t timeRateMs = runNetwork(rateHz, numThreads, runTimeSec, &numSpikes);
+
+	double genTimeMs = timeRateMs > timeSilentMs ? timeRateMs - timeSilentMs : 1;
+	double spikesPerSec = numSpikes / genTimeMs * 1000.0;
+	printf("%6.1f Hz %2d thread(s): %9d spikes, %6llu ms vs. %6llu ms = %8.2f M spikes/s\n",
+		rateHz, numThreads, numSpikes, (unsigned long long)timeRateMs, (unsigned long long)timeSilentMs,
+		spikesPerSec / 1e6);
+
+	return spikesPerSec;
+}
+
+int main() {
+	int runTimeSec = 5;
+	int numThreads[] = {1, 4};
+	float rateHz[] = {10.0f, 100.0f};
+
+	for (int k=0; k<2; k++) {
+		for (int r=0; r<2; r++) {
+			runBenchmark(rateHz[r], numThreads[k], runTimeSec);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2016 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Benchmark for spike delivery in CPU_MODE: runs the same randomly connected network with the default synapse
+// layout and with the post-ordered synapse layout (CARLsim::setPostOrderedSynapses), and reports the number of
+// delivered synaptic events per second of wall-clock time.
+
+// include CARLsim user interface
+#include <carlsim.h>
+
+#if defined(WIN32) || defined(WIN64)
+#include <stopwatch.h>
+#endif
+
+#include <stdio.h>
+
+
+// runs the network for runTimeSec seconds, returns the number of synaptic events per second (wall-clock)
+double runBenchmark(bool postOrdered, int numThreads, int runTimeSec) {
+	int numExc = 8000;
+	int numInh = 2000;
+	int numIn = 1000;
+	float pConn = 0.02f;
+
+	CARLsim sim("benchmark_spike_delivery", CPU_MODE, SILENT, 0, 42);
+	sim.setPostOrderedSynapses(postOrdered);
+	sim.setNumThreads(numThreads);
+
+	int gIn = sim.createSpikeGeneratorGroup("input", numIn, EXCITATORY_NEURON);
+	int gExc = sim.createGroup("exc", numExc, EXCITATORY_NEURON);
+	sim.setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f);
+	int gInh = sim.createGroup("inh", numInh, INHIBITORY_NEURON);
+	sim.setNeuronParameters(gInh, 0.1f, 0.2f, -65.0f, 2.0f);
+
+	// use a range of delays, so that spikes are delivered over several time steps
+	short int cInExc = sim.connect(gIn, gExc, "random", RangeWeight(0.03f), pConn, RangeDelay(1,10));
+	short int cExcExc = sim.connect(gExc, gExc, "random", RangeWeight(0.0f, 0.002f, 0.004f), pConn, RangeDelay(1,20),
+		RadiusRF(-1), SYN_PLASTIC);
+	short int cExcInh = sim.connect(gExc, gInh, "random", RangeWeight(0.004f), pConn, RangeDelay(1,10));
+	short int cInhExc = sim.connect(gInh, gExc, "random", RangeWeight(0.01f), pConn, RangeDelay(1));
+	sim.setConductances(true);
+	sim.setESTDP(gExc, true, STANDARD, ExpCurve(2e-4f,20.0f, -6.6e-5f,60.0f));
+
+	sim.setupNetwork();
+
+	SpikeMonitor* smIn = sim.setSpikeMonitor(gIn, "NULL");
+	SpikeMonitor* smExc = sim.setSpikeMonitor(gExc, "NULL");
+	SpikeMonitor* smInh = sim.setSpikeMonitor(gInh, "NULL");
+
+	PoissonRate in(numIn);
+	in.setRates(10.0f);
+	sim.setSpikeRate(gIn, &in);
+
+	// warm-up
+	sim.runNetwork(1, 0, false);
+
+	smIn->startRecording();
+	smExc->startRecording();
+	smInh->startRecording();
+	Stopwatch watch;
+	sim.runNetwork(runTimeSec, 0, false);
+	uint64_t wallTimeMs = watch.stop(false);
+	smIn->stopRecording();
+	smExc->stopRecording();
+	smInh->stopRecording();
+
+	// every spike is delivered to all outgoing synapses of the neuron: use the average fan-out per group
+	double fanOutIn = 1.0 * sim.getNumSynapticConnections(cInExc) / numIn;
+	double fanOutExc = 1.0 * (sim.getNumSynapticConnections(cExcExc) + sim.getNumSynapticConnections(cExcInh)) / numExc;
+	double fanOutInh = 1.0 * sim.getNumSynapticConnections(cInhExc) / numInh;
+	double numEvents = smIn->getPopNumSpikes() * fanOutIn + smExc->getPopNumSpikes() * fanOutExc
+		+ smInh->getPopNumSpikes() * fanOutInh;
+
+	double eventsPerSec = numEvents / (wallTimeMs > 0 ? wallTimeMs : 1) * 1000.0;
+	printf("%-14s %2d thread(s): %10.0f synaptic events in %6llu ms = %8.2f M events/s\n",
+		postOrdered ? "post-ordered" : "pre-ordered", numThreads, numEvents, (unsigned long long)wallTimeMs,
+		eventsPerSec / 1e6);
+
+	return eventsPerSec;
+}
+
+int main() {
+	int runTimeSec = 5;
+	int numThreads = 1;
+
+	double eventsPre = runBenchmark(false, numThreads, runTimeSec);
+	double eventsPost = runBenchmark(true, numThreads, runTimeSec);
+	printf("speedup of post-ordered synapse layout: %.2fx\n", eventsPost / eventsPre);
+
+	return 0;
+}
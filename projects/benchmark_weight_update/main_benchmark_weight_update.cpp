@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016 Regents of the University of California. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. The names of its contributors may not be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Benchmark for the weight update in CPU_MODE: runs a densely connected network with plastic synapses once with
+// weight updates every 10 ms and once every 1000 ms. The difference in wall-clock time is attributed to the extra
+// weight updates, and reported as the number of synapses updated per second, with and without homeostasis.
+
+// include CARLsim user interface
+#include <carlsim.h>
+
+#if defined(WIN32) || defined(WIN64)
+#include <stopwatch.h>
+#endif
+
+#include <stdio.h>
+
+
+// runs the network for runTimeSec seconds, returns the wall-clock time in ms
+uint64_t runNetwork(updateInterval_t interval, bool withHomeostasis, int numThreads, int runTimeSec,
+		int* numPlasticSyn) {
+	int numIn = 2000;
+	int numExc = 2000;
+	float pConn = 0.5f;
+
+	CARLsim sim("benchmark_weight_update", CPU_MODE, SILENT, 0, 42);
+	sim.setNumThreads(numThreads);
+
+	int gIn = sim.createSpikeGeneratorGroup("input", numIn, EXCITATORY_NEURON);
+	int gInb = sim.createSpikeGeneratorGroup("inputInb", numIn/4, INHIBITORY_NEURON);
+	int gExc = sim.createGroup("exc", numExc, EXCITATORY_NEURON);
+	sim.setNeuronParameters(gExc, 0.02f, 0.2f, -65.0f, 8.0f);
+
+	// keep the firing rates low, so that the run time is dominated by the weight update
+	short int cExc = sim.connect(gIn, gExc, "random", RangeWeight(0.0f, 0.001f, 0.002f), pConn, RangeDelay(1,10),
+		RadiusRF(-1), SYN_PLASTIC);
+	short int cInb = sim.connect(gInb, gExc, "random", RangeWeight(0.0f, 0.001f, 0.002f), pConn, RangeDelay(1,5),
+		RadiusRF(-1), SYN_PLASTIC);
+	sim.setConductances(true);
+	sim.setESTDP(gExc, true, STANDARD, ExpCurve(2e-4f,20.0f, -6.6e-5f,60.0f));
+	sim.setISTDP(gExc, true, STANDARD, ExpCurve(-1e-4f,15.0f, 1e-4f,30.0f));
+	if (withHomeostasis) {
+		sim.setHomeostasis(gExc, true, 1.0f, 10.0f);
+		sim.setHomeoBaseFiringRate(gExc, 5.0f, 0.0f);
+	}
+	sim.setWeightAndWeightChangeUpdate(interval, true, 0.9f);
+
+	sim.setupNetwork();
+
+	PoissonRate in(numIn), inInb(numIn/4);
+	in.setRates(2.0f);
+	inInb.setRates(2.0f);
+	sim.setSpikeRate(gIn, &in);
+	sim.setSpikeRate(gInb, &inInb);
+
+	Stopwatch watch;
+	sim.runNetwork(runTimeSec, 0, false);
+	uint64_t wallTimeMs = watch.stop(false);
+
+	*numPlasticSyn = sim.getNumSynapticConnections(cExc) + sim.getNumSynapticConnections(cInb);
+	return wallTimeMs;
+}
+
+// returns the number of synapse updates per second (wall-clock)
+double runBenchmark(bool withHomeostasis, int numThreads, int runTimeSec) {
+	int numSyn = 0;
+	uint64_t timeSparseMs = runNetwork(INTERVAL_1000MS, withHomeostasis, numThreads, runTimeSec, &numSyn);
+	uint64_t timeDenseMs = runNetwork(INTERVAL_10MS, withHomeostasis, numThreads, runTimeSec, &numSyn);
+
+	// number of additional weight updates when updating every 10 ms instead of every 1000 ms
+	double numUpdates = (runTimeSec*100.0 - runTimeSec) * numSyn;
+	double updateTimeMs = timeDenseMs > timeSparseMs ? timeDenseMs - timeSparseMs : 1;
+	double updatesPerSec = numUpdates / updateTimeMs * 1000.0;
+	printf("%-18s %2d thread(s): %8d synapses, %6llu ms vs. %6llu ms = %8.2f M synapse updates/s\n",
+		withHomeostasis ? "with homeostasis" : "STDP only", numThreads, numSyn,
+		(unsigned long long)timeDenseMs, (unsigned long long)timeSparseMs, updatesPerSec / 1e6);
+
+	return updatesPerSec;
+}
+
+int main() {
+	int runTimeSec = 5;
+	int numThreads[] = {1, 4};
+
+	for (int k=0; k<2; k++) {
+		runBenchmark(false, numThreads[k], runTimeSec);
+		runBenchmark(true, numThreads[k], runTimeSec);
+	}
+
+	return 0;
+}
@@ -13,6 +13,11 @@ classdef ConnectionReader < handle
     % >> hist(allWeights(end,:))
     % >> % etc.
     %
+    % Connect files of version 0.4 and up only store the synapses that
+    % exist. Their snapshots can also be delta-encoded and quantized (see
+    % ConnectionMonitor::setSnapshotEncoding). readWeights always returns
+    % the full weight matrix, with NaN for synapses that do not exist.
+    %
     % Version 5/21/2015
     % Author: Michael Beyeler <mbeyeler@uci.edu>
     
@@ -32,6 +37,14 @@ classdef ConnectionReader < handle
         fileVersionMinor;      % required minimum minor version number
         fileSizeByteHeader;    % byte size of header section
         fileSizeByteSnapshot;  % byte size of a single snapshot
+        fileVersion;           % version number of the connect file
+
+        isSparse;              % whether the file only stores existing synapses
+        synLinIdx;             % linear index of every stored synapse into a weight matrix row
+        snapshotOffsets;       % byte offset of every snapshot (sparse files)
+        snapshotFlags;         % encoding flags of every snapshot (sparse files)
+        lastFrame;             % last decoded snapshot (sparse files)
+        lastFrameWeights;      % weights of the stored synapses in lastFrame
 
         weights;
         timeStamps;
@@ -163,6 +176,15 @@ classdef ConnectionReader < handle
             for i=1:numel(snapShots)
                 frame = snapShots(i);
 
+                if obj.isSparse
+                    % snapshots have different sizes and might depend on
+                    % earlier ones
+                    [timeStamp, wts] = obj.readSparseSnapshot(frame);
+                    obj.timeStamps = [obj.timeStamps timeStamp];
+                    obj.weights(end+1,:) = wts;
+                    continue
+                end
+
                 % rewind file pointer, skip header
                 fseek(obj.fileId, obj.fileSizeByteHeader, 'bof');
                 
@@ -200,6 +222,13 @@ classdef ConnectionReader < handle
             obj.fileVersionMinor = 3;
             obj.fileSizeByteHeader = -1;   % to be set in openFile
             obj.fileSizeByteSnapshot = -1; % to be set in openFile
+            obj.fileVersion = -1;          % to be set in openFile
+            obj.isSparse = false;
+            obj.synLinIdx = [];
+            obj.snapshotOffsets = [];
+            obj.snapshotFlags = [];
+            obj.lastFrame = -1;
+            obj.lastFrameWeights = [];
             
             obj.timeStamps = [];  % to be set in readWeights
             obj.weights = [];     % to be set in readWeights
@@ -269,6 +298,7 @@ classdef ConnectionReader < handle
                     num2str(version) ' found)'])
                 return
             end
+            obj.fileVersion = version;
             
             % read connection ID
             obj.connId = fread(obj.fileId, 1, 'int16');
@@ -323,10 +353,34 @@ classdef ConnectionReader < handle
                         num2str(obj.maxWt) ')'])
             end
             
+            % starting with version 0.4, the header lists the synapses that
+            % exist in CSR format: nNeurPre+1 row offsets, then the post
+            % neuron ID of every synapse
+            obj.isSparse = floor(obj.fileVersion*10.01) >= 4;
+            if obj.isSparse
+                preStart = fread(obj.fileId, obj.nNeurPre+1, 'int32');
+                postId = fread(obj.fileId, preStart(end), 'int32');
+                if feof(obj.fileId) || numel(postId)~=preStart(end)
+                    obj.throwError('Could not read synapse list.')
+                    return
+                end
+                preId = zeros(preStart(end),1);
+                for i=1:obj.nNeurPre
+                    preId(preStart(i)+1:preStart(i+1)) = i-1;
+                end
+                obj.synLinIdx = preId*obj.nNeurPost + postId + 1;
+            end
+            
             % store the size of the header section, so that we can skip it
             % when re-reading spikes
             obj.fileSizeByteHeader = ftell(obj.fileId);
             
+            if obj.isSparse
+                % snapshots have different sizes, find them all
+                obj.indexSparseSnapshots();
+                return
+            end
+            
             % find size of each snapshot: #weights * sizeof(float32) +
             % sizeof(long int)
             obj.fileSizeByteSnapshot = obj.nNeurPre*obj.nNeurPost*4+8;
@@ -340,6 +394,110 @@ classdef ConnectionReader < handle
                 / obj.fileSizeByteSnapshot );
         end
         
+        function indexSparseSnapshots(obj)
+            % CR.indexSparseSnapshots() finds the byte offset and encoding
+            % flags of every snapshot in a sparse connect file. A snapshot
+            % consists of timestamp (int64), flags (int32), quantization
+            % step (float32, only if quantized), number of changed synapses
+            % and their indices (int32, only if delta-encoded), and the
+            % weights (float32, or uint16 if quantized).
+            fseek(obj.fileId, 0, 'eof');
+            szByteTot = ftell(obj.fileId);
+            fseek(obj.fileId, obj.fileSizeByteHeader, 'bof');
+            
+            nSyn = numel(obj.synLinIdx);
+            obj.snapshotOffsets = [];
+            obj.snapshotFlags = [];
+            while true
+                offset = ftell(obj.fileId);
+                fread(obj.fileId, 1, 'int64');
+                flags = fread(obj.fileId, 1, 'int32');
+                if feof(obj.fileId) || isempty(flags)
+                    break
+                end
+                szByteWt = 4;
+                if bitand(flags, 2)
+                    fseek(obj.fileId, 4, 'cof');
+                    szByteWt = 2;
+                end
+                nWts = nSyn;
+                if bitand(flags, 1)
+                    nWts = fread(obj.fileId, 1, 'int32');
+                    if isempty(nWts)
+                        break
+                    end
+                    fseek(obj.fileId, nWts*4, 'cof');
+                end
+                
+                % skip the weights, ignore an incomplete last snapshot
+                offsetNext = ftell(obj.fileId) + nWts*szByteWt;
+                if offsetNext > szByteTot
+                    break
+                end
+                fseek(obj.fileId, offsetNext, 'bof');
+                obj.snapshotOffsets(end+1) = offset;
+                obj.snapshotFlags(end+1) = flags;
+            end
+            obj.nSnapshots = numel(obj.snapshotOffsets);
+            obj.lastFrame = -1;
+        end
+        
+        function [timeStamp, weights] = readSparseSnapshot(obj, frame)
+            % [timeStamp, weights] = CR.readSparseSnapshot(frame) decodes
+            % snapshot number frame of a sparse connect file and returns
+            % its timestamp and the full weight matrix as a row vector.
+            % Delta-encoded snapshots are applied to the last snapshot that
+            % stores all weights, or to the last decoded snapshot if that
+            % is closer.
+            if frame<1 || frame>obj.nSnapshots
+                obj.throwError(['Snapshot ' num2str(frame) ' does not ' ...
+                    'exist (' num2str(obj.nSnapshots) ' snapshots found)'])
+                return
+            end
+            
+            firstFrame = find(~bitand(obj.snapshotFlags(1:frame), 1), ...
+                1, 'last');
+            if obj.lastFrame>=firstFrame && obj.lastFrame<=frame
+                firstFrame = obj.lastFrame + 1;
+                wts = obj.lastFrameWeights;
+            else
+                wts = NaN(numel(obj.synLinIdx),1);
+            end
+            
+            for f=firstFrame:frame
+                fseek(obj.fileId, obj.snapshotOffsets(f), 'bof');
+                timeStamp = fread(obj.fileId, 1, 'int64');
+                flags = fread(obj.fileId, 1, 'int32');
+                isQuantized = bitand(flags, 2);
+                if isQuantized
+                    step = fread(obj.fileId, 1, 'float32');
+                end
+                if bitand(flags, 1)
+                    nWts = fread(obj.fileId, 1, 'int32');
+                    synIdx = fread(obj.fileId, nWts, 'int32') + 1;
+                else
+                    synIdx = 1:numel(obj.synLinIdx);
+                end
+                if isQuantized
+                    wts(synIdx) = fread(obj.fileId, numel(synIdx), ...
+                        'uint16') * step;
+                else
+                    wts(synIdx) = fread(obj.fileId, numel(synIdx), ...
+                        'float32');
+                end
+            end
+            if firstFrame > frame
+                % the requested snapshot is the last decoded one
+                fseek(obj.fileId, obj.snapshotOffsets(frame), 'bof');
+                timeStamp = fread(obj.fileId, 1, 'int64');
+            end
+            obj.lastFrame = frame;
+            obj.lastFrameWeights = wts;
+            
+            weights = NaN(1, obj.nNeurPre*obj.nNeurPost);
+            weights(obj.synLinIdx) = wts;
+        end
+        
         function throwError(obj, errorMsg, errorMode)
             % SR.throwError(errorMsg, errorMode) throws an error with a
             % specific severity (errorMode). In all cases, obj.errorFlag is
@@ -23,6 +23,7 @@ public:
 	// +++++ PUBLIC METHODS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ //
 
 	Impl(bool startTimer) {
+		_isTimerOn = false; // reset() checks the flag, so it must be initialized first
 		reset();
 		if (startTimer) {
 			start("start");